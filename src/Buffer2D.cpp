@@ -0,0 +1,192 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "Buffer2D.h"
+#include "Profiling.h"
+
+extern "C" {
+#include "relutility.h"
+}
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// maximal number of released blocks kept by the pool of a thread (further blocks are freed)
+#define BUFFER_POOL_MAX_BLOCKS 64
+
+static size_t round_up_to_alignment(size_t nbytes) {
+  return (nbytes + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+}
+
+// set when the pool of the thread is destroyed, as arrays can still be released afterwards (e.g., by
+// the destructor of another thread_local cache), which are then freed directly
+static thread_local bool is_buffer_pool_destroyed = false;
+
+/**
+ * @brief memory pool of one thread
+ * @details Every block starts with a header of BUFFER_ALIGNMENT bytes storing its capacity, the
+ * returned memory starts after the header and is therefore aligned as well.
+ */
+class BufferPool {
+
+ public:
+  BufferPool() {
+    m_free_blocks.reserve(BUFFER_POOL_MAX_BLOCKS);
+  }
+
+  ~BufferPool() {
+    clear();
+    is_buffer_pool_destroyed = true;
+  }
+
+  BufferPool(const BufferPool &other) = delete;
+  BufferPool &operator=(const BufferPool &other) = delete;
+
+  static BufferPool &instance() {
+    static thread_local BufferPool pool;
+    return pool;
+  }
+
+  /** get a block of (at least) nbytes, re-using the smallest released block which is large enough */
+  void *acquire(size_t nbytes) {
+    const size_t capacity = round_up_to_alignment(nbytes);
+
+    auto best = m_free_blocks.end();
+    for (auto it = m_free_blocks.begin(); it != m_free_blocks.end(); ++it) {
+      if (block_capacity(*it) >= capacity && block_capacity(*it) <= 2 * capacity
+          && (best == m_free_blocks.end() || block_capacity(*it) < block_capacity(*best))) {
+        best = it;
+      }
+    }
+
+    prof_cache_access(PROF_CACHE_BUFFER_POOL, best != m_free_blocks.end());
+    if (best != m_free_blocks.end()) {
+      char *block = *best;
+      *best = m_free_blocks.back();
+      m_free_blocks.pop_back();
+      return block + BUFFER_ALIGNMENT;
+    }
+
+    return allocate_block(capacity);
+  }
+
+  void release(void *ptr) {
+    char *block = static_cast<char *>(ptr) - BUFFER_ALIGNMENT;
+    if (m_free_blocks.size() < BUFFER_POOL_MAX_BLOCKS) {
+      m_free_blocks.push_back(block);
+    } else {
+      free_block(block);
+    }
+  }
+
+  void clear() {
+    for (auto block: m_free_blocks) {
+      free_block(block);
+    }
+    m_free_blocks.clear();
+  }
+
+  [[nodiscard]] int num_blocks() const {
+    return static_cast<int>(m_free_blocks.size());
+  }
+
+  static void free_block(char *block) {
+    prof_mem_add(PROF_MEM_BUFFER_POOL, -static_cast<long long>(block_capacity(block) + BUFFER_ALIGNMENT));
+    std::free(block);
+  }
+
+ private:
+  std::vector<char *> m_free_blocks;
+
+  static size_t block_capacity(const char *block) {
+    return *reinterpret_cast<const size_t *>(block);
+  }
+
+  static void *allocate_block(size_t capacity) {
+    auto block = static_cast<char *>(std::aligned_alloc(BUFFER_ALIGNMENT, capacity + BUFFER_ALIGNMENT));
+    if (block == nullptr) {
+      return nullptr;
+    }
+    *reinterpret_cast<size_t *>(block) = capacity;
+    prof_mem_add(PROF_MEM_BUFFER_POOL, static_cast<long long>(capacity + BUFFER_ALIGNMENT));
+    return block + BUFFER_ALIGNMENT;
+  }
+};
+
+/**
+ * @brief the block holds the row pointers, followed by the rows (each padded to a multiple of BUFFER_ALIGNMENT)
+ */
+double **new_buffer_2d(int nrows, int ncols, int *status) {
+
+  CHECK_STATUS_RET(*status, nullptr);
+  if (nrows < 0 || ncols < 0) {
+    RELXILL_ERROR("dimensions of a 2D array can not be negative", status);
+    return nullptr;
+  }
+
+  const size_t nbytes_pointers = round_up_to_alignment(nrows * sizeof(double *));
+  const size_t row_stride = round_up_to_alignment(ncols * sizeof(double)) / sizeof(double);
+
+  void *block = BufferPool::instance().acquire(nbytes_pointers + nrows * row_stride * sizeof(double));
+  CHECK_MALLOC_RET_STATUS(block, status, nullptr)
+
+  auto rows = static_cast<double **>(block);
+  auto values = reinterpret_cast<double *>(static_cast<char *>(block) + nbytes_pointers);
+  for (int ii = 0; ii < nrows; ii++) {
+    rows[ii] = values + ii * row_stride;
+  }
+
+  return rows;
+}
+
+void free_buffer_2d(double **buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  if (is_buffer_pool_destroyed) {
+    BufferPool::free_block(reinterpret_cast<char *>(buffer) - BUFFER_ALIGNMENT);
+  } else {
+    BufferPool::instance().release(buffer);
+  }
+}
+
+void clear_buffer_pool(void) {
+  if (!is_buffer_pool_destroyed) {
+    BufferPool::instance().clear();
+  }
+}
+
+int get_buffer_pool_num_blocks(void) {
+  return is_buffer_pool_destroyed ? 0 : BufferPool::instance().num_blocks();
+}
+
+Buffer2D::Buffer2D(int nrows, int ncols) : m_nrows{nrows}, m_ncols{ncols} {
+  int status = EXIT_SUCCESS;
+  m_rows = new_buffer_2d(nrows, ncols, &status);
+  if (status != EXIT_SUCCESS) {
+    throw std::bad_alloc();
+  }
+}
+
+void Buffer2D::fill(double value) {
+  for (int ii = 0; ii < m_nrows; ii++) {
+    std::fill(m_rows[ii], m_rows[ii] + m_ncols, value);
+  }
+}
@@ -0,0 +1,100 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#ifndef RELXILL_SRC_BUFFER2D_H_
+#define RELXILL_SRC_BUFFER2D_H_
+
+/**
+ * Contiguous 2D arrays of doubles (e.g., the spectra of all zones or inclinations), where every row starts
+ * at a BUFFER_ALIGNMENT byte boundary. The row pointers and the rows are stored in a single memory block,
+ * which is taken from the memory pool of the calling thread. A released block is kept in the pool and
+ * re-used for the next array of (at most twice) its size, such that repeated evaluations of a model do
+ * not allocate any memory for these arrays (see the cache statistics of PROF_CACHE_BUFFER_POOL).
+ *
+ * Usage (C):   double **flux = new_buffer_2d(nzones, n_ener, status);  ...  free_buffer_2d(flux);
+ * Usage (C++): Buffer2D flux{nzones, n_ener};  flux[ii][jj] = ...;
+ */
+
+#define BUFFER_ALIGNMENT 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** get a 2D array [nrows][ncols] from the memory pool (the values are not initialized) */
+double **new_buffer_2d(int nrows, int ncols, int *status);
+
+/** release the 2D array to the memory pool of the calling thread (NULL is ignored) */
+void free_buffer_2d(double **buffer);
+
+/** free all blocks held by the memory pool of the calling thread */
+void clear_buffer_pool(void);
+
+/** number of blocks held by the memory pool of the calling thread (available for re-use) */
+int get_buffer_pool_num_blocks(void);
+
+#ifdef __cplusplus
+}
+
+/** @brief owns a 2D array from new_buffer_2d, which is released to the memory pool on destruction */
+class Buffer2D {
+
+ public:
+  /** @throw std::bad_alloc if the memory could not be allocated */
+  Buffer2D(int nrows, int ncols);
+
+  ~Buffer2D() {
+    free_buffer_2d(m_rows);
+  }
+
+  Buffer2D(const Buffer2D &other) = delete;
+  Buffer2D &operator=(const Buffer2D &other) = delete;
+
+  Buffer2D(Buffer2D &&other) noexcept
+      : m_rows{other.m_rows}, m_nrows{other.m_nrows}, m_ncols{other.m_ncols} {
+    other.m_rows = nullptr;
+  }
+
+  double *operator[](int irow) const {
+    return m_rows[irow];
+  }
+
+  /** row pointers, e.g., to be used as double** in the C functions */
+  [[nodiscard]] double **rows() const {
+    return m_rows;
+  }
+
+  [[nodiscard]] int num_rows() const {
+    return m_nrows;
+  }
+
+  [[nodiscard]] int num_cols() const {
+    return m_ncols;
+  }
+
+  void fill(double value);
+
+ private:
+  double **m_rows;
+  int m_nrows;
+  int m_ncols;
+};
+
+#endif
+
+#endif //RELXILL_SRC_BUFFER2D_H_
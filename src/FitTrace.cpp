@@ -0,0 +1,232 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "FitTrace.h"
+#include "ModelDatabase.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+extern "C" {
+#include "relutility.h"
+}
+
+static const char fit_trace_magic[8] = {'R', 'L', 'X', 'T', 'R', 'A', 'C', 'E'};
+
+static std::atomic<int> recording_enabled{-1};  // -1: not yet initialized from ENV
+static std::mutex record_mutex;                 // guards the file and the known energy grids
+static FILE *record_file = nullptr;
+static std::unordered_set<uint64_t> recorded_energy_grids;
+
+uint64_t get_energy_grid_hash(const double *energy, int num_flux_bins) {
+  uint64_t hash = 14695981039346656037ULL;
+  auto add_bytes = [&hash](const void *data, size_t nbytes) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t ii = 0; ii < nbytes; ii++) {
+      hash ^= bytes[ii];
+      hash *= 1099511628211ULL;
+    }
+  };
+  add_bytes(&num_flux_bins, sizeof(num_flux_bins));
+  add_bytes(energy, sizeof(double) * (num_flux_bins + 1));
+  return hash;
+}
+
+static void write_bytes(const void *data, size_t nbytes) {
+  if (record_file == nullptr) {  // recording was stopped in the meantime
+    return;
+  }
+  if (fwrite(data, 1, nbytes, record_file) != nbytes) {
+    printf(" *** warning: writing the fit trace failed, stopping the recording\n");
+    fclose(record_file);
+    record_file = nullptr;
+    recording_enabled = 0;
+  }
+}
+
+static void open_record_file(const std::string &filename) {
+  record_file = fopen(filename.c_str(), "wb");
+  if (record_file == nullptr) {
+    printf(" *** warning: can not open file %s for recording the fit trace\n", filename.c_str());
+    recording_enabled = 0;
+    return;
+  }
+  recorded_energy_grids.clear();
+
+  uint32_t version = FIT_TRACE_VERSION;
+  write_bytes(fit_trace_magic, sizeof(fit_trace_magic));
+  write_bytes(&version, sizeof(version));
+  recording_enabled = 1;
+}
+
+static void close_record_file() {
+  std::lock_guard<std::mutex> lock(record_mutex);
+  if (record_file != nullptr) {
+    fclose(record_file);
+    record_file = nullptr;
+  }
+  recording_enabled = 0;
+}
+
+static void init_recording() {
+  std::lock_guard<std::mutex> lock(record_mutex);
+  if (recording_enabled != -1) {
+    return;
+  }
+  char *fname = get_relxill_record_filename();
+  if (fname == nullptr) {
+    recording_enabled = 0;
+    return;
+  }
+  open_record_file(fname);
+  atexit(close_record_file);
+}
+
+int is_fit_recording_enabled() {
+  if (recording_enabled == -1) {
+    init_recording();
+  }
+  return recording_enabled;
+}
+
+void start_fit_recording(const std::string &filename) {
+  stop_fit_recording();
+  std::lock_guard<std::mutex> lock(record_mutex);
+  open_record_file(filename);
+}
+
+void stop_fit_recording() {
+  close_record_file();
+}
+
+void record_model_call(ModelName model_name, const double *parameter_values, int num_flux_bins,
+                       const double *energy) {
+
+  if (!is_fit_recording_enabled()) {
+    return;
+  }
+
+  const std::string name = ModelDatabase::instance().model_string(model_name);
+  const auto num_params = static_cast<uint32_t>(ModelDatabase::instance().param_list(model_name).num_params());
+  const uint64_t hash = get_energy_grid_hash(energy, num_flux_bins);
+
+  std::lock_guard<std::mutex> lock(record_mutex);
+
+  if (recorded_energy_grids.count(hash) == 0) {
+    const char type = 'E';
+    const auto nbins = static_cast<uint32_t>(num_flux_bins);
+    write_bytes(&type, 1);
+    write_bytes(&hash, sizeof(hash));
+    write_bytes(&nbins, sizeof(nbins));
+    write_bytes(energy, sizeof(double) * (nbins + 1));
+    recorded_energy_grids.insert(hash);
+  }
+
+  const char type = 'C';
+  const auto name_len = static_cast<uint8_t>(name.size());
+  write_bytes(&type, 1);
+  write_bytes(&name_len, sizeof(name_len));
+  write_bytes(name.c_str(), name_len);
+  write_bytes(&hash, sizeof(hash));
+  write_bytes(&num_params, sizeof(num_params));
+  write_bytes(parameter_values, sizeof(double) * num_params);
+}
+
+/** read exactly nbytes from the file, returns false at the end of the file */
+static bool read_bytes(FILE *file, void *data, size_t nbytes, const std::string &filename) {
+  size_t nread = fread(data, 1, nbytes, file);
+  if (nread == 0 && feof(file)) {
+    return false;
+  } else if (nread != nbytes) {
+    fclose(file);
+    throw std::runtime_error("fit trace " + filename + " is truncated");
+  }
+  return true;
+}
+
+static void read_bytes_required(FILE *file, void *data, size_t nbytes, const std::string &filename) {
+  if (!read_bytes(file, data, nbytes, filename)) {
+    fclose(file);
+    throw std::runtime_error("fit trace " + filename + " is truncated");
+  }
+}
+
+std::vector<FitTraceCall> read_fit_trace(const std::string &filename) {
+
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (file == nullptr) {
+    throw std::runtime_error("can not open fit trace " + filename);
+  }
+
+  char magic[sizeof(fit_trace_magic)];
+  uint32_t version = 0;
+  read_bytes_required(file, magic, sizeof(magic), filename);
+  read_bytes_required(file, &version, sizeof(version), filename);
+  if (memcmp(magic, fit_trace_magic, sizeof(magic)) != 0 || version != FIT_TRACE_VERSION) {
+    fclose(file);
+    throw std::runtime_error(filename + " is not a valid fit trace (version " + std::to_string(FIT_TRACE_VERSION) + ")");
+  }
+
+  std::unordered_map<uint64_t, std::shared_ptr<const std::vector<double>>> energy_grids;
+  std::vector<FitTraceCall> calls;
+
+  char type;
+  while (read_bytes(file, &type, 1, filename)) {
+    uint64_t hash;
+    if (type == 'E') {
+      uint32_t nbins;
+      read_bytes_required(file, &hash, sizeof(hash), filename);
+      read_bytes_required(file, &nbins, sizeof(nbins), filename);
+      auto energy = std::make_shared<std::vector<double>>(nbins + 1);
+      read_bytes_required(file, energy->data(), sizeof(double) * (nbins + 1), filename);
+      energy_grids[hash] = energy;
+
+    } else if (type == 'C') {
+      FitTraceCall call;
+      uint8_t name_len;
+      uint32_t num_params;
+      read_bytes_required(file, &name_len, sizeof(name_len), filename);
+      call.model_name.resize(name_len);
+      read_bytes_required(file, &call.model_name[0], name_len, filename);
+      read_bytes_required(file, &call.energy_hash, sizeof(call.energy_hash), filename);
+      read_bytes_required(file, &num_params, sizeof(num_params), filename);
+      call.parameters.resize(num_params);
+      read_bytes_required(file, call.parameters.data(), sizeof(double) * num_params, filename);
+
+      auto grid = energy_grids.find(call.energy_hash);
+      if (grid == energy_grids.end()) {
+        fclose(file);
+        throw std::runtime_error("fit trace " + filename + " refers to an unknown energy grid");
+      }
+      call.energy = grid->second;
+      calls.push_back(std::move(call));
+
+    } else {
+      fclose(file);
+      throw std::runtime_error("fit trace " + filename + " contains an unknown record type");
+    }
+  }
+
+  fclose(file);
+  return calls;
+}
@@ -0,0 +1,78 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#ifndef RELXILL_SRC_FITTRACE_H_
+#define RELXILL_SRC_FITTRACE_H_
+
+/**
+ * Recording of the calls of the model by a fit (model name, parameter vector and energy grid), such that
+ * the exact sequence of evaluations can be replayed later (see test/speed/replay_fit_trace.cpp).
+ * Enabled by the ENV variable RELXILL_RECORD=<filename>, in which case every call of
+ * xspec_C_wrapper_eval_model is appended to the file.
+ *
+ * Binary format (little endian, as written by the machine):
+ *   header:  "RLXTRACE" (8 bytes), version (uint32)
+ *   records: type (1 byte), followed by
+ *     'E' (energy grid):  hash (uint64), number of bins n (uint32), energy[n+1] (double)
+ *     'C' (model call):   length of the model name (uint8), model name, hash of the energy grid (uint64),
+ *                         number of parameters (uint32), parameters (double)
+ * Every energy grid is only written once, before the first call using it.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ModelInfo.h"
+
+#define FIT_TRACE_VERSION 1
+
+/** single call of the model, as read from a fit trace */
+struct FitTraceCall {
+  std::string model_name;
+  std::vector<double> parameters;
+  uint64_t energy_hash;
+  std::shared_ptr<const std::vector<double>> energy;  // energy grid (num_flux_bins+1 values)
+
+  [[nodiscard]] int num_flux_bins() const {
+    return static_cast<int>(energy->size()) - 1;
+  }
+};
+
+/** hash (FNV-1a) of an energy grid with num_flux_bins bins */
+uint64_t get_energy_grid_hash(const double *energy, int num_flux_bins);
+
+int is_fit_recording_enabled();
+
+/** start recording all model calls to the file (an existing file is overwritten) */
+void start_fit_recording(const std::string &filename);
+/** stop recording and close the file */
+void stop_fit_recording();
+
+/** append a call of the model to the fit trace (only if recording is enabled) */
+void record_model_call(ModelName model_name, const double *parameter_values, int num_flux_bins,
+                       const double *energy);
+
+/**
+ * read all calls of a fit trace
+ * @throw std::runtime_error if the file can not be read or is not a valid fit trace
+ */
+std::vector<FitTraceCall> read_fit_trace(const std::string &filename);
+
+#endif //RELXILL_SRC_FITTRACE_H_
@@ -16,6 +16,9 @@
     Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
 */
 #include "IonGradient.h"
+#include "Relbase.h"
+
+#include <algorithm>
 
 extern "C"{
 #include "writeOutfiles.h"
@@ -186,12 +189,10 @@ void IonGradient::calc_energy_shift_from_source_to_disk(const relParam *rel_para
   }
 }
 
-xillTableParam **IonGradient::get_xill_param_zone(const xillTableParam *primary_source_xilltab_params) const {
-
-  auto xill_param_zone = new xillTableParam *[m_nzones];
+void IonGradient::set_xill_param_zone(const xillTableParam *primary_source_xilltab_params,
+                                      xillTableParam *const *xill_param_zone) const {
 
   for (int ii = 0; ii < m_nzones; ii++) {
-    xill_param_zone[ii] = new xillTableParam;
     (*xill_param_zone[ii]) = (*primary_source_xilltab_params);  // shallow copy (enough for the parameter structure)
 
     // set xillver parameters for the given zone
@@ -199,8 +200,6 @@ xillTableParam **IonGradient::get_xill_param_zone(const xillTableParam *primary_
     xill_param_zone[ii]->lxi = lxi[ii];
     xill_param_zone[ii]->dens = dens[ii];
   }
-
-  return xill_param_zone;
 }
 
 double calc_flux_rin_cgs(double l_source, double height, double Rin, double mass) {
@@ -482,3 +481,136 @@ const double *RadialGrid::calculate_radial_grid(double rmin, double rmax, const
 
   return rgrid;
 }
+
+
+static int are_values_similar(double val1, double val2, double tolerance) {
+  return fabs(val1 - val2) <= tolerance * fmax(1.0, fmax(fabs(val1), fabs(val2)));
+}
+
+static int are_log_values_similar(double val1, double val2, double tolerance) {
+  return fabs(val1 - val2) <= tolerance;
+}
+
+/** compare absolute (for logarithmic values as logxi and density) or relative to the value if it is larger than 1 */
+int are_xill_table_params_similar(const xillTableParam *par1, const xillTableParam *par2, double tolerance) {
+  if (par1->prim_type != par2->prim_type || par1->model_type != par2->model_type) {
+    return 0;
+  }
+  return are_log_values_similar(par1->lxi, par2->lxi, tolerance)
+      && are_log_values_similar(par1->dens, par2->dens, tolerance)
+      && are_values_similar(par1->ect, par2->ect, tolerance)
+      && are_values_similar(par1->gam, par2->gam, tolerance)
+      && are_values_similar(par1->afe, par2->afe, tolerance)
+      && are_values_similar(par1->incl, par2->incl, tolerance)
+      && are_values_similar(par1->frac_pl_bb, par2->frac_pl_bb, tolerance)
+      && are_values_similar(par1->kTbb, par2->kTbb, tolerance);
+}
+
+MergedZones::MergedZones(xillTableParam *const *xill_param_zone, int nzones, double tolerance) {
+  assert(nzones > 0);
+  m_zone_start.push_back(0);
+  for (int ii = 1; ii < nzones; ii++) {
+    // always compare to the first zone, such that the parameters of a merged zone can not drift
+    if (tolerance <= 0.0
+        || !are_xill_table_params_similar(xill_param_zone[m_zone_start.back()], xill_param_zone[ii], tolerance)) {
+      m_zone_start.push_back(ii);
+    }
+  }
+  m_zone_start.push_back(nzones);
+}
+
+int MergedZones::merged_index(int izone) const {
+  assert(izone >= 0 && izone < num_input_zones());
+  return static_cast<int>(std::upper_bound(m_zone_start.begin(), m_zone_start.end() - 1, izone)
+                              - m_zone_start.begin()) - 1;
+}
+
+relline_spec_multizone *MergedZones::merge_rel_profile(const relline_spec_multizone *rel_profile,
+                                                        int *status) const {
+
+  CHECK_STATUS_RET(*status, nullptr);
+  assert(rel_profile->n_zones == num_input_zones());
+
+  const int n_ener = rel_profile->n_ener;
+  relline_spec_multizone *merged_profile = new_rel_spec(num_zones(), n_ener, status);
+  CHECK_STATUS_RET(*status, merged_profile);
+
+  for (int jj = 0; jj <= n_ener; jj++) {
+    merged_profile->ener[jj] = rel_profile->ener[jj];
+  }
+
+  merged_profile->rgrid = (double *) malloc((num_zones() + 1) * sizeof(double));
+  CHECK_MALLOC_RET_STATUS(merged_profile->rgrid, status, merged_profile)
+  for (int kk = 0; kk <= num_zones(); kk++) {
+    merged_profile->rgrid[kk] = rel_profile->rgrid[m_zone_start[kk]];
+  }
+
+  const RelCosne *rel_cosne = rel_profile->rel_cosne;
+  if (rel_cosne != nullptr) {
+    merged_profile->rel_cosne = new_rel_cosne(num_zones(), rel_cosne->n_cosne, status);
+    CHECK_STATUS_RET(*status, merged_profile);
+    for (int ll = 0; ll < rel_cosne->n_cosne; ll++) {
+      merged_profile->rel_cosne->cosne[ll] = rel_cosne->cosne[ll];
+    }
+  }
+
+  for (int kk = 0; kk < num_zones(); kk++) {
+    double *flux = merged_profile->flux[kk];
+    for (int jj = 0; jj < n_ener; jj++) {
+      flux[jj] = 0.0;
+    }
+    double *dist = (rel_cosne != nullptr) ? merged_profile->rel_cosne->dist[kk] : nullptr;
+    if (dist != nullptr) {
+      for (int ll = 0; ll < rel_cosne->n_cosne; ll++) {
+        dist[ll] = 0.0;
+      }
+    }
+
+    double sum_weights = 0.0;
+    for (int ii = m_zone_start[kk]; ii < m_zone_start[kk + 1]; ii++) {
+      double weight = 0.0;
+      for (int jj = 0; jj < n_ener; jj++) {
+        flux[jj] += rel_profile->flux[ii][jj];
+        weight += rel_profile->flux[ii][jj];
+      }
+      if (dist != nullptr) {
+        for (int ll = 0; ll < rel_cosne->n_cosne; ll++) {
+          dist[ll] += weight * rel_cosne->dist[ii][ll];
+        }
+      }
+      sum_weights += weight;
+    }
+
+    // the angular distribution of each zone is normalized (see relline profile), keep this for the merged zone
+    if (dist != nullptr) {
+      for (int ll = 0; ll < rel_cosne->n_cosne; ll++) {
+        dist[ll] = (sum_weights > 0) ? dist[ll] / sum_weights : rel_cosne->dist[m_zone_start[kk]][ll];
+      }
+    }
+  }
+
+  return merged_profile;
+}
+
+void MergedZones::average_zone_factors(const relline_spec_multizone *rel_profile, const double *zone_factors,
+                                       double *merged_factors) const {
+  assert(rel_profile->n_zones == num_input_zones());
+
+  for (int kk = 0; kk < num_zones(); kk++) {
+    merged_factors[kk] = zone_factors[m_zone_start[kk]];
+    if (m_zone_start[kk + 1] - m_zone_start[kk] == 1) {
+      continue;
+    }
+
+    double sum_factors = 0.0;
+    double sum_weights = 0.0;
+    for (int ii = m_zone_start[kk]; ii < m_zone_start[kk + 1]; ii++) {
+      const double weight = calcSum(rel_profile->flux[ii], rel_profile->n_ener);
+      sum_factors += weight * zone_factors[ii];
+      sum_weights += weight;
+    }
+    if (sum_weights > 0) {
+      merged_factors[kk] = sum_factors / sum_weights;
+    }
+  }
+}
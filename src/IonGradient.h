@@ -100,7 +100,9 @@ class IonGradient{
 
   void calculate_gradient(const emisProfile &emis_profile, const PrimarySourceParameters &primary_source_params);
 
-  [[nodiscard]] xillTableParam **get_xill_param_zone(const xillTableParam *primary_source_xilltab_params) const;
+  /** set the xillver parameters of each zone (xill_param_zone[nzones()] needs to point to allocated parameters) */
+  void set_xill_param_zone(const xillTableParam *primary_source_xilltab_params,
+                           xillTableParam *const *xill_param_zone) const;
 
   double get_ecut_disk_zone(const relParam *rel_param, double ecut_primary, int izone) const;
 
@@ -131,5 +133,60 @@ class IonGradient{
 };
 
 
+/**
+ * consecutive zones of the ionization gradient, whose xillver parameters differ by less than a tolerance,
+ * are merged to a single zone for the xillver and the convolution stage (the relline kernels of the zones
+ * are summed up). The xillver parameters of the first zone are used for the merged zone.
+ * The zones are only merged if enabled by the ENV variable RELXILL_MERGE_ZONES=<tolerance>.
+ */
+class MergedZones {
+
+ public:
+  MergedZones(xillTableParam *const *xill_param_zone, int nzones, double tolerance);
+
+  [[nodiscard]] int num_zones() const {
+    return static_cast<int>(m_zone_start.size()) - 1;
+  }
+
+  [[nodiscard]] int num_input_zones() const {
+    return m_zone_start.back();
+  }
+
+  [[nodiscard]] bool is_merged() const {
+    return num_zones() < num_input_zones();
+  }
+
+  /** first zone of the input grid of the merged zone imerged (its parameters are used for the merged zone) */
+  [[nodiscard]] int first_zone(int imerged) const {
+    return m_zone_start[imerged];
+  }
+
+  /** index of the merged zone, the zone izone of the input grid belongs to */
+  [[nodiscard]] int merged_index(int izone) const;
+
+  [[nodiscard]] const std::vector<int> &zone_start() const {
+    return m_zone_start;
+  }
+
+  /**
+   * @brief sum the relline kernels of all zones belonging to a merged zone; the angular distribution is
+   * averaged, weighted with the flux of the zones
+   */
+  [[nodiscard]] relline_spec_multizone *merge_rel_profile(const relline_spec_multizone *rel_profile,
+                                                          int *status) const;
+
+  /**
+   * @brief average the factors zone_factors[izone] of all zones belonging to a merged zone, weighted with the
+   * flux of their relline kernel (such that the factor can be applied to the xillver spectrum of the merged zone)
+   * @param merged_factors [output: num_zones() values]
+   */
+  void average_zone_factors(const relline_spec_multizone *rel_profile, const double *zone_factors,
+                            double *merged_factors) const;
+
+ private:
+  std::vector<int> m_zone_start;  // first zone of each merged zone, followed by the number of input zones
+};
+
+int are_xill_table_params_similar(const xillTableParam *par1, const xillTableParam *par2, double tolerance);
 
 #endif
@@ -18,7 +18,11 @@
 
 #include "LocalModel.h"
 #include "XspecSpectrum.h"
+#include "ThreadPool.h"
+#include "FitTrace.h"
 
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
 #include <iostream>
 
@@ -29,44 +33,61 @@
  * @description: simply shift the energy grid by the line energy and call to the relbase function, which calculates
  *  the line for 1 keV
  */
-void LocalModel::line_model(const XspecSpectrum &spectrum) {
+void LocalModel::line_model(XspecSpectrum &spectrum) {
 
   auto rel_param = get_rel_params();
 
   // relbase calculates the line for 1keV, i.e., shift the energy grid accordingly
   spectrum.shift_energy_grid_1keV(rel_param->lineE);
 
+  // the profile is cached independent of the line energy and the redshift (on an internal grid)
   int status = EXIT_SUCCESS;
-  relline_spec_multizone *spec = relbase(spectrum.energy, spectrum.num_flux_bins(), rel_param, &status);
+  relline_profile(spectrum.energy(), spectrum.flux, spectrum.num_flux_bins(), rel_param, &status);
   delete rel_param;
 
-  for (int ii = 0; ii < spectrum.num_flux_bins(); ii++) {
-    spectrum.flux[ii] = spec->flux[0][ii];
-  }
-
   if (status != EXIT_SUCCESS) {
     throw std::exception();
   }
 
 }
 
+std::string LocalModel::get_trace_args() {
+  std::string args = "\"model\": \"" + get_model_string() + "\", \"parameters\": [";
+  auto parnames = m_model_params.get_parnames();
+  for (size_t ii = 0; ii < parnames.size(); ii++) {
+    char value[32];
+    snprintf(value, sizeof(value), "%s%.8g", (ii > 0) ? ", " : "", m_model_params[parnames[ii]]);
+    args += value;
+  }
+  return args + "]";
+}
+
 /*
  * @brief calculate relxill model
  */
 void LocalModel::relxill_model(const XspecSpectrum &spectrum) {
 
-
   int status = EXIT_SUCCESS;
-  if (m_model_params.irradiation() == T_Irrad::Const){
-    relParam *rel_param = LocalModel::get_rel_params();
-    xillParam *xill_param = LocalModel::get_xill_params();
-    relxill_bb_kernel(spectrum.energy, spectrum.flux, spectrum.num_flux_bins(), xill_param, rel_param, &status);
-    delete rel_param;
-    delete xill_param;
-  } else {
-    relxill_kernel(spectrum, m_model_params, &status);
+  relxill_kernel(spectrum, m_model_params, &status);
+
+  if (status != EXIT_SUCCESS) {
+    throw std::exception();
   }
 
+}
+
+/**
+ * @brief calculate relxill model with a constant irradiation (returning radiation of a blackbody)
+ */
+void LocalModel::relxill_bb_model(const XspecSpectrum &spectrum) {
+
+  int status = EXIT_SUCCESS;
+  relParam *rel_param = LocalModel::get_rel_params();
+  xillParam *xill_param = LocalModel::get_xill_params();
+  relxill_bb_kernel(spectrum.energy(), spectrum.flux, spectrum.num_flux_bins(), xill_param, rel_param, &status);
+  delete rel_param;
+  delete xill_param;
+
   if (status != EXIT_SUCCESS) {
     throw std::exception();
   }
@@ -88,7 +109,7 @@ void LocalModel::conv_model(const XspecSpectrum &spectrum) {
   relParam *rel_param = LocalModel::get_rel_params();
 
   int status = EXIT_SUCCESS;
-  relconv_kernel(spectrum.energy, spectrum.flux, spectrum.num_flux_bins(), rel_param, &status);
+  relconv_kernel(spectrum.energy(), spectrum.flux, spectrum.num_flux_bins(), rel_param, &status);
 
   if (status != EXIT_SUCCESS) {
     throw ModelEvalFailed("executing convolution failed");
@@ -111,10 +132,10 @@ void LocalModel::xillver_model(const XspecSpectrum &spectrum) {
   // add the dependence on incl, assuming a semi-infinite slab
   norm_xillver_spec(spec, xill_param->incl);
 
-  rebin_spectrum(spectrum.energy, spectrum.flux, spectrum.num_flux_bins(), spec->ener, spec->flu[0], spec->n_ener);
+  rebin_spectrum(spectrum.energy(), spectrum.flux, spectrum.num_flux_bins(), spec->ener, spec->flu[0], spec->n_ener);
   free_xill_spec(spec);
 
-  add_primary_component(spectrum.energy,
+  add_primary_component(spectrum.energy(),
                         spectrum.num_flux_bins(),
                         spectrum.flux,
                         nullptr,
@@ -148,6 +169,7 @@ void xspec_C_wrapper_eval_model(ModelName model_name,
 
   try {
     LocalModel local_model{parameter_values, model_name};
+    record_model_call(model_name, parameter_values, num_flux_bins, xspec_energy);
 
     XspecSpectrum spectrum{xspec_energy, xspec_flux, static_cast<size_t>(num_flux_bins)};
     local_model.eval_model(spectrum);
@@ -158,3 +180,376 @@ void xspec_C_wrapper_eval_model(ModelName model_name,
     // TODO: what should we do if the evaluation fails? return zeros?
 
 }
+
+
+/** relativistic and xillver parameters of one parameter vector of a batch (nullptr if not defined) */
+struct BatchCacheKey {
+  std::unique_ptr<relParam> rel_param;
+  std::unique_ptr<xillParam> xill_param;
+};
+
+static BatchCacheKey get_batch_cache_key(const double *parameter_values, ModelName model_name) {
+  BatchCacheKey key;
+  try {
+    LocalModel local_model{parameter_values, model_name};
+    key.rel_param.reset(local_model.get_rel_params());
+    // models without a primary spectrum (e.g., relline) do not have xillver parameters
+    if (lmodel_info(model_name).primeSpec() != T_PrimSpec::None) {
+      key.xill_param.reset(local_model.get_xill_params());
+    }
+  } catch (std::exception &e) {
+    // invalid values are reported by the evaluation itself
+  }
+  return key;
+}
+
+static bool is_same_rel_param(const relParam *par1, const relParam *par2) {
+  if (par1 == nullptr || par2 == nullptr) {
+    return par1 == par2;
+  }
+  return did_rel_param_change(par1, par2) == 0;
+}
+
+static bool is_same_xill_param(const xillParam *par1, const xillParam *par2) {
+  if (par1 == nullptr || par2 == nullptr) {
+    return par1 == par2;
+  }
+  return did_xill_param_change(par1, par2) == 0;
+}
+
+/** stages of the model, which need to be re-computed for a perturbed parameter */
+enum class SweepStage {
+  none,    // neither the relativistic nor the xillver stage (e.g., the normalization)
+  relat,   // only the relativistic stage (e.g., spin or emissivity)
+  xill,    // only the xillver stage (e.g., logxi or Afe)
+  both
+};
+
+/**
+ * get the stages, which are affected by changing the parameters from key_base to key (using the same
+ * comparison as the caching of the relxill_kernel)
+ */
+static SweepStage get_sweep_stage(const BatchCacheKey &key_base, const BatchCacheKey &key) {
+
+  const bool redo_relat = !is_same_rel_param(key.rel_param.get(), key_base.rel_param.get());
+
+  bool redo_xill;
+  if (key.rel_param != nullptr && key.xill_param != nullptr
+      && key_base.rel_param != nullptr && key_base.xill_param != nullptr) {
+    redo_xill = redo_xillver_calc(key.rel_param.get(), key.xill_param.get(),
+                                  key_base.rel_param.get(), key_base.xill_param.get()) != 0;
+  } else {
+    redo_xill = !is_same_xill_param(key.xill_param.get(), key_base.xill_param.get());
+  }
+
+  if (redo_relat && redo_xill) {
+    return SweepStage::both;
+  } else if (redo_relat) {
+    return SweepStage::relat;
+  } else if (redo_xill) {
+    return SweepStage::xill;
+  }
+  return SweepStage::none;
+}
+
+/** the stages of key are cached if it is evaluated after key_prev (and key defines these stages) */
+static bool is_rel_stage_shared(const BatchCacheKey &key_prev, const BatchCacheKey &key) {
+  const auto stage = get_sweep_stage(key_prev, key);
+  return key.rel_param != nullptr && (stage == SweepStage::none || stage == SweepStage::xill);
+}
+
+static bool is_xill_stage_shared(const BatchCacheKey &key_prev, const BatchCacheKey &key) {
+  const auto stage = get_sweep_stage(key_prev, key);
+  return key.xill_param != nullptr && (stage == SweepStage::none || stage == SweepStage::relat);
+}
+
+/** indices of parameter vectors with identical relativistic and xillver parameters */
+using CacheCluster = std::vector<size_t>;
+
+/**
+ * @brief partition a batch into groups with identical relativistic parameters, each consisting of clusters
+ * with identical xillver parameters (for models without relativistic parameters, the groups are formed by
+ * the xillver parameters)
+ */
+static std::vector<std::vector<CacheCluster>> get_rel_param_groups(const std::vector<BatchCacheKey> &keys) {
+
+  std::vector<std::vector<CacheCluster>> groups;
+  for (size_t ii = 0; ii < keys.size(); ii++) {
+    const auto &key = keys[ii];
+
+    auto group = std::find_if(groups.begin(), groups.end(), [&keys, &key](const auto &grp) {
+      const auto &key_group = keys[grp[0][0]];
+      return is_same_rel_param(key.rel_param.get(), key_group.rel_param.get())
+          && (key.rel_param != nullptr || is_same_xill_param(key.xill_param.get(), key_group.xill_param.get()));
+    });
+    if (group == groups.end()) {
+      groups.push_back({{ii}});
+      continue;
+    }
+
+    auto cluster = std::find_if(group->begin(), group->end(), [&keys, &key](const auto &clus) {
+      return is_same_xill_param(key.xill_param.get(), keys[clus[0]].xill_param.get());
+    });
+    if (cluster == group->end()) {
+      group->push_back({ii});
+    } else {
+      cluster->push_back(ii);
+    }
+  }
+
+  // groups which can share the xillver stage (e.g., differing only in the inclination) are evaluated one
+  // after the other
+  std::vector<std::vector<CacheCluster>> ordered_groups;
+  std::vector<bool> is_ordered(groups.size(), false);
+  for (size_t ig = 0; ig < groups.size(); ig++) {
+    if (is_ordered[ig]) {
+      continue;
+    }
+    const auto &key_group = keys[groups[ig][0][0]];
+    ordered_groups.push_back(std::move(groups[ig]));
+    for (size_t jg = ig + 1; jg < groups.size(); jg++) {
+      if (!is_ordered[jg] && is_xill_stage_shared(key_group, keys[groups[jg][0][0]])) {
+        ordered_groups.push_back(std::move(groups[jg]));
+        is_ordered[jg] = true;
+      }
+    }
+  }
+
+  return ordered_groups;
+}
+
+/**
+ * @brief partition a batch into the tasks of the workers, such that the cached stages are shared (cache affinity)
+ * @details Each task is evaluated by a single worker, which keeps its own caches. The parameter vectors are
+ * ordered by their relativistic parameters (see get_rel_param_groups), and within those by the xillver
+ * parameters, such that the system parameters and the relline profile are calculated only once per group,
+ * and the xillver spectra once per cluster. This sequence is split into contiguous tasks of at most
+ * ceil(num_batch/num_workers) evaluations, preferably at the boundaries of the clusters, such that a batch
+ * sharing all relativistic parameters (e.g., a sweep in logxi) is still evaluated by all workers.
+ * @return vector of tasks, each holding the indices of the parameter vectors
+ */
+std::vector<std::vector<size_t>> get_cache_affinity_tasks(ModelName model_name,
+                                                          const double *parameter_values,
+                                                          size_t num_batch,
+                                                          size_t num_workers,
+                                                          BatchStatistics &batch_stats) {
+
+  const size_t num_params = ModelDatabase::instance().param_list(model_name).num_params();
+  std::vector<BatchCacheKey> keys;
+  for (size_t ii = 0; ii < num_batch; ii++) {
+    keys.push_back(get_batch_cache_key(&parameter_values[ii * num_params], model_name));
+  }
+
+  const auto groups = get_rel_param_groups(keys);
+
+  const size_t max_task_size = (num_batch + std::max(num_workers, size_t{1}) - 1) / std::max(num_workers, size_t{1});
+  std::vector<std::vector<size_t>> tasks;
+  for (const auto &group: groups) {
+    for (const auto &cluster: group) {
+      if (tasks.empty() || tasks.back().size() + cluster.size() > max_task_size) {
+        tasks.emplace_back();
+      }
+      for (auto ii: cluster) {
+        if (tasks.back().size() >= max_task_size) {
+          tasks.emplace_back();
+        }
+        tasks.back().push_back(ii);
+      }
+    }
+  }
+  tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [](const auto &task) { return task.empty(); }),
+              tasks.end());
+
+  batch_stats = BatchStatistics{};
+  batch_stats.num_evaluations = static_cast<int>(num_batch);
+  batch_stats.num_groups = static_cast<int>(groups.size());
+  batch_stats.num_tasks = static_cast<int>(tasks.size());
+  for (const auto &task: tasks) {
+    for (size_t ii = 1; ii < task.size(); ii++) {
+      batch_stats.num_rel_shared += is_rel_stage_shared(keys[task[ii - 1]], keys[task[ii]]) ? 1 : 0;
+      batch_stats.num_xill_shared += is_xill_stage_shared(keys[task[ii - 1]], keys[task[ii]]) ? 1 : 0;
+    }
+  }
+
+  return tasks;
+}
+
+/**
+ * Evaluate the model for a batch of parameter vectors (e.g., all walkers of an MCMC ensemble sampler)
+ * @details the parameter vectors are distributed on the workers of the global ThreadPool (number of
+ * threads is set by the ENV variable RELXILL_NUM_THREADS). Each worker holds its own caches, the tables are
+ * shared. Parameter vectors sharing cached stages are evaluated one after the other by the same worker (see
+ * get_cache_affinity_tasks). Every parameter vector is evaluated independently, therefore the result does not
+ * depend on the number of threads (except that a cached value is re-used for parameters differing by less than
+ * CACHE_LIMIT). As for a single evaluation, every call is recorded (see record_model_call) and an invalid
+ * parameter vector is reported without aborting the batch.
+ * @param model_name: unique name of the model
+ * @param parameter_values[num_batch*num_params]: parameter vectors, one after the other
+ * @param num_batch: number of parameter vectors
+ * @param flux[num_batch*num_flux_bins]: output flux, one spectrum after the other
+ *                    - for convolution models this is also the input flux
+ * @param num_flux_bins
+ * @param energy[num_flux_bins+1]: input energy grid (the same for all parameter vectors)
+ * @param batch_stats: [optional output] statistics of the shared stages in this batch
+ */
+void eval_model_batch(ModelName model_name,
+                      const double *parameter_values,
+                      int num_batch,
+                      double *flux,
+                      int num_flux_bins,
+                      const double *energy,
+                      BatchStatistics *batch_stats) {
+
+  size_t num_params;
+  try {
+    num_params = ModelDatabase::instance().param_list(model_name).num_params();
+  } catch (ModelNotFound &e) {
+    std::cout << e.what();
+    return;
+  }
+
+  BatchStatistics stats;
+  const auto tasks = get_cache_affinity_tasks(model_name, parameter_values, static_cast<size_t>(num_batch),
+                                              static_cast<size_t>(ThreadPool::instance().num_workers()), stats);
+
+  if (is_debug_run()) {
+    printf(" *** batch of %i evaluations: %i groups in %i tasks, sharing the relat. stages for %i and the xillver "
+           "stages for %i evaluations\n",
+           stats.num_evaluations, stats.num_groups, stats.num_tasks, stats.num_rel_shared, stats.num_xill_shared);
+  }
+
+  // the calls are recorded in the order of the batch (and not in the order they are evaluated by the workers)
+  for (size_t ii = 0; ii < static_cast<size_t>(num_batch); ii++) {
+    record_model_call(model_name, &parameter_values[ii * num_params], num_flux_bins, energy);
+  }
+
+  ThreadPool::instance().parallel_for(tasks.size(), [&](size_t itask) {
+    for (auto ii: tasks[itask]) {
+      try {
+        LocalModel local_model{&parameter_values[ii * num_params], model_name};
+
+        XspecSpectrum spectrum{energy, &flux[ii * num_flux_bins], static_cast<size_t>(num_flux_bins)};
+        local_model.eval_model(spectrum);
+
+      } catch (ModelNotFound &e) {
+        std::cout << e.what();
+      } catch (ParamInputException &e) {
+        std::cout << static_cast<const std::exception &>(e).what();
+      }
+    }
+  });
+
+  if (batch_stats != nullptr) {
+    *batch_stats = stats;
+  }
+
+}
+
+
+/**
+ * compare parameters exactly (instead of with CACHE_LIMIT) in the calling thread, as long as the
+ * object exists
+ */
+class ExactCacheComparison {
+ public:
+  ExactCacheComparison() : m_cache_limit{get_cache_limit()} {
+    set_cache_limit(0.0);
+  }
+  ~ExactCacheComparison() {
+    set_cache_limit(m_cache_limit);
+  }
+  ExactCacheComparison(const ExactCacheComparison &other) = delete;
+  ExactCacheComparison &operator=(const ExactCacheComparison &other) = delete;
+
+ private:
+  double m_cache_limit;
+};
+
+/**
+ * Evaluate the model at a base point and for a step in each parameter (e.g., for a numerical gradient)
+ * @details All N+1 spectra are calculated in the calling thread, comparing the parameters exactly, such that
+ * any step (even below CACHE_LIMIT) leads to a different spectrum. The steps are ordered by the stages they
+ * change: first the ones not affecting any cached stage, then the ones changing only the relativistic
+ * stage (re-using the xillver spectra of the base point), and then the ones changing only the xillver stage
+ * (re-using the relline profile of the base point). Parameters with a step size of zero are not evaluated,
+ * but return the spectrum of the base point.
+ * @param model_name: unique name of the model
+ * @param base_values[num_params]: parameters of the base point
+ * @param step_sizes[num_params]: step for each parameter
+ * @param flux[(num_params+1)*num_flux_bins]: output flux, first the base point, followed by one spectrum
+ *                    for a step in each parameter
+ *                    - for convolution models flux[0:num_flux_bins] is also the input flux
+ * @param num_flux_bins
+ * @param energy[num_flux_bins+1]: input energy grid
+ */
+void eval_model_gradient_sweep(ModelName model_name,
+                               const double *base_values,
+                               const double *step_sizes,
+                               double *flux,
+                               int num_flux_bins,
+                               const double *energy) {
+
+  size_t num_params;
+  try {
+    num_params = ModelDatabase::instance().param_list(model_name).num_params();
+  } catch (ModelNotFound &e) {
+    std::cout << e.what();
+    return;
+  }
+  const auto nbins = static_cast<size_t>(num_flux_bins);
+
+  // for convolution models, every spectrum is calculated from the same input flux
+  for (size_t ii = 1; ii <= num_params; ii++) {
+    std::copy(flux, flux + nbins, &flux[ii * nbins]);
+  }
+
+  ExactCacheComparison exact_comparison;
+
+  std::vector<double> param_values(base_values, base_values + num_params);
+  const auto key_base = get_batch_cache_key(base_values, model_name);
+
+  std::vector<std::pair<SweepStage, size_t>> steps;
+  for (size_t ii = 0; ii < num_params; ii++) {
+    if (step_sizes[ii] != 0.0) {
+      param_values[ii] = base_values[ii] + step_sizes[ii];
+      steps.emplace_back(get_sweep_stage(key_base, get_batch_cache_key(param_values.data(), model_name)), ii);
+      param_values[ii] = base_values[ii];
+    }
+  }
+  std::stable_sort(steps.begin(), steps.end(), [](const auto &step1, const auto &step2) {
+    return step1.first < step2.first;
+  });
+
+  {
+    LocalModel local_model{base_values, model_name};
+    XspecSpectrum spectrum{energy, flux, nbins};
+    local_model.eval_model(spectrum);
+  }
+
+  for (size_t ii = 0; ii < num_params; ii++) {
+    if (step_sizes[ii] == 0.0) {
+      std::copy(flux, flux + nbins, &flux[(ii + 1) * nbins]);
+    }
+  }
+
+  for (const auto &step: steps) {
+    const auto ipar = step.second;
+    param_values[ipar] = base_values[ipar] + step_sizes[ipar];
+
+    LocalModel local_model{param_values.data(), model_name};
+    XspecSpectrum spectrum{energy, &flux[(ipar + 1) * nbins], nbins};
+    local_model.eval_model(spectrum);
+
+    param_values[ipar] = base_values[ipar];
+  }
+
+  if (is_debug_run()) {
+    int num_stage[4] = {0, 0, 0, 0};
+    for (const auto &step: steps) {
+      num_stage[static_cast<int>(step.first)]++;
+    }
+    printf(" *** gradient sweep of %zu parameters: %i without re-computation, %i only relat., %i only xillver, "
+           "%i both stages\n", steps.size(), num_stage[0], num_stage[1], num_stage[2], num_stage[3]);
+  }
+
+}
@@ -19,6 +19,8 @@
 #ifndef RELXILL__CPPMODELS_H_
 #define RELXILL__CPPMODELS_H_
 
+#include <cassert>
+#include <iostream>
 #include <utility>
 #include <valarray>
 #include <string>
@@ -34,6 +36,8 @@ extern "C" {
 #include "Relxill.h"
 #include "ModelDatabase.h"
 #include "ModelParams.h"
+#include "Profiling.h"
+#include "FitTrace.h"
 
 /**
  * exception if the model evaluation failed
@@ -102,23 +106,46 @@ class LocalModel {
     /**
      * Evaluate the LocalModel (in the Rest Frame of the Source)
      * (applies the redshift to the energy grid)
+     * @details dispatches once on the model name to the evaluation specialized for this model
      * @param spectrum
      * @output spectrum.flux
      */
     void eval_model(XspecSpectrum &spectrum) {
+      visit_model_name(m_model_params.get_model_name(), [this, &spectrum](auto model_name) {
+        this->eval_model_specialized<decltype(model_name)::value>(spectrum);
+      });
+    }
+
+    /**
+     * Evaluate the LocalModel, specialized at compile time for the type of the model (see lmodel_info)
+     * @details stages not used by the model (e.g., the xillver stage for relline) are not instantiated
+     * @param spectrum
+     * @output spectrum.flux
+     */
+    template<ModelName name>
+    void eval_model_specialized(XspecSpectrum &spectrum) {
+      constexpr ModelInfo model_info = lmodel_info(name);
+      assert(m_model_params.get_model_name() == name);
+
+      ProfileTimer timer{PROF_EVAL_MODEL};
+      if (is_tracing_enabled()) {
+        timer.set_args(get_trace_args());
+      }
 
       spectrum.shift_energy_grid_redshift(m_model_params.get_otherwise_default(XPar::z,0));
 
       try {
-        switch (m_model_params.model_type()) {
-          case T_Model::Line: line_model(spectrum);
-            break;
-          case T_Model::Relxill: relxill_model(spectrum);
-            break;
-          case T_Model::Conv: conv_model(spectrum);
-            break;
-          case T_Model::Xill: xillver_model(spectrum);
-            break;
+        if constexpr (model_info.type() == T_Model::Line) {
+          line_model(spectrum);
+        } else if constexpr (model_info.type() == T_Model::Relxill && model_info.irradiation() == T_Irrad::Const) {
+          relxill_bb_model(spectrum);
+        } else if constexpr (model_info.type() == T_Model::Relxill) {
+          relxill_model(spectrum);
+        } else if constexpr (model_info.type() == T_Model::Conv) {
+          conv_model(spectrum);
+        } else {
+          static_assert(model_info.type() == T_Model::Xill, "model type not implemented");
+          xillver_model(spectrum);
         }
       } catch (std::exception &e) {
         std::cout << e.what() << std::endl;
@@ -139,18 +166,19 @@ class LocalModel {
   }
 
  private:
+  /** model name and parameter vector (in the order of the Xspec definition) as arguments of a trace event */
+  std::string get_trace_args();
+
   ModelParams m_model_params;
 
-  void line_model(const XspecSpectrum &spectrum);
+  void line_model(XspecSpectrum &spectrum);
   void relxill_model(const XspecSpectrum &spectrum);
+  void relxill_bb_model(const XspecSpectrum &spectrum);
   void conv_model(const XspecSpectrum &spectrum);
   void xillver_model(const XspecSpectrum &spectrum);
 
   void set_input_params(const double *inp_par_values) {
-    auto parnames = m_model_params.get_parnames();
-    for (size_t ii = 0; ii < m_model_params.num_params() ; ++ii){
-      m_model_params.set_par(parnames[ii], inp_par_values[ii]);
-    }
+    m_model_params.set_values(inp_par_values);
   }
 
 };
@@ -161,6 +189,64 @@ void xspec_C_wrapper_eval_model(ModelName model_name,
                                 int num_flux_bins,
                                 const double *xspec_energy);
 
+/**
+ * Wrapper function for a model known at compile time (as called by the generated Xspec wrapper), which
+ * evaluates the specialized model without any runtime dispatch on the type of the model
+ * (see xspec_C_wrapper_eval_model(ModelName, ...) for the parameters)
+ */
+template<ModelName model_name>
+void xspec_C_wrapper_eval_model(const double *parameter_values,
+                                double *xspec_flux,
+                                int num_flux_bins,
+                                const double *xspec_energy) {
+
+  try {
+    LocalModel local_model{parameter_values, model_name};
+    record_model_call(model_name, parameter_values, num_flux_bins, xspec_energy);
+
+    XspecSpectrum spectrum{xspec_energy, xspec_flux, static_cast<size_t>(num_flux_bins)};
+    local_model.eval_model_specialized<model_name>(spectrum);
+
+  } catch (ModelNotFound &e) {
+    std::cout << e.what();
+  }
+
+}
+
+/**
+ * statistics of a batch evaluation, showing how many evaluations could re-use the cached
+ * stages of the previous evaluation on the same worker
+ */
+struct BatchStatistics {
+  int num_evaluations = 0;
+  int num_groups = 0;       // groups of identical relativistic parameters
+  int num_tasks = 0;        // contiguous parts of the groups, each evaluated by one worker
+  int num_rel_shared = 0;   // evaluations sharing system parameters and relline profile with the previous one
+  int num_xill_shared = 0;  // evaluations sharing the xillver spectra with the previous one
+};
+
+/** split a batch into the tasks of num_workers workers, such that cached stages are shared (@throw ModelNotFound) */
+std::vector<std::vector<size_t>> get_cache_affinity_tasks(ModelName model_name,
+                                                          const double *parameter_values,
+                                                          size_t num_batch,
+                                                          size_t num_workers,
+                                                          BatchStatistics &batch_stats);
+
+void eval_model_batch(ModelName model_name,
+                      const double *parameter_values,
+                      int num_batch,
+                      double *flux,
+                      int num_flux_bins,
+                      const double *energy,
+                      BatchStatistics *batch_stats = nullptr);
+
+void eval_model_gradient_sweep(ModelName model_name,
+                               const double *base_values,
+                               const double *step_sizes,
+                               double *flux,
+                               int num_flux_bins,
+                               const double *energy);
+
 
 
 
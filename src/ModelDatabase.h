@@ -47,6 +47,45 @@ class ModelNotFound : public std::exception {
   std::string m_msg{"*** model not found: "};
 };
 
+/**
+ * @brief type of the model and its relevant physical components
+ * @details constexpr, such that the evaluation of a model can be specialized at compile time
+ * (see LocalModel::eval_model_specialized)
+ * @throw ModelNotFound if no type is defined for the model
+ */
+constexpr ModelInfo lmodel_info(ModelName name) {
+  switch (name) {
+    case ModelName::relline: return {T_Model::Line, T_Irrad::BknPowerlaw};
+    case ModelName::relline_lp: return {T_Model::Line, T_Irrad::LampPost};
+
+    case ModelName::relconv_lp: return {T_Model::Conv, T_Irrad::LampPost};
+    case ModelName::relconv: return {T_Model::Conv, T_Irrad::BknPowerlaw};
+
+    case ModelName::relxill: return {T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::CutoffPl};
+    case ModelName::relxillCO: return {T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::CutoffPl};
+    case ModelName::relxillNS: return {T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::Blackbody};
+    case ModelName::relxillCp: return {T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::Nthcomp};
+    case ModelName::relxillD: return {T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::CutoffPl};
+
+    case ModelName::relxilllp: return {T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::CutoffPl};
+    case ModelName::relxilllpion: return {T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::CutoffPl};
+    case ModelName::relxilllpCp: return {T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::Nthcomp};
+    case ModelName::relxilllpD: return {T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::CutoffPl};
+    case ModelName::relxilllpionCp: return {T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::Nthcomp};
+
+    case ModelName::relxilllpAlpha: return {T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::Nthcomp};
+
+    case ModelName::xillver: return {T_Model::Xill, T_PrimSpec::CutoffPl};
+    case ModelName::xillverD: return {T_Model::Xill, T_PrimSpec::CutoffPl};
+    case ModelName::xillverCp: return {T_Model::Xill, T_PrimSpec::Nthcomp};
+    case ModelName::xillverCO: return {T_Model::Xill, T_PrimSpec::CutoffPl};
+    case ModelName::xillverNS: return {T_Model::Xill, T_PrimSpec::Blackbody};
+
+    case ModelName::relxillBB: return {T_Model::Relxill, T_Irrad::Const, T_PrimSpec::Blackbody};
+  }
+  throw ModelNotFound(XspecModelDatabase::param_layout(name).name);
+}
+
 /**
  * @brief not a real class, but rather a global database (container) for all possible
  * local models with, using instances of the class "ModelDefinition":
@@ -72,11 +111,7 @@ class ModelDatabase {
    * @return ModelInfo
    */
   ModelInfo model_info(ModelName name){
-    try {
-      return lmodel_info.at(name);
-    } catch (std::out_of_range &e) {
-      throw ModelNotFound(lmodel_database.name_string(name));
-    }
+    return lmodel_info(name);
   }
 
   /**
@@ -97,14 +132,8 @@ class ModelDatabase {
   }
 
   std::vector<double> get_default_values_array(ModelName name){
-    auto param_list = lmodel_database.param_list(name);
-    auto parnames = param_list.get_parnames();
-    const auto num_param = param_list.num_params();
-    std::vector<double> values;
-    for (size_t ii = 0; ii <  num_param; ++ii){
-      values.push_back(param_list[parnames[ii]]);
-    }
-    return values;
+    const auto &layout = XspecModelDatabase::param_layout(name);
+    return {layout.default_values, layout.default_values + layout.num_params};
   }
 
   ModelName model_name(const std::string& model_string){
@@ -133,36 +162,6 @@ class ModelDatabase {
   // stores all scanned information from the lmodel.dat file (automatically created Class)
   XspecModelDatabase lmodel_database{}; //
 
-  const std::unordered_map<ModelName, ModelInfo> lmodel_info = {
-      {ModelName::relline, ModelInfo(T_Model::Line, T_Irrad::BknPowerlaw)},
-      {ModelName::relline_lp, ModelInfo(T_Model::Line, T_Irrad::LampPost)},
-
-      {ModelName::relconv_lp, ModelInfo(T_Model::Conv, T_Irrad::LampPost)},
-      {ModelName::relconv, ModelInfo(T_Model::Conv, T_Irrad::BknPowerlaw)},
-
-      {ModelName::relxill, ModelInfo(T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::CutoffPl)},
-      {ModelName::relxillCO, ModelInfo(T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::CutoffPl)},
-      {ModelName::relxillNS, ModelInfo(T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::Blackbody)},
-      {ModelName::relxillCp, ModelInfo(T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::Nthcomp)},
-      {ModelName::relxillD, ModelInfo(T_Model::Relxill, T_Irrad::BknPowerlaw, T_PrimSpec::CutoffPl)},
-
-      {ModelName::relxilllp, ModelInfo(T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::CutoffPl)},
-      {ModelName::relxilllpion, ModelInfo(T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::CutoffPl)},
-      {ModelName::relxilllpCp, ModelInfo(T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::Nthcomp)},
-      {ModelName::relxilllpD, ModelInfo(T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::CutoffPl)},
-      {ModelName::relxilllpionCp, ModelInfo(T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::Nthcomp)},
-
-      {ModelName::relxilllpAlpha, ModelInfo(T_Model::Relxill, T_Irrad::LampPost, T_PrimSpec::Nthcomp)},
-
-      {ModelName::xillver, ModelInfo(T_Model::Xill, T_PrimSpec::CutoffPl)},
-      {ModelName::xillverD, ModelInfo(T_Model::Xill, T_PrimSpec::CutoffPl)},
-      {ModelName::xillverCp, ModelInfo(T_Model::Xill, T_PrimSpec::Nthcomp)},
-      {ModelName::xillverCO, ModelInfo(T_Model::Xill, T_PrimSpec::CutoffPl)},
-      {ModelName::xillverNS, ModelInfo(T_Model::Xill, T_PrimSpec::Blackbody)},
-
-      {ModelName::relxillBB, ModelInfo(T_Model::Relxill, T_Irrad::Const, T_PrimSpec::Blackbody)},
-
-  };
 };
 
 
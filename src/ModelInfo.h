@@ -78,27 +78,27 @@ enum class T_Model {
 class ModelInfo {
 
  public:
-  ModelInfo(T_Model _type, T_Irrad _irrad, T_PrimSpec _prim)
+  constexpr ModelInfo(T_Model _type, T_Irrad _irrad, T_PrimSpec _prim)
       : m_type{_type}, m_irradiation{_irrad}, m_primeSpec{_prim} {
   };
 
-  ModelInfo(T_Model type, T_Irrad irrad)
+  constexpr ModelInfo(T_Model type, T_Irrad irrad)
       : ModelInfo(type, irrad, T_PrimSpec::None) {
   };
 
-  ModelInfo(T_Model type, T_PrimSpec prim)
+  constexpr ModelInfo(T_Model type, T_PrimSpec prim)
       : ModelInfo(type, T_Irrad::None, prim) {
   };
 
-  [[nodiscard]] T_Model type() const {
+  [[nodiscard]] constexpr T_Model type() const {
     return m_type;
   }
 
-  [[nodiscard]] T_Irrad irradiation() const {
+  [[nodiscard]] constexpr T_Irrad irradiation() const {
     return m_irradiation;
   }
 
-  [[nodiscard]] T_PrimSpec primeSpec() const {
+  [[nodiscard]] constexpr T_PrimSpec primeSpec() const {
     return m_primeSpec;
   }
 
@@ -19,6 +19,8 @@
 #ifndef RELXILL_SRC_MODELPARAMS_H_
 #define RELXILL_SRC_MODELPARAMS_H_
 
+#include <algorithm>
+#include <array>
 #include <string>
 #include <cassert>
 #include <iostream>
@@ -104,73 +106,99 @@ const double *get_xspec_default_parameter_array(ModelName model_name);
 
 
 
+constexpr size_t NUM_XPAR = static_cast<size_t>(XPar::mass) + 1;  // XPar::mass needs to be the last parameter
+constexpr size_t MAX_NUM_PARAMS = 32;  // maximal number of parameters of a model
+
 /**
- * @brief class storing the name and the parameter list
- * - used by the python script from the lmodel.dat file to create the xspec_wrapper
+ * @brief compile-time layout of the parameters of a model (created by the python script from the lmodel.dat file)
+ * - parameter names and default values are given in the order of the Xspec definition
+ * - slot[XPar] gives the index of a parameter in this order (-1 if the model does not have this parameter)
  */
+struct ParamLayout {
+
+  template<size_t N>
+  constexpr ParamLayout(ModelName _model_name, const char *_name,
+                        const XPar (&_parnames)[N], const double (&_default_values)[N]) :
+      model_name{_model_name}, name{_name}, num_params{N}, parnames{_parnames},
+      default_values{_default_values}, slot{} {
+    static_assert(N <= MAX_NUM_PARAMS, "too many parameters, increase MAX_NUM_PARAMS");
+    for (size_t ii = 0; ii < NUM_XPAR; ii++) {
+      slot[ii] = -1;
+    }
+    for (size_t ii = 0; ii < N; ii++) {
+      slot[static_cast<size_t>(_parnames[ii])] = static_cast<int>(ii);
+    }
+  }
+
+  [[nodiscard]] constexpr int slot_of(XPar par) const {
+    return slot[static_cast<size_t>(par)];
+  }
+
+  ModelName model_name;
+  const char *name;
+  size_t num_params;
+  const XPar *parnames;
+  const double *default_values;
+  std::array<int, NUM_XPAR> slot;
+};
 
 /**
  * class to store all input parameters of the model (explicit or hidden)
+ * - the values are stored in a flat array in the order of the Xspec definition, the access to a
+ *   parameter is given by the ParamLayout of the model (no allocation and no lookup in a map)
  */
 class ParamList {
 
  public:
 
-  explicit ParamList( std::vector<XPar> parnames, std::vector<double> parvalues) :
-      m_parnames{std::move(parnames)}
-  {
-
-    for (size_t ii = 0; ii < m_parnames.size() ; ++ii){
-      m_param.insert(std::make_pair(m_parnames[ii],parvalues[ii]));
-    }
+  explicit ParamList(const ParamLayout &layout) : m_layout{&layout} {
+    std::copy(layout.default_values, layout.default_values + layout.num_params, m_values.begin());
   }
 
   void set_par(XPar name, double value){
-    try {
-      m_param.at(name) = value;
-    } catch (std::out_of_range &e){
-      throw ParamInputException("parameter not found");
-    }
+    m_values[get_slot(name)] = value;
   }
 
-  auto get_par(XPar name) const{
-    try {
-      return m_param.at(name);
-    } catch (std::out_of_range &e){
-      throw ParamInputException("parameter not found");
-    }
+  /** set all parameter values (given in the order of the Xspec definition) */
+  void set_values(const double *values) {
+    std::copy(values, values + m_layout->num_params, m_values.begin());
   }
 
+  double get_par(XPar name) const{
+    return m_values[get_slot(name)];
+  }
 
-  auto &operator[](const XPar &name) const {
-    try {
-      return m_param.at(name);
-    } catch (std::exception &e){
-      throw ParamInputException("parameter not found");
-    }
+  const double &operator[](const XPar &name) const {
+    return m_values[get_slot(name)];
   }
 
-  auto num_params(){
-    return m_parnames.size();
+  [[nodiscard]] size_t num_params() const{
+    return m_layout->num_params;
   }
 
-  bool does_parameter_exist(const XPar &name) const {
-    if (m_param.find(name) != m_param.end()){
-      return true;
-    } else {
-      return false;
-    }
+  [[nodiscard]] bool does_parameter_exist(const XPar &name) const {
+    return m_layout->slot_of(name) >= 0;
   }
 
-  auto get_parnames(){
-    return m_parnames;
+  [[nodiscard]] std::vector<XPar> get_parnames() const{
+    return {m_layout->parnames, m_layout->parnames + m_layout->num_params};
   }
 
+  [[nodiscard]] const ParamLayout &layout() const {
+    return *m_layout;
+  }
 
  private:
-  std::vector<XPar> m_parnames = {};  // need this as this needs to be in order given by Xspec TODO: could be fixed in xspec_wrapper
- protected:
-  std::unordered_map<XPar, double> m_param = {};
+  [[nodiscard]] size_t get_slot(XPar name) const {
+    const int slot = m_layout->slot_of(name);
+    if (slot < 0) {
+      throw ParamInputException("parameter not found");
+    }
+    return static_cast<size_t>(slot);
+  }
+
+  const ParamLayout *m_layout;
+  std::array<double, MAX_NUM_PARAMS> m_values{};
 };
 
 
@@ -207,7 +235,7 @@ class ModelParams: public ParamList{
    */
   double get_otherwise_default(const XPar &name, double def_value) const {
     if (does_parameter_exist(name) ){
-      return m_param.at(name);
+      return get_par(name);
     } else {
       return def_value;
     }
@@ -0,0 +1,132 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "Nthcomp.h"
+#include "Profiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+extern "C" {
+#include "common.h"
+#include "relutility.h"
+}
+
+// the nthcomp implementation (translated from Fortran) uses static variables and is not re-entrant
+static std::mutex donthcomp_mutex;
+
+void nthcomp_spectrum(double *photar, const double *ener, int n_ener, double gam, double kTe, double z) {
+
+  ProfileTimer timer{PROF_NTHCOMP};
+
+  if (use_nthcomp_table() && NthcompTable::is_in_grid(gam, kTe)) {
+    NthcompTable::instance().eval(photar, ener, n_ener, gam, kTe, z);
+    return;
+  }
+
+  double nthcomp_param[5];
+  get_nthcomp_param(nthcomp_param, gam, kTe, z);
+  std::lock_guard<std::mutex> lock(donthcomp_mutex);
+  c_donthcomp(ener, n_ener, nthcomp_param, photar);
+}
+
+const NthcompTable::Node &NthcompTable::get_node(int igam, int ikte) {
+
+  std::lock_guard<std::mutex> lock(donthcomp_mutex);
+
+  auto &node = m_nodes[igam * num_kte + ikte];
+  prof_cache_access(PROF_CACHE_NTHCOMP_TABLE, node != nullptr);
+  if (node == nullptr) {
+    const double gam = gam_min + (gam_max - gam_min) * igam / (num_gam - 1);
+    const double kte = kte_min * pow(kte_max / kte_min, static_cast<double>(ikte) / (num_kte - 1));
+
+    double nthcomp_param[5];
+    get_nthcomp_param(nthcomp_param, gam, kte, 0.0);
+
+    double xth[900];
+    double spt[900];
+    int nth;
+    c_nthcomp_intrinsic(nthcomp_param, xth, &nth, spt);
+
+    std::vector<double> log_spt(nth, 0.0);
+    for (int ii = 0; ii < nth; ii++) {
+      log_spt[ii] = (spt[ii] > 0) ? log(spt[ii]) : 0.0;
+    }
+    node.reset(new Node{std::vector<double>(xth, xth + nth), std::vector<double>(spt, spt + nth), log_spt});
+  }
+  return *node;
+}
+
+int NthcompTable::num_computed_nodes() {
+  std::lock_guard<std::mutex> lock(donthcomp_mutex);
+  return static_cast<int>(std::count_if(m_nodes.begin(), m_nodes.end(), [](const auto &node) {
+    return node != nullptr;
+  }));
+}
+
+void NthcompTable::eval(double *photar, const double *ener, int n_ener, double gam, double kTe, double z) {
+
+  const double fgam = (gam - gam_min) / (gam_max - gam_min) * (num_gam - 1);
+  const double fkte = log(kTe / kte_min) / log(kte_max / kte_min) * (num_kte - 1);
+  const int ikte = std::min(static_cast<int>(fkte), num_kte - 2);
+  const double wkte = fkte - ikte;
+
+  // cubic (Lagrange) interpolation in Gamma, i.e., using the 4 closest nodes
+  const int igam = std::max(0, std::min(static_cast<int>(fgam) - 1, num_gam - 4));
+  const double tt = fgam - igam;
+  const double wgam[4] = {-(tt - 1) * (tt - 2) * (tt - 3) / 6, tt * (tt - 2) * (tt - 3) / 2,
+                          -tt * (tt - 1) * (tt - 3) / 2, tt * (tt - 1) * (tt - 2) / 6};
+
+  const Node *node[8];
+  double weight[8];
+  for (int kk = 0; kk < 4; kk++) {
+    node[2 * kk] = &get_node(igam + kk, ikte);
+    node[2 * kk + 1] = &get_node(igam + kk, ikte + 1);
+    weight[2 * kk] = wgam[kk] * (1 - wkte);
+    weight[2 * kk + 1] = wgam[kk] * wkte;
+  }
+
+  // the energy grid of all nodes is the same, but extends to higher energies for a larger kTe
+  const auto *node_max = *std::max_element(node, node + 8, [](const Node *n1, const Node *n2) {
+    return n1->xth.size() < n2->xth.size();
+  });
+  const auto nth = node_max->xth.size();
+
+  std::vector<double> spt(nth, 0.0);
+  for (size_t jj = 0; jj < nth; jj++) {
+    bool is_positive = true;
+    for (int kk = 0; kk < 8; kk++) {
+      is_positive = is_positive && jj < node[kk]->spt.size() && node[kk]->spt[jj] > 0;
+    }
+
+    // logarithmic interpolation is exact for a power law, only the cutoff is interpolated linearly
+    if (is_positive) {
+      for (int kk = 0; kk < 8; kk++) {
+        spt[jj] += weight[kk] * node[kk]->log_spt[jj];
+      }
+      spt[jj] = exp(spt[jj]);
+    } else {
+      for (int kk = 0; kk < 8; kk++) {
+        spt[jj] += (jj < node[kk]->spt.size()) ? weight[kk] * node[kk]->spt[jj] : 0.0;
+      }
+    }
+  }
+
+  c_nthcomp_rebin(ener, n_ener, z, node_max->xth.data(), static_cast<int>(nth), spt.data(), photar);
+}
@@ -0,0 +1,88 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#ifndef RELXILL_SRC_NTHCOMP_H_
+#define RELXILL_SRC_NTHCOMP_H_
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief nthcomp spectrum (in counts/bin, normalized to 1 at 1keV) on the energy grid ener[n_ener+1]
+ * @details By default the Kompaneets equation is solved for every call (c_donthcomp). If the ENV
+ * variable RELXILL_NTHCOMP_TABLE=1 is set, the spectrum is interpolated from the NthcompTable
+ * (for parameters outside of the table it is still calculated directly).
+ * @param kTe: electron temperature in keV
+ * @param z: redshift applied to the spectrum
+ */
+void nthcomp_spectrum(double *photar, const double *ener, int n_ener, double gam, double kTe, double z);
+
+/**
+ * @brief nthcomp spectrum without solving the Kompaneets equation, by interpolating the intrinsic
+ * spectra tabulated on a grid in Gamma (linear) and kTe (logarithmic)
+ * @details A node of the grid is calculated on first use and stored for the rest of the session. The
+ * logarithm of the flux is interpolated cubically in Gamma and linearly in log(kTe), and afterwards
+ * rebinned exactly as done by c_donthcomp. The seed photon temperature is fixed to kTbb=0.05keV (see
+ * get_nthcomp_param). The deviation from the direct calculation is below 1% for E<3kTe (see
+ * tests-nthcomp.cpp).
+ */
+class NthcompTable {
+
+ public:
+  static NthcompTable &instance() {
+    static auto *instance = new NthcompTable();
+    return *instance;
+  }
+
+  NthcompTable(const NthcompTable &other) = delete;
+  NthcompTable &operator=(const NthcompTable &other) = delete;
+
+  static constexpr int num_gam = 49;
+  static constexpr double gam_min = 1.0;
+  static constexpr double gam_max = 3.4;
+
+  static constexpr int num_kte = 61;
+  static constexpr double kte_min = 1.0;
+  static constexpr double kte_max = 1000.0;
+
+  [[nodiscard]] static bool is_in_grid(double gam, double kTe) {
+    return gam >= gam_min && gam <= gam_max && kTe >= kte_min && kTe <= kte_max;
+  }
+
+  /** interpolated nthcomp spectrum (parameters need to be within the grid, see is_in_grid) */
+  void eval(double *photar, const double *ener, int n_ener, double gam, double kTe, double z);
+
+  /** number of grid nodes calculated so far */
+  [[nodiscard]] int num_computed_nodes();
+
+ private:
+  NthcompTable() : m_nodes(num_gam * num_kte) {
+  }
+
+  struct Node {
+    std::vector<double> xth;  // energy (units of m_e c^2)
+    std::vector<double> spt;  // spectrum (E F_E)
+    std::vector<double> log_spt;  // log(spt), only valid for spt>0
+  };
+
+  std::vector<std::unique_ptr<Node>> m_nodes;
+
+  const Node &get_node(int igam, int ikte);
+};
+
+#endif //RELXILL_SRC_NTHCOMP_H_
@@ -32,8 +32,8 @@ void PrimarySource::print_reflection_strength(const XspecSpectrum &refl_spec, co
 
   const relParam *rel_param = source_parameters.rel_param();
 
-  int const imin = binary_search(refl_spec.energy, refl_spec.num_flux_bins() + 1, RSTRENGTH_EMIN);
-  int const imax = binary_search(refl_spec.energy, refl_spec.num_flux_bins() + 1, RSTRENGTH_EMAX);
+  int const imin = binary_search(refl_spec.energy(), refl_spec.num_flux_bins() + 1, RSTRENGTH_EMIN);
+  int const imax = binary_search(refl_spec.energy(), refl_spec.num_flux_bins() + 1, RSTRENGTH_EMAX);
 
   double sum_pl = 0.0;
   double sum = 0.0;
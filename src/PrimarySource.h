@@ -232,7 +232,7 @@ class PrimarySource {
   Spectrum get_observed_primary_spectrum(const XspecSpectrum &_xspec_spec,
                                          const PrimarySourceParameters &_parameters) {
     int status = EXIT_SUCCESS;
-    auto spec = Spectrum(_xspec_spec.energy, _xspec_spec.num_flux_bins());
+    auto spec = Spectrum(_xspec_spec.energy(), _xspec_spec.num_flux_bins());
     calc_primary_spectrum(spec.flux, spec.energy(), spec.num_flux_bins,
                           _parameters.xilltab_param(), &status,
                           _parameters.energy_shift_source_observer());
@@ -274,13 +274,14 @@ class PrimarySource {
     // need to use a specific energy grid for the primary component normalization to
     // fulfill the XILLVER NORM condition (Dauser+2016)
     EnerGrid *egrid = get_coarse_xillver_energrid(&status);
-    auto prim_spec_source = new double[egrid->nbins];
-    calc_primary_spectrum(prim_spec_source, egrid->ener, egrid->nbins, source_parameters.xilltab_param(), &status);
+    static thread_local std::vector<double> prim_spec_source;  // only allocated once by each thread
+    prim_spec_source.resize(egrid->nbins);
+    calc_primary_spectrum(prim_spec_source.data(), egrid->ener, egrid->nbins, source_parameters.xilltab_param(),
+                          &status);
 
     // calculate the normalization at the primary source (i.e., not shifted by the energy shift)
     double const norm_factor_prim_spec =
-        1. / calcNormWrtXillverTableSpec(prim_spec_source, egrid->ener, egrid->nbins, &status);
-    delete[] prim_spec_source;
+        1. / calcNormWrtXillverTableSpec(prim_spec_source.data(), egrid->ener, egrid->nbins, &status);
     return norm_factor_prim_spec;
   }
 
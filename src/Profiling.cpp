@@ -0,0 +1,347 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "Profiling.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+extern "C" {
+#include "relutility.h"
+}
+
+static const char *const stage_names[PROF_NUM_STAGES] = {
+    "eval_model", "relxill_kernel", "get_system_parameters", "relbase_profile", "calc_relline_profile",
+    "xillver FITS load", "interp_xill_table", "fftw_conv_spectrum", "rebin_spectrum", "nthcomp"};
+
+static const char *const cache_names[PROF_NUM_CACHES] = {
+    "system parameters", "relline profile", "relxill relat. stage", "relxill xillver stage",
+    "relxill output spectrum", "xillver table spectra", "nthcomp table nodes",
+    "return rad. fractions", "relxillBB return spectra", "relconv FFT kernel",
+    "rebinning operators", "buffer pool", "lamp post emissivity"};
+
+static const char *const memory_names[PROF_NUM_MEMORY] = {
+    "relline table", "lamp post table", "return rad. table", "xillver tables", "cache nodes",
+    "spectrum cache (FFT)", "buffer pool"};
+
+// all counters are atomic, as the model can be evaluated by several threads
+struct StageStatistics {
+  std::atomic<long long> num_calls{0};
+  std::atomic<long long> time_ns{0};
+  std::atomic<long long> max_ns{0};
+};
+
+static StageStatistics stage_stats[PROF_NUM_STAGES];
+static std::atomic<long long> cache_hits[PROF_NUM_CACHES];
+static std::atomic<long long> cache_misses[PROF_NUM_CACHES];
+
+static std::atomic<long long> memory_bytes[PROF_NUM_MEMORY];
+static std::atomic<long long> memory_peak_bytes[PROF_NUM_MEMORY];
+
+static std::atomic<int> profiling_enabled{-1};  // -1: not yet initialized from ENV
+static std::atomic<int> tracing_enabled{-1};
+
+struct TraceEvent {
+  prof_stage stage;
+  int thread_id;
+  long long t_start;
+  long long duration;
+  std::string args;
+};
+
+// the trace is buffered in memory up to a maximal number of events
+#define TRACE_MAX_EVENTS 2000000
+static std::mutex trace_mutex;
+static std::vector<TraceEvent> trace_events;
+static std::atomic<long long> trace_t0{0};  // set once, by the thread initializing the tracing
+
+static std::atomic<int> num_trace_threads{0};
+static thread_local int trace_thread_id = -1;
+
+static long long get_time_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void init_profiling() {
+  int expected = -1;
+  int enabled = is_profiling_run();
+  if (profiling_enabled.compare_exchange_strong(expected, enabled) && enabled) {
+    atexit(print_profiling_report);
+  }
+}
+
+static void write_trace_at_exit() {
+  write_profiling_trace(get_relxill_trace_filename());
+}
+
+static void init_tracing() {
+  int expected = -1;
+  int enabled = (get_relxill_trace_filename() != nullptr) ? 1 : 0;
+  const long long t0 = get_time_ns();
+  if (tracing_enabled.compare_exchange_strong(expected, enabled)) {
+    trace_t0 = t0;
+    if (enabled) {
+      atexit(write_trace_at_exit);
+    }
+  }
+}
+
+int is_tracing_enabled(void) {
+  if (tracing_enabled.load(std::memory_order_relaxed) < 0) {
+    init_tracing();
+  }
+  return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+void set_tracing_enabled(int enabled) {
+  is_tracing_enabled();
+  tracing_enabled = (enabled != 0) ? 1 : 0;
+}
+
+int is_profiling_enabled(void) {
+  if (profiling_enabled.load(std::memory_order_relaxed) < 0) {
+    init_profiling();
+  }
+  return profiling_enabled.load(std::memory_order_relaxed);
+}
+
+void set_profiling_enabled(int enabled) {
+  is_profiling_enabled();
+  profiling_enabled = (enabled != 0) ? 1 : 0;
+}
+
+long long prof_start(void) {
+  if (!is_profiling_enabled() && !is_tracing_enabled()) {
+    return 0;
+  }
+  return get_time_ns();
+}
+
+static void add_trace_event(prof_stage stage, long long t_start, long long dt, const char *args) {
+  if (trace_thread_id < 0) {
+    trace_thread_id = num_trace_threads++;
+  }
+
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (trace_events.size() == TRACE_MAX_EVENTS) {
+    printf(" *** warning: maximal number of %i trace events reached, not recording any further events\n",
+           TRACE_MAX_EVENTS);
+  }
+  if (trace_events.size() >= TRACE_MAX_EVENTS) {
+    return;
+  }
+  trace_events.push_back({stage, trace_thread_id, t_start, dt, (args != nullptr) ? args : ""});
+}
+
+void prof_stop_args(prof_stage stage, long long t_start, const char *args) {
+  if (t_start == 0) {
+    return;
+  }
+  const long long dt = get_time_ns() - t_start;
+
+  if (is_tracing_enabled()) {
+    add_trace_event(stage, t_start, dt, args);
+  }
+
+  if (!is_profiling_enabled()) {
+    return;
+  }
+  auto &stats = stage_stats[stage];
+  stats.num_calls++;
+  stats.time_ns += dt;
+  long long max_ns = stats.max_ns.load(std::memory_order_relaxed);
+  while (dt > max_ns && !stats.max_ns.compare_exchange_weak(max_ns, dt)) {
+  }
+}
+
+void prof_stop(prof_stage stage, long long t_start) {
+  prof_stop_args(stage, t_start, nullptr);
+}
+
+void prof_cache_access(prof_cache cache, int is_hit) {
+  if (!is_profiling_enabled()) {
+    return;
+  }
+  if (is_hit) {
+    cache_hits[cache]++;
+  } else {
+    cache_misses[cache]++;
+  }
+}
+
+long long get_profiling_num_calls(prof_stage stage) {
+  return stage_stats[stage].num_calls;
+}
+
+double get_profiling_time_sec(prof_stage stage) {
+  return static_cast<double>(stage_stats[stage].time_ns) * 1e-9;
+}
+
+long long get_profiling_cache_hits(prof_cache cache) {
+  return cache_hits[cache];
+}
+
+long long get_profiling_cache_misses(prof_cache cache) {
+  return cache_misses[cache];
+}
+
+void prof_mem_add(prof_memory subsystem, long long nbytes) {
+  const long long current = (memory_bytes[subsystem] += nbytes);
+  long long peak = memory_peak_bytes[subsystem].load(std::memory_order_relaxed);
+  while (current > peak && !memory_peak_bytes[subsystem].compare_exchange_weak(peak, current)) {
+  }
+}
+
+long long get_memory_bytes(prof_memory subsystem) {
+  return memory_bytes[subsystem];
+}
+
+long long get_memory_peak_bytes(prof_memory subsystem) {
+  return memory_peak_bytes[subsystem];
+}
+
+const char *get_memory_subsystem_name(prof_memory subsystem) {
+  return memory_names[subsystem];
+}
+
+long long get_peak_rss_bytes(void) {
+  struct rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<long long>(usage.ru_maxrss);          // given in bytes
+#else
+  return static_cast<long long>(usage.ru_maxrss) * 1024;   // given in kilobytes
+#endif
+}
+
+long long get_current_rss_bytes(void) {
+  FILE *fp = fopen("/proc/self/statm", "r");  // only available on Linux
+  if (fp == nullptr) {
+    return 0;
+  }
+  long long num_pages_total = 0;
+  long long num_pages_resident = 0;
+  const int num_read = fscanf(fp, "%lld %lld", &num_pages_total, &num_pages_resident);
+  fclose(fp);
+  if (num_read != 2) {
+    return 0;
+  }
+  return num_pages_resident * sysconf(_SC_PAGESIZE);
+}
+
+const char *get_profiling_stage_name(prof_stage stage) {
+  return stage_names[stage];
+}
+
+const char *get_profiling_cache_name(prof_cache cache) {
+  return cache_names[cache];
+}
+
+void reset_profiling(void) {
+  for (auto &stats: stage_stats) {
+    stats.num_calls = 0;
+    stats.time_ns = 0;
+    stats.max_ns = 0;
+  }
+  for (int ii = 0; ii < PROF_NUM_CACHES; ii++) {
+    cache_hits[ii] = 0;
+    cache_misses[ii] = 0;
+  }
+}
+
+void print_profiling_report(void) {
+
+  printf("\n *** relxill profiling report (times of nested stages are included in the outer ones)\n");
+  printf("   %-24s %10s %12s %12s %12s\n", "stage", "calls", "total [ms]", "mean [us]", "max [us]");
+  for (int ii = 0; ii < PROF_NUM_STAGES; ii++) {
+    const long long num_calls = stage_stats[ii].num_calls;
+    if (num_calls == 0) {
+      continue;
+    }
+    const double time_ns = static_cast<double>(stage_stats[ii].time_ns);
+    printf("   %-24s %10lld %12.3f %12.3f %12.3f\n", stage_names[ii], num_calls, time_ns * 1e-6,
+           time_ns / static_cast<double>(num_calls) * 1e-3, static_cast<double>(stage_stats[ii].max_ns) * 1e-3);
+  }
+
+  printf("   %-24s %10s %12s %12s\n", "cache", "hits", "misses", "hit rate");
+  for (int ii = 0; ii < PROF_NUM_CACHES; ii++) {
+    const long long hits = cache_hits[ii];
+    const long long misses = cache_misses[ii];
+    if (hits + misses == 0) {
+      continue;
+    }
+    printf("   %-24s %10lld %12lld %11.1f%%\n", cache_names[ii], hits, misses,
+           100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses));
+  }
+
+  printf("   %-24s %12s %12s\n", "memory", "current [MB]", "peak [MB]");
+  for (int ii = 0; ii < PROF_NUM_MEMORY; ii++) {
+    printf("   %-24s %12.3f %12.3f\n", memory_names[ii], static_cast<double>(memory_bytes[ii]) * 1e-6,
+           static_cast<double>(memory_peak_bytes[ii]) * 1e-6);
+  }
+  printf("   %-24s %12.3f %12.3f\n", "resident (process)", static_cast<double>(get_current_rss_bytes()) * 1e-6,
+         static_cast<double>(get_peak_rss_bytes()) * 1e-6);
+  printf("\n");
+}
+
+long long get_num_trace_events(void) {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  return static_cast<long long>(trace_events.size());
+}
+
+int write_profiling_trace(const char *filename) {
+
+  if (filename == nullptr) {
+    return 1;
+  }
+
+  FILE *fp = fopen(filename, "w");
+  if (fp == nullptr) {
+    printf(" *** error: failed to open file %s for writing the trace\n", filename);
+    return 1;
+  }
+
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  fprintf(fp, "{\"traceEvents\": [\n");
+  for (size_t ii = 0; ii < trace_events.size(); ii++) {
+    const auto &event = trace_events[ii];
+    fprintf(fp, "  {\"name\": \"%s\", \"cat\": \"relxill\", \"ph\": \"X\", \"pid\": 1, \"tid\": %i, "
+                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {%s}}%s\n",
+            stage_names[event.stage], event.thread_id, static_cast<double>(event.t_start - trace_t0) * 1e-3,
+            static_cast<double>(event.duration) * 1e-3, event.args.c_str(),
+            (ii + 1 < trace_events.size()) ? "," : "");
+  }
+  fprintf(fp, "],\n\"displayTimeUnit\": \"ms\"}\n");
+  fclose(fp);
+
+  if (is_debug_run()) {
+    printf(" *** wrote %zu trace events to %s\n", trace_events.size(), filename);
+  }
+  return 0;
+}
@@ -0,0 +1,155 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#ifndef RELXILL_SRC_PROFILING_H_
+#define RELXILL_SRC_PROFILING_H_
+
+/**
+ * Profiling of the model evaluation: timers for the main stages and hit/miss counters for the caches.
+ * Enabled by the ENV variable RELXILL_PROFILE=1, in which case a report is printed at exit (or on demand
+ * by print_profiling_report). If disabled, a timer only costs a check of a flag.
+ *
+ * Additionally, every timed stage can be recorded as a trace event (e.g., to see which evaluation of a
+ * fit loaded a spectrum from the FITS file). If the ENV variable RELXILL_TRACE=<filename> is set, the
+ * events are buffered in memory and written as Chrome trace JSON (viewable in Perfetto or
+ * chrome://tracing) at exit, or on demand by write_profiling_trace.
+ *
+ * The memory of the tables and caches is accounted per subsystem (always, independent of RELXILL_PROFILE),
+ * such that the current and peak usage can be queried at runtime. It is included in the report together
+ * with the peak resident memory of the process.
+ *
+ * Usage (C):   long long t0 = prof_start();  ...  prof_stop(PROF_REBIN, t0);
+ * Usage (C++): ProfileTimer timer{PROF_REBIN};
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  PROF_EVAL_MODEL,
+  PROF_RELXILL_KERNEL,
+  PROF_SYSTEM_PARAMETERS,
+  PROF_RELBASE_PROFILE,
+  PROF_RELLINE_PROFILE,
+  PROF_XILLTAB_FITS_LOAD,
+  PROF_XILLTAB_INTERP,
+  PROF_FFT_CONV,
+  PROF_REBIN,
+  PROF_NTHCOMP,
+  PROF_NUM_STAGES
+} prof_stage;
+
+typedef enum {
+  PROF_CACHE_SYSPAR,          // system parameters (interpolated relline table and emissivity)
+  PROF_CACHE_RELBASE,         // relline profile
+  PROF_CACHE_RELXILL_RELAT,   // relativistic stage of the relxill kernel
+  PROF_CACHE_RELXILL_XILL,    // xillver spectra of the relxill kernel
+  PROF_CACHE_RELXILL_SPEC,    // full output spectrum of the relxill kernel
+  PROF_CACHE_XILLTAB_SPEC,    // single spectra of the xillver table (miss: loaded from the FITS file)
+  PROF_CACHE_NTHCOMP_TABLE,   // nodes of the nthcomp table
+  PROF_CACHE_RRAD_FRACTIONS,  // interpolated fractions of the return radiation table
+  PROF_CACHE_BBRET_SPEC,      // returning black body spectra of the relxillBB kernel
+  PROF_CACHE_RELCONV_KERNEL,  // Fourier transformed relline profile of the relconv kernel
+  PROF_CACHE_REBIN_OPERATOR,  // rebinning operators between two energy grids
+  PROF_CACHE_BUFFER_POOL,     // blocks of the memory pool for 2D arrays (miss: allocated)
+  PROF_CACHE_LP_EMIS,         // emissivity profile of the lamp post source
+  PROF_NUM_CACHES
+} prof_cache;
+
+typedef enum {
+  PROF_MEM_RELTABLE,          // relline table
+  PROF_MEM_LPTABLE,           // lamp post table
+  PROF_MEM_RETURNRAD_TABLE,   // return radiation table
+  PROF_MEM_XILLTABLE,         // xillver tables (all spectra loaded so far)
+  PROF_MEM_CACHE_NODES,       // cnode caches (system parameters and relline profiles, without their 2D arrays)
+  PROF_MEM_SPEC_CACHE,        // specCache and FFT workspace of the convolution (one for each thread)
+  PROF_MEM_BUFFER_POOL,       // memory pools of the 2D arrays (in use, also by the caches, and available for re-use)
+  PROF_NUM_MEMORY
+} prof_memory;
+
+int is_profiling_enabled(void);
+void set_profiling_enabled(int enabled);
+
+/** time stamp in ns (0 if profiling is disabled) */
+long long prof_start(void);
+/** add the time since t_start (from prof_start) to the given stage */
+void prof_stop(prof_stage stage, long long t_start);
+/** as prof_stop, additionally attaching the arguments (body of a JSON object) to the trace event */
+void prof_stop_args(prof_stage stage, long long t_start, const char *args);
+
+void prof_cache_access(prof_cache cache, int is_hit);
+
+/** account nbytes allocated (or released, if negative) by the given subsystem */
+void prof_mem_add(prof_memory subsystem, long long nbytes);
+
+void print_profiling_report(void);
+void reset_profiling(void);
+
+int is_tracing_enabled(void);
+void set_tracing_enabled(int enabled);
+/** write all buffered trace events to the file (Chrome trace JSON), returns 0 on success */
+int write_profiling_trace(const char *filename);
+long long get_num_trace_events(void);
+
+long long get_profiling_num_calls(prof_stage stage);
+double get_profiling_time_sec(prof_stage stage);
+long long get_profiling_cache_hits(prof_cache cache);
+long long get_profiling_cache_misses(prof_cache cache);
+const char *get_profiling_stage_name(prof_stage stage);
+const char *get_profiling_cache_name(prof_cache cache);
+
+/** currently allocated memory of the subsystem (in bytes) */
+long long get_memory_bytes(prof_memory subsystem);
+/** maximal memory allocated by the subsystem so far (in bytes) */
+long long get_memory_peak_bytes(prof_memory subsystem);
+const char *get_memory_subsystem_name(prof_memory subsystem);
+/** peak resident memory of the process (in bytes, 0 if not available) */
+long long get_peak_rss_bytes(void);
+/** current resident memory of the process (in bytes, 0 if not available) */
+long long get_current_rss_bytes(void);
+
+#ifdef __cplusplus
+}
+
+#include <string>
+
+/** @brief times the given stage from construction until it goes out of scope */
+class ProfileTimer {
+ public:
+  explicit ProfileTimer(prof_stage stage) : m_stage{stage}, m_start{prof_start()} {
+  }
+  ~ProfileTimer() {
+    prof_stop_args(m_stage, m_start, m_args.empty() ? nullptr : m_args.c_str());
+  }
+  ProfileTimer(const ProfileTimer &other) = delete;
+  ProfileTimer &operator=(const ProfileTimer &other) = delete;
+
+  /** arguments of the trace event (body of a JSON object), only set them if is_tracing_enabled() */
+  void set_args(std::string args) {
+    m_args = std::move(args);
+  }
+
+ private:
+  prof_stage m_stage;
+  long long m_start;
+  std::string m_args{};
+};
+#endif
+
+#endif //RELXILL_SRC_PROFILING_H_
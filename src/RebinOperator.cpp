@@ -0,0 +1,169 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "RebinOperator.h"
+#include "Profiling.h"
+
+#include <algorithm>
+#include <cstring>
+
+RebinOperator::RebinOperator(const double *ener_target, int nbins_target, const double *ener_source,
+                             int nbins_source) : m_nbins_source{nbins_source} {
+
+  m_row_start.reserve(nbins_target + 1);
+  m_row_start.push_back(0);
+
+  // same scan of the grids as in rebin_spectrum, but storing the weights instead of applying them
+  int imin = 0;
+  int imax = 0;
+  for (int ii = 0; ii < nbins_target; ii++) {
+
+    if ((ener_source[0] <= ener_target[ii + 1]) && (ener_source[nbins_source] >= ener_target[ii])) {
+
+      while (ener_source[imin] <= ener_target[ii] && imin <= nbins_source) {
+        imin++;
+      }
+      if (imin > 0) {
+        imin--;
+      }
+      while ((ener_source[imax] <= ener_target[ii + 1] && imax < nbins_source)) {
+        imax++;
+      }
+      if (imax > 0) {
+        imax--;
+      }
+
+      double elo = std::max(ener_target[ii], ener_source[imin]);
+      double ehi = std::min(ener_target[ii + 1], ener_source[imax + 1]);
+
+      if (imax == imin) {
+        m_column.push_back(imin);
+        m_weight.push_back((ehi - elo) / (ener_source[imin + 1] - ener_source[imin]));
+      } else {
+        m_column.push_back(imin);
+        m_weight.push_back((ener_source[imin + 1] - elo) / (ener_source[imin + 1] - ener_source[imin]));
+        for (int jj = imin + 1; jj <= imax - 1; jj++) {
+          m_column.push_back(jj);
+          m_weight.push_back(1.0);
+        }
+        m_column.push_back(imax);
+        m_weight.push_back((ehi - ener_source[imax]) / (ener_source[imax + 1] - ener_source[imax]));
+      }
+    }
+
+    m_row_start.push_back(static_cast<int>(m_weight.size()));
+  }
+}
+
+void RebinOperator::apply(const double *flux_source, double *flux_target) const {
+  apply(&flux_source, &flux_target, 1);
+}
+
+void RebinOperator::apply(const double *const *flux_source, double *const *flux_target, int num_spectra) const {
+
+  long long t_start = prof_start();
+
+  const int *column = m_column.data();
+  const double *weight = m_weight.data();
+  const int nbins = nbins_target();
+
+  for (int kk = 0; kk < num_spectra; kk++) {
+    const double *src = flux_source[kk];
+    double *dest = flux_target[kk];
+    for (int ii = 0; ii < nbins; ii++) {
+      double sum = 0.0;
+      for (int jj = m_row_start[ii]; jj < m_row_start[ii + 1]; jj++) {
+        sum += weight[jj] * src[column[jj]];
+      }
+      dest[ii] = sum;
+    }
+  }
+
+  prof_stop(PROF_REBIN, t_start);
+}
+
+uint64_t get_energy_grid_fingerprint(const double *ener, int nbins) {
+  // FNV-1a on the 64bit words of the values (cheaper than hashing every byte)
+  uint64_t hash = 14695981039346656037ULL ^ static_cast<uint64_t>(nbins);
+  for (int ii = 0; ii <= nbins; ii++) {
+    uint64_t word;
+    memcpy(&word, &ener[ii], sizeof(word));
+    hash = (hash ^ word) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * @brief the last N_CACHED_OPERATORS operators (round robin), identified by the fingerprint of both grids
+ * @details the grids are stored as well, such that a collision of the fingerprints can not lead to a
+ * wrong operator
+ */
+class RebinOperatorCache {
+ public:
+  std::shared_ptr<const RebinOperator> get(const double *ener_target, int nbins_target,
+                                           const double *ener_source, int nbins_source) {
+
+    const uint64_t fp_target = get_energy_grid_fingerprint(ener_target, nbins_target);
+    const uint64_t fp_source = get_energy_grid_fingerprint(ener_source, nbins_source);
+
+    for (const auto &entry: m_entries) {
+      if (entry.op != nullptr && entry.fp_target == fp_target && entry.fp_source == fp_source
+          && is_same_grid(entry.ener_target, ener_target, nbins_target)
+          && is_same_grid(entry.ener_source, ener_source, nbins_source)) {
+        prof_cache_access(PROF_CACHE_REBIN_OPERATOR, 1);
+        return entry.op;
+      }
+    }
+    prof_cache_access(PROF_CACHE_REBIN_OPERATOR, 0);
+
+    auto &entry = m_entries[m_next];
+    m_next = (m_next + 1) % N_CACHED_OPERATORS;
+
+    entry.fp_target = fp_target;
+    entry.fp_source = fp_source;
+    entry.ener_target.assign(ener_target, ener_target + nbins_target + 1);
+    entry.ener_source.assign(ener_source, ener_source + nbins_source + 1);
+    entry.op = std::make_shared<const RebinOperator>(ener_target, nbins_target, ener_source, nbins_source);
+    return entry.op;
+  }
+
+ private:
+  static constexpr int N_CACHED_OPERATORS = 8;
+
+  struct Entry {
+    uint64_t fp_target{0};
+    uint64_t fp_source{0};
+    std::vector<double> ener_target;
+    std::vector<double> ener_source;
+    std::shared_ptr<const RebinOperator> op{nullptr};
+  };
+
+  static bool is_same_grid(const std::vector<double> &cached, const double *ener, int nbins) {
+    return cached.size() == static_cast<size_t>(nbins + 1)
+        && memcmp(cached.data(), ener, sizeof(double) * (nbins + 1)) == 0;
+  }
+
+  Entry m_entries[N_CACHED_OPERATORS];
+  int m_next{0};
+};
+
+std::shared_ptr<const RebinOperator> get_rebin_operator(const double *ener_target, int nbins_target,
+                                                        const double *ener_source, int nbins_source) {
+  thread_local RebinOperatorCache cache;
+  return cache.get(ener_target, nbins_target, ener_source, nbins_source);
+}
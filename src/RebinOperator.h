@@ -0,0 +1,75 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#ifndef RELXILL_SRC_REBINOPERATOR_H_
+#define RELXILL_SRC_REBINOPERATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief rebinning of a spectrum from a source to a target energy grid, stored as sparse matrix (CSR)
+ * @details The weights are the fractions of the source bins overlapping with each target bin, i.e.,
+ * applying the operator gives the same result as rebin_spectrum (relutility.c), but the grids only
+ * need to be scanned once. As the grids are fixed during a fit (xillver grid -> ener_conv -> XSPEC
+ * grid), the operators are cached (see get_rebin_operator).
+ */
+class RebinOperator {
+
+ public:
+  /** operator rebinning a spectrum from ener_source (nbins_source bins) to ener_target (nbins_target) */
+  RebinOperator(const double *ener_target, int nbins_target, const double *ener_source, int nbins_source);
+
+  [[nodiscard]] int nbins_target() const {
+    return static_cast<int>(m_row_start.size()) - 1;
+  }
+
+  [[nodiscard]] int nbins_source() const {
+    return m_nbins_source;
+  }
+
+  [[nodiscard]] size_t num_nonzero() const {
+    return m_weight.size();
+  }
+
+  /** rebin flux_source (nbins_source values) to flux_target (nbins_target values) */
+  void apply(const double *flux_source, double *flux_target) const;
+
+  /** rebin several spectra at once (e.g., the spectra of all zones), flux_target[ii] = rebin(flux_source[ii]) */
+  void apply(const double *const *flux_source, double *const *flux_target, int num_spectra) const;
+
+ private:
+  int m_nbins_source;
+  std::vector<int> m_row_start;  // nbins_target+1 values, the weights of bin ii are [row_start[ii], row_start[ii+1])
+  std::vector<int> m_column;     // index of the source bin
+  std::vector<double> m_weight;
+};
+
+/** fingerprint of an energy grid (nbins+1 values), used as key for the cached rebinning operators */
+uint64_t get_energy_grid_fingerprint(const double *ener, int nbins);
+
+/**
+ * @brief get the (cached) operator rebinning from ener_source to ener_target
+ * @details the last operators are cached per thread, the returned operator stays valid even if it is
+ * removed from the cache in the meantime
+ */
+std::shared_ptr<const RebinOperator> get_rebin_operator(const double *ener_target, int nbins_target,
+                                                        const double *ener_source, int nbins_source);
+
+#endif //RELXILL_SRC_REBINOPERATOR_H_
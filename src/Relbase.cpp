@@ -18,23 +18,48 @@
 #include "Relbase.h"
 #include "Xillspec.h"
 #include "Relphysics.h"
+#include "Profiling.h"
+#include "RebinOperator.h"
+#include "Buffer2D.h"
 
 extern "C" {
 #include "fftw/fftw3.h"   // assumes installation in heasoft
 #include "writeOutfiles.h"
 }
 
-// new CACHE routines
-cnode *cache_relbase = nullptr;
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
 
+// new CACHE routines (thread_local: every thread evaluating the model has its own context)
+thread_local cnode *cache_relbase = nullptr;
 
-int save_1eV_pos = 0;
 
+thread_local int save_1eV_pos = 0;
 
-double *global_ener_std = nullptr;
 
-specCache *global_spec_cache = nullptr;
+double *global_ener_std = nullptr;  // shared by all threads
+static std::mutex ener_std_mutex;
 
+double *global_ener_line_gspace = nullptr;  // shared by all threads
+static std::mutex ener_line_gspace_mutex;
+
+thread_local specCache *global_spec_cache = nullptr;
+
+// incremented when the cached tables and energy grids are freed (invalidates the relconv kernel caches)
+static std::atomic<int> relconv_kernel_generation{0};
+
+// the FFTW planner is not thread-safe (only fftw_execute is)
+static std::mutex fftw_planner_mutex;
+
+
+/** memory of the FFT buffers of the specCache (as allocated by new_specCache) */
+static long long get_specCache_nbytes(int n_cache, int n_ener) {
+  return static_cast<long long>(sizeof(specCache)
+      + n_cache * (2 * sizeof(fftw_complex *) + sizeof(xillSpec *))
+      + n_cache * 2 * n_ener * sizeof(fftw_complex));
+}
 
 static specCache *new_specCache(int n_cache, int *status) {
 
@@ -46,36 +71,21 @@ static specCache *new_specCache(int n_cache, int *status) {
 
   spec->conversion_factor_energyflux = nullptr;
 
-  spec->fft_xill = new double**[n_cache];
-  spec->fft_rel = new double**[n_cache];
-
   spec->fftw_xill = new fftw_complex*[n_cache];
   spec->fftw_rel = new fftw_complex*[n_cache];
 
-  spec->fftw_backwards_input = new fftw_complex[spec->n_ener];
-  spec->fftw_output = new double[spec->n_ener];
-
-  spec->plan_c2r = fftw_plan_dft_c2r_1d(spec->n_ener, spec->fftw_backwards_input, spec->fftw_output,FFTW_ESTIMATE);
-
   spec->xill_spec = new xillSpec*[n_cache];
 
   int ii;
-  int jj;
-  int m = 2;
   for (ii = 0; ii < n_cache; ii++) {
-    spec->fft_xill[ii] = new double*[m];
-    spec->fft_rel[ii] = new double*[m];
-
     spec->fftw_xill[ii] = new fftw_complex[spec->n_ener];
     spec->fftw_rel[ii] = new fftw_complex[spec->n_ener];
-
-   for (jj = 0; jj < m; jj++) {
-      spec->fft_xill[ii][jj] = new double[spec->n_ener];
-      spec->fft_rel[ii][jj] = new double[spec->n_ener];
-    }
     spec->xill_spec[ii] = nullptr;
   }
   spec->out_spec = nullptr;
+  spec->out_spec_fingerprint = 0;
+
+  prof_mem_add(PROF_MEM_SPEC_CACHE, get_specCache_nbytes(n_cache, spec->n_ener));
 
   return spec;
 }
@@ -105,6 +115,72 @@ static double* calculate_energyflux_conversion(const double* ener, int n_ener, i
   return factor;
 }
 
+void set_energyflux_conversion(specCache *cache, const double *ener, int n_ener, int *status) {
+  if (cache->conversion_factor_energyflux == nullptr) {
+    cache->conversion_factor_energyflux = calculate_energyflux_conversion(ener, n_ener, status);
+  }
+}
+
+/**
+ * @brief scratch buffers and FFTW plans for the convolution of a spectrum with n_ener bins
+ * @details The plans are only created once (the FFTW planner is not thread-safe) and only executed on the
+ * buffers of this workspace. As every thread has its own workspace (see get_fft_workspace), several zones
+ * can be convolved in parallel.
+ */
+class FftWorkspace {
+
+ public:
+  explicit FftWorkspace(int _n_ener) : n_ener{_n_ener} {
+    real_inp = static_cast<double *>(fftw_malloc(sizeof(double) * n_ener));
+    complex_out = static_cast<fftw_complex *>(fftw_malloc(sizeof(fftw_complex) * n_ener));
+    complex_inp = static_cast<fftw_complex *>(fftw_malloc(sizeof(fftw_complex) * n_ener));
+    real_out = static_cast<double *>(fftw_malloc(sizeof(double) * n_ener));
+
+    prof_mem_add(PROF_MEM_SPEC_CACHE, nbytes());
+
+    std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+    plan_r2c = fftw_plan_dft_r2c_1d(n_ener, real_inp, complex_out, FFTW_ESTIMATE);
+    plan_c2r = fftw_plan_dft_c2r_1d(n_ener, complex_inp, real_out, FFTW_ESTIMATE);
+  }
+
+  ~FftWorkspace() {
+    {
+      std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+      fftw_destroy_plan(plan_r2c);
+      fftw_destroy_plan(plan_c2r);
+    }
+    fftw_free(real_inp);
+    fftw_free(complex_out);
+    fftw_free(complex_inp);
+    fftw_free(real_out);
+    prof_mem_add(PROF_MEM_SPEC_CACHE, -nbytes());
+  }
+
+  FftWorkspace(const FftWorkspace &other) = delete;
+  FftWorkspace &operator=(const FftWorkspace &other) = delete;
+
+  /** memory of the buffers (accounted as PROF_MEM_SPEC_CACHE) */
+  [[nodiscard]] long long nbytes() const {
+    return static_cast<long long>(sizeof(FftWorkspace) + 2 * n_ener * (sizeof(double) + sizeof(fftw_complex)));
+  }
+
+  const int n_ener;
+  double *real_inp;
+  fftw_complex *complex_out;
+  fftw_complex *complex_inp;
+  double *real_out;
+  fftw_plan plan_r2c;
+  fftw_plan plan_c2r;
+};
+
+static FftWorkspace &get_fft_workspace(int n_ener) {
+  thread_local std::unique_ptr<FftWorkspace> workspace{nullptr};
+  if (workspace == nullptr || workspace->n_ener != n_ener) {
+    workspace.reset(new FftWorkspace(n_ener));
+  }
+  return *workspace;
+}
+
 
 
 
@@ -123,14 +199,15 @@ void fftw_conv_spectrum(double *ener, const double *fxill, const double *frel, d
                        int re_rel, int re_xill, int izone, specCache *cache, int *status) {
 
   CHECK_STATUS_VOID(*status);
-
-  // needs spec cache to be set up
-  assert(cache != nullptr);
-
-  if (cache->conversion_factor_energyflux == nullptr){
-    cache->conversion_factor_energyflux = calculate_energyflux_conversion(ener, n, status);
+  ProfileTimer timer{PROF_FFT_CONV};
+  if (is_tracing_enabled()) {
+    timer.set_args("\"zone\": " + std::to_string(izone) + ", \"re_rel\": " + std::to_string(re_rel)
+                       + ", \"re_xill\": " + std::to_string(re_xill));
   }
 
+  // needs spec cache to be set up (including the conversion factor, see set_energyflux_conversion)
+  assert(cache != nullptr);
+  set_energyflux_conversion(cache, ener, n, status);
 
   /* need to find out where the 1keV for the filter is, which defines if energies are blue or redshifted*/
   if (save_1eV_pos == 0 ||
@@ -142,6 +219,9 @@ void fftw_conv_spectrum(double *ener, const double *fxill, const double *frel, d
   int ii;
   int irot;
 
+  auto &fft = get_fft_workspace(n);
+  const int n_complex = n / 2 + 1;  // r2c transform only gives the non-redundant half
+
   /**********************************************************************/
   /** cache either the relat. or the xillver part, as only one of the
    * two changes most of the time (reduce time by 1/3 for convolution) **/
@@ -150,43 +230,44 @@ void fftw_conv_spectrum(double *ener, const double *fxill, const double *frel, d
   /** #1: for the xillver part **/
   if (re_xill) {
     for (ii = 0; ii < n; ii++) {
-      cache->fft_xill[izone][0][ii] = fxill[ii] * cache->conversion_factor_energyflux[ii] ;
+      fft.real_inp[ii] = fxill[ii] * cache->conversion_factor_energyflux[ii] ;
+    }
+    fftw_execute(fft.plan_r2c);
+    for (ii = 0; ii < n_complex; ii++) {
+      cache->fftw_xill[izone][ii][0] = fft.complex_out[ii][0];
+      cache->fftw_xill[izone][ii][1] = fft.complex_out[ii][1];
     }
-
-    fftw_plan plan_xill = fftw_plan_dft_r2c_1d(n, cache->fft_xill[izone][0], cache->fftw_xill[izone],FFTW_ESTIMATE);
-    fftw_execute(plan_xill);
-    fftw_destroy_plan(plan_xill);
   }
 
   /** #2: for the relat. part **/
   if (re_rel){
     for (ii = 0; ii < n; ii++) {
       irot = (ii - save_1eV_pos + n) % n;
-      cache->fft_rel[izone][0][irot] = frel[ii] * cache->conversion_factor_energyflux[ii];
+      fft.real_inp[irot] = frel[ii] * cache->conversion_factor_energyflux[ii];
+    }
+    fftw_execute(fft.plan_r2c);
+    for (ii = 0; ii < n_complex; ii++) {
+      cache->fftw_rel[izone][ii][0] = fft.complex_out[ii][0];
+      cache->fftw_rel[izone][ii][1] = fft.complex_out[ii][1];
     }
-
-    fftw_plan plan_rel = fftw_plan_dft_r2c_1d(n, cache->fft_rel[izone][0], cache->fftw_rel[izone],FFTW_ESTIMATE);
-    fftw_execute(plan_rel);
-    fftw_destroy_plan(plan_rel);
   }
 
   // complex multiplication (TODO: fix that complex multiplication is not by hand)
-  for (ii = 0; ii < n; ii++) {
-//    cache->fftw_backwards_input[ii] = cache->fftw_xill[izone][ii] * cache->fftw_rel[izone][ii];
-    cache->fftw_backwards_input[ii][0] =
+  for (ii = 0; ii < n_complex; ii++) {
+    fft.complex_inp[ii][0] =
         cache->fftw_xill[izone][ii][0] * cache->fftw_rel[izone][ii][0] -
         cache->fftw_xill[izone][ii][1] * cache->fftw_rel[izone][ii][1];
 
-    cache->fftw_backwards_input[ii][1] =
+    fft.complex_inp[ii][1] =
         cache->fftw_xill[izone][ii][0] * cache->fftw_rel[izone][ii][1] +
             cache->fftw_xill[izone][ii][1] * cache->fftw_rel[izone][ii][0];
 
   }
 
-  fftw_execute(cache->plan_c2r);
+  fftw_execute(fft.plan_c2r);
 
   for (ii = 0; ii < n; ii++) {
-    fout[ii] = cache->fftw_output[ii] /  cache->conversion_factor_energyflux[ii]; 
+    fout[ii] = fft.real_out[ii] /  cache->conversion_factor_energyflux[ii]; 
   }
 
 }
@@ -234,6 +315,7 @@ void convolveSpectrumFFTNormalized(double *ener, const double *fxill, const doub
 }
 
 void get_relxill_conv_energy_grid(int *n_ener, double **ener, int *status) {
+  std::lock_guard<std::mutex> lock(ener_std_mutex);
   if (global_ener_std == nullptr) {
     global_ener_std = (double *) malloc((N_ENER_CONV + 1) * sizeof(double));
     CHECK_MALLOC_VOID_STATUS(global_ener_std, status)
@@ -261,6 +343,72 @@ void set_flux_outside_defined_range_to_zero(const double* ener, double* spec, in
 }
 
 
+/**
+ * @brief cache of the relconv kernel: the relline profile on the convolution grid and its Fourier transform
+ * are kept while the relativistic parameters do not change, such that only the FFT of the input spectrum
+ * needs to be re-calculated. Additionally the scratch buffers on the convolution grid are kept.
+ * @details the FFT is stored separately from the specCache, as the specCache is shared with the relxill
+ * kernel (evaluated by the same thread) and would be overwritten.
+ */
+class RelconvKernelCache {
+ public:
+  RelconvKernelCache() = default;
+
+  ~RelconvKernelCache() {
+    free(m_rel_param);
+  }
+
+  RelconvKernelCache(const RelconvKernelCache &other) = delete;
+  RelconvKernelCache &operator=(const RelconvKernelCache &other) = delete;
+
+  /** @brief check if the cached kernel can be used for the given parameters and energy grid */
+  [[nodiscard]] bool is_valid(const relParam *rel_param, const double *ener, int n_ener) const {
+    return m_rel_param != nullptr && m_generation == relconv_kernel_generation && ener == m_ener
+        && n_ener == static_cast<int>(rel_flux.size()) && !did_rel_param_change(m_rel_param, rel_param);
+  }
+
+  /** @brief store the relline profile, the FFT needs to be set afterwards with store_fft_kernel */
+  void set_kernel(const relParam *rel_param, const double *ener, int n_ener, const double *flux, int *status) {
+    set_cached_rel_param(rel_param, &m_rel_param, status);
+    CHECK_STATUS_VOID(*status);
+    m_ener = ener;
+    m_generation = relconv_kernel_generation;
+    rel_flux.assign(flux, flux + n_ener);
+    rebin_flux.resize(n_ener);
+    conv_out.resize(n_ener);
+    fft_kernel.resize(2 * (n_ener / 2 + 1));
+  }
+
+  void store_fft_kernel(const fftw_complex *fft) {
+    for (size_t ii = 0; ii < fft_kernel.size() / 2; ii++) {
+      fft_kernel[2 * ii] = fft[ii][0];
+      fft_kernel[2 * ii + 1] = fft[ii][1];
+    }
+  }
+
+  void restore_fft_kernel(fftw_complex *fft) const {
+    for (size_t ii = 0; ii < fft_kernel.size() / 2; ii++) {
+      fft[ii][0] = fft_kernel[2 * ii];
+      fft[ii][1] = fft_kernel[2 * ii + 1];
+    }
+  }
+
+  void invalidate() {
+    free(m_rel_param);
+    m_rel_param = nullptr;
+  }
+
+  std::vector<double> rel_flux;
+  std::vector<double> rebin_flux;  // scratch buffers on the convolution grid
+  std::vector<double> conv_out;
+
+ private:
+  relParam *m_rel_param{nullptr};
+  const double *m_ener{nullptr};
+  int m_generation{-1};
+  std::vector<double> fft_kernel;  // non-redundant half of the transform (real, imag)
+};
+
 /**
  * @brief basic relconv function: convolve any input spectrum with the relbase kernel
  * @description
@@ -269,43 +417,57 @@ void set_flux_outside_defined_range_to_zero(const double* ener, double* spec, in
  * @param double[n_ener_inp+1] ener_inp
  * @param double[n_ener_inp] spec_ener_inp
  *  **/
-void relconv_kernel(double *ener_inp, double *spec_inp, int n_ener_inp, relParam *rel_param, int *status) {
+void relconv_kernel(const double *ener_inp, double *spec_inp, int n_ener_inp, relParam *rel_param, int *status) {
 
   // get the (fixed!) energy grid for a RELLINE for a convolution
   // -> as we do a simple FFT, we can now take into account that we
   // need it to be number = 2^N */
   int n_ener; double *ener;
   get_relxill_conv_energy_grid(&n_ener, &ener, status);
+  CHECK_STATUS_VOID(*status);
 
-  relline_spec_multizone *rel_profile = relbase(ener, n_ener, rel_param, status);
-
-  // simple convolution only makes sense for 1 zone !
-  assert(rel_profile->n_zones == 1);
-
-  auto rebin_flux =  new double[n_ener];
-  rebin_spectrum(ener, rebin_flux, n_ener, ener_inp, spec_inp, n_ener_inp);
+  thread_local RelconvKernelCache kernel_cache;
 
   specCache* spec_cache = init_global_specCache(status);
   CHECK_STATUS_VOID(*status);
-  auto conv_out = new double[n_ener];
-  convolveSpectrumFFTNormalized(ener, rebin_flux, rel_profile->flux[0], conv_out, n_ener,
-                    1, 1, 0, spec_cache, status);
-  CHECK_STATUS_VOID(*status);
+
+  const int re_rel = !kernel_cache.is_valid(rel_param, ener, n_ener);
+  prof_cache_access(PROF_CACHE_RELCONV_KERNEL, !re_rel);
+  if (re_rel) {
+    relline_spec_multizone *rel_profile = relbase(ener, n_ener, rel_param, status);
+    CHECK_STATUS_VOID(*status);
+
+    // simple convolution only makes sense for 1 zone !
+    assert(rel_profile->n_zones == 1);
+    kernel_cache.set_kernel(rel_param, ener, n_ener, rel_profile->flux[0], status);
+    CHECK_STATUS_VOID(*status);
+  } else {
+    kernel_cache.restore_fft_kernel(spec_cache->fftw_rel[0]);
+  }
+
+  get_rebin_operator(ener, n_ener, ener_inp, n_ener_inp)->apply(spec_inp, kernel_cache.rebin_flux.data());
+
+  convolveSpectrumFFTNormalized(ener, kernel_cache.rebin_flux.data(), kernel_cache.rel_flux.data(),
+                                kernel_cache.conv_out.data(), n_ener, re_rel, 1, 0, spec_cache, status);
+  if (*status != EXIT_SUCCESS) {
+    kernel_cache.invalidate();
+    return;
+  }
+  if (re_rel) {
+    kernel_cache.store_fft_kernel(spec_cache->fftw_rel[0]);
+  }
 
   // rebin to the output grid
-  rebin_spectrum(ener_inp, spec_inp, n_ener_inp, ener, conv_out, n_ener);
+  get_rebin_operator(ener_inp, n_ener_inp, ener, n_ener)->apply(kernel_cache.conv_out.data(), spec_inp);
 
   set_flux_outside_defined_range_to_zero(ener_inp, spec_inp, n_ener_inp, RELCONV_EMIN, RELCONV_EMAX);
 
-  delete[] rebin_flux;
-  delete[] conv_out;
-
 }
 
 
 
 
-void add_primary_component(double *ener, int n_ener, double *flu, relParam *rel_param, xillParam *xill_input_param,
+void add_primary_component(const double *ener, int n_ener, double *flu, relParam *rel_param, xillParam *xill_input_param,
                            RelSysPar *sys_par, int *status) {
 
   xillTableParam *xill_table_param = get_xilltab_param(xill_input_param, status);
@@ -472,7 +634,7 @@ void write_output_rel_param(relParam *pa) {
  * optional input: xillver grid
  * output: photar(n_ener)  [photons/bin]
 **/
-relline_spec_multizone* relbase_profile(double *ener, int n_ener, relParam *param,
+relline_spec_multizone* relbase_profile(const double *ener, int n_ener, relParam *param,
                                        RelSysPar *sysPar,
                                        xillTable *xill_tab,
                                        const double *radialZones,
@@ -484,7 +646,13 @@ relline_spec_multizone* relbase_profile(double *ener, int n_ener, relParam *para
   cache_info *ca_info = cli_check_cache(cache_relbase, inp, check_cache_relpar, status);
   relline_spec_multizone *spec = nullptr;
 
+  ProfileTimer timer{PROF_RELBASE_PROFILE};
+  if (is_tracing_enabled()) {
+    timer.set_args("\"cached\": " + std::to_string(is_relbase_cached(ca_info)));
+  }
+
   // set a pointer to the spectrum
+  prof_cache_access(PROF_CACHE_RELBASE, is_relbase_cached(ca_info));
   if (is_relbase_cached((ca_info)) == 0) {
 
     // init the spectra where we store the flux
@@ -536,7 +704,7 @@ relline_spec_multizone* relbase_profile(double *ener, int n_ener, relParam *para
  * optional input: xillver grid
  * output: photar(n_ener)  [photons/bin]
 **/
-relline_spec_multizone *relbase(double *ener, const int n_ener, relParam *param, int *status) {
+relline_spec_multizone *relbase(const double *ener, const int n_ener, relParam *param, int *status) {
 
   // initialize parameter values (has an internal cache)
   RelSysPar *sysPar = get_system_parameters(param, status);
@@ -554,17 +722,95 @@ relline_spec_multizone *relbase(double *ener, const int n_ener, relParam *param,
 
 
 
+/** fixed grid in g=E/E_line, on which the relline profile of a line model is calculated (see relline_profile) */
+static double *get_line_gspace_energy_grid(int *status) {
+  std::lock_guard<std::mutex> lock(ener_line_gspace_mutex);
+  if (global_ener_line_gspace == nullptr) {
+    global_ener_line_gspace = (double *) malloc((N_ENER_LINE_GSPACE + 1) * sizeof(double));
+    CHECK_MALLOC_RET_STATUS(global_ener_line_gspace, status, nullptr)
+    get_log_grid(global_ener_line_gspace, (N_ENER_LINE_GSPACE + 1), GMIN_LINE_GSPACE, GMAX_LINE_GSPACE);
+  }
+  return global_ener_line_gspace;
+}
+
+/**
+ * @brief check if all bins of the energy grid, which overlap with the range [gmin,gmax] where the line has
+ * flux, are at least MIN_SUBBINS_LINE_GSPACE times wider than the bins of the internal g-grid
+ */
+static int is_grid_resolved_by_gspace_grid(const double *ener, int n_ener, double gmin, double gmax) {
+  const double dlog_gspace = log(GMAX_LINE_GSPACE / GMIN_LINE_GSPACE) / N_ENER_LINE_GSPACE;
+  for (int ii = 0; ii < n_ener; ii++) {
+    if (ener[ii + 1] > gmin && ener[ii] < gmax
+        && log(ener[ii + 1] / ener[ii]) < MIN_SUBBINS_LINE_GSPACE * dlog_gspace) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief relline profile of a line at 1keV on the given energy grid (in units of the line energy, i.e.,
+ * already shifted by the line energy and the redshift)
+ * @details The profile is calculated on the fixed internal grid in g=E/E_line (and therefore cached in
+ * relbase independently of the line energy and the redshift) and afterwards rebinned to the given grid. If the
+ * given grid is finer than the internal grid where the line has flux, it is directly calculated on this grid.
+ * @param flux [output] (n_ener bins, in photons/bin)
+ */
+void relline_profile(const double *ener, double *flux, int n_ener, const relParam *param, int *status) {
+
+  CHECK_STATUS_VOID(*status);
+  assert(param->num_zones == 1);
+
+  double *ener_gspace = get_line_gspace_energy_grid(status);
+  CHECK_STATUS_VOID(*status);
+
+  // neither the line energy nor the redshift are used for the profile, so fix them for the cache
+  relParam param_gspace = *param;
+  param_gspace.lineE = 1.0;
+  param_gspace.z = 0.0;
+  relline_spec_multizone *spec_gspace = relbase(ener_gspace, N_ENER_LINE_GSPACE, &param_gspace, status);
+  CHECK_STATUS_VOID(*status);
+
+  // range in which the line has flux
+  int ilo = 0;
+  int ihi = N_ENER_LINE_GSPACE - 1;
+  while (ilo < ihi && spec_gspace->flux[0][ilo] == 0.0) {
+    ilo++;
+  }
+  while (ihi > ilo && spec_gspace->flux[0][ihi] == 0.0) {
+    ihi--;
+  }
+
+  if (!is_grid_resolved_by_gspace_grid(ener, n_ener, ener_gspace[ilo], ener_gspace[ihi + 1])) {
+    relParam param_direct = *param;
+    relline_spec_multizone *spec = relbase(ener, n_ener, &param_direct, status);
+    CHECK_STATUS_VOID(*status);
+    for (int ii = 0; ii < n_ener; ii++) {
+      flux[ii] = spec->flux[0][ii];
+    }
+    return;
+  }
+
+  rebin_spectrum(ener, flux, n_ener, ener_gspace, spec_gspace->flux[0], N_ENER_LINE_GSPACE);
+
+  // the profile is normalized on the given grid (as if it would have been calculated on it directly)
+  if (do_renorm_model(&param_gspace)) {
+    double sum_gspace = calcSum(spec_gspace->flux[0], N_ENER_LINE_GSPACE);
+    double sum = calcSum(flux, n_ener);
+    if (sum > 0) {
+      for (int ii = 0; ii < n_ener; ii++) {
+        flux[ii] *= sum_gspace / sum;
+      }
+    }
+  }
+
+}
+
 void free_rel_cosne(RelCosne *spec) {
   if (spec != nullptr) {
     //	free(spec->ener);  we do not need this, as only a pointer for ener is assigned
     free(spec->cosne);
-    if (spec->dist != nullptr) {
-      int ii;
-      for (ii = 0; ii < spec->n_zones; ii++) {
-        free(spec->dist[ii]);
-      }
-    }
-    free(spec->dist);
+    free_buffer_2d(spec->dist);
     free(spec);
   }
 }
@@ -573,15 +819,7 @@ void free_rel_spec(relline_spec_multizone *spec) {
   if (spec != nullptr) {
     free(spec->ener);
     free(spec->rgrid);
-    if (spec->flux != nullptr) {
-      int ii;
-      for (ii = 0; ii < spec->n_zones; ii++) {
-        if (spec->flux[ii] != nullptr) {
-          free(spec->flux[ii]);
-        }
-      }
-    }
-    free(spec->flux);
+    free_buffer_2d(spec->flux);
     if (spec->rel_cosne != nullptr) {
       free_rel_cosne(spec->rel_cosne);
     }
@@ -589,6 +827,22 @@ void free_rel_spec(relline_spec_multizone *spec) {
   }
 }
 
+long long get_rel_spec_nbytes(const relline_spec_multizone *spec) {
+  if (spec == nullptr) {
+    return 0;
+  }
+  // the 2D arrays (flux and angular distribution) are taken from the memory pool (see PROF_MEM_BUFFER_POOL)
+  auto nbytes = static_cast<long long>(sizeof(relline_spec_multizone) + (spec->n_ener + 1) * sizeof(double));
+  if (spec->rgrid != nullptr) {
+    nbytes += static_cast<long long>((spec->n_zones + 1) * sizeof(double));
+  }
+  if (spec->rel_cosne != nullptr) {
+    const RelCosne *cosne = spec->rel_cosne;
+    nbytes += static_cast<long long>(sizeof(RelCosne) + cosne->n_cosne * sizeof(double));
+  }
+  return nbytes;
+}
+
 void free_cached_tables() {
   free_relprofile_cache();
 
@@ -601,30 +855,13 @@ void free_cached_tables() {
  // free(cached_xill_param);
 
   free_specCache(global_spec_cache);
+  relconv_kernel_generation++;
 
   free(global_ener_std);
   // free(global_ener_xill); // TODO, implement free of this global energy grid
 
 }
 
-void free_fft_cache(double ***sp, int n1, int n2) {
-
-  int ii;
-  int jj;
-  if (sp != nullptr) {
-    for (ii = 0; ii < n1; ii++) {
-      if (sp[ii] != nullptr) {
-        for (jj = 0; jj < n2; jj++) {
-          free(sp[ii][jj]);
-        }
-      }
-      free(sp[ii]);
-    }
-    free(sp);
-  }
-
-}
-
 spectrum *new_spectrum(int n_ener, const double *ener, int *status) {
 
   auto *spec = new spectrum;
@@ -658,7 +895,6 @@ void free_fftw_complex_cache(fftw_complex** val, int n){
 void free_specCache(specCache* spec_cache) {
 
   int ii;
-  int m = 2;
   if (spec_cache != nullptr) {
     if (spec_cache->xill_spec != nullptr) {
       for (ii = 0; ii < spec_cache->n_cache; ii++) {
@@ -669,19 +905,8 @@ void free_specCache(specCache* spec_cache) {
       free(spec_cache->xill_spec);
     }
 
-    if (spec_cache->fft_xill != nullptr) {
-      free_fft_cache(spec_cache->fft_xill, spec_cache->n_cache, m);
-    }
-
-    if (spec_cache->fftw_rel != nullptr) {
-      free_fft_cache(spec_cache->fft_rel, spec_cache->n_cache, m);
-    }
-
     free_fftw_complex_cache(spec_cache->fftw_rel, spec_cache->n_cache);
     free_fftw_complex_cache(spec_cache->fftw_xill, spec_cache->n_cache);
-    fftw_free(spec_cache->fftw_backwards_input);
-    fftw_destroy_plan(spec_cache->plan_c2r);
-    free(spec_cache->fftw_output);
 
     if (spec_cache->conversion_factor_energyflux != nullptr){
       free(spec_cache->conversion_factor_energyflux);
@@ -689,6 +914,7 @@ void free_specCache(specCache* spec_cache) {
 
     free_spectrum(spec_cache->out_spec);
 
+    prof_mem_add(PROF_MEM_SPEC_CACHE, -get_specCache_nbytes(spec_cache->n_cache, spec_cache->n_ener));
   }
 
   free(spec_cache);
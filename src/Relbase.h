@@ -44,6 +44,12 @@ extern "C" {
 #define EMIN_RELXILL_CONV 0.00035  // minimal energy of the convolution (in keV)
 #define EMAX_RELXILL_CONV 2000.0 // maximal energy of the convolution (in keV)
 
+/** internal grid in g=E/E_line, on which the profile of the line models is calculated **/
+#define N_ENER_LINE_GSPACE 8192
+#define GMIN_LINE_GSPACE 1e-3
+#define GMAX_LINE_GSPACE 3.0
+#define MIN_SUBBINS_LINE_GSPACE 2  // bins of the output grid need to be at least this many times wider
+
 /** minimal and maximal energy for reflection strength calculation **/
 #define RSTRENGTH_EMIN 20.0
 #define RSTRENGTH_EMAX 40.0
@@ -75,6 +81,7 @@ typedef struct {
   double **trff;
   double **cosne;
   double *gstar;
+  gridDescriptor gstar_grid;
 } str_relb_func;
 
 /****** FUNCTION DEFINITIONS ******/
@@ -83,9 +90,11 @@ typedef struct {
 void get_version_number(char **vstr, int *status);
 
 /* the relbase function calculating the basic relativistic line shape for a given parameter setup*/
-relline_spec_multizone *relbase(double *ener, const int n_ener, relParam *param, int *status);
+relline_spec_multizone *relbase(const double *ener, const int n_ener, relParam *param, int *status);
+
+void relline_profile(const double *ener, double *flux, int n_ener, const relParam *param, int *status);
 
-relline_spec_multizone* relbase_profile(double *ener, int n_ener, relParam *param,
+relline_spec_multizone* relbase_profile(const double *ener, int n_ener, relParam *param,
                                         RelSysPar *sysPar,
                                         xillTable *xill_tab,
                                         const double *radialZones,
@@ -104,11 +113,11 @@ relline_spec_multizone *relbase_multizone(double *ener,
 void free_cached_tables(void);
 
 
-void relconv_kernel(double *ener_inp, double *spec_inp, int n_ener_inp, relParam *rel_param, int *status);
+void relconv_kernel(const double *ener_inp, double *spec_inp, int n_ener_inp, relParam *rel_param, int *status);
 
 
 /** function adding a primary component with the proper norm to the flux **/
-void add_primary_component(double *ener,
+void add_primary_component(const double *ener,
                            int n_ener,
                            double *flu,
                            relParam *rel_param,
@@ -117,14 +126,16 @@ void add_primary_component(double *ener,
                            int *status);
 
 void free_rel_spec(relline_spec_multizone *spec);
+/** memory of the relline spectrum (in bytes), without its 2D arrays, which are accounted by the memory pool */
+long long get_rel_spec_nbytes(const relline_spec_multizone *spec);
 relline_spec_multizone *new_rel_spec(int nzones, const int n_ener, int *status);
+RelCosne *new_rel_cosne(int nzones, int n_incl, int *status);
 
 double calcFFTNormFactor(const double *ener, const double *fxill, const double *frel, const double *fout, int n);
 
 /** caching routines **/
 specCache *init_global_specCache(int *status);
 void free_specCache(specCache *spec_cache);
-void free_fft_cache(double ***sp, int n1, int n2);
 void free_spectrum(spectrum *spec);
 
 spectrum *new_spectrum(int n_ener, const double *ener, int *status);
@@ -139,6 +150,13 @@ int did_xill_param_change(const xillParam *cpar, const xillParam *par);
 
 void free_cache(void);
 
+/** set the (energy-grid dependent) conversion factor of the cache, needs to be done before the zones
+ * are convolved in parallel */
+void set_energyflux_conversion(specCache *cache, const double *ener, int n_ener, int *status);
+
+void fftw_conv_spectrum(double *ener, const double *fxill, const double *frel, double *fout, int n,
+                        int re_rel, int re_xill, int izone, specCache *cache, int *status);
+
 void convolveSpectrumFFTNormalized(double *ener, const double *fxill, const double *frel, double *fout, int n,
                                    int re_rel, int re_xill, int izone, specCache *local_spec_cache, int *status);
 
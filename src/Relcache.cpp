@@ -18,9 +18,10 @@
 
 #include "Relcache.h"
 #include "Relbase.h"
+#include "Profiling.h"
 
 /** probably best move to "utils" **/
-inpar *get_inputvals_struct(double *ener, int n_ener, const relParam *rel_par, int *status) {
+inpar *get_inputvals_struct(const double *ener, int n_ener, const relParam *rel_par, int *status) {
   auto *inp = (inpar *) malloc(sizeof(inpar));
   CHECK_MALLOC_RET_STATUS(inp, status, nullptr)
 
@@ -43,8 +44,19 @@ inpar *set_input_syspar(const relParam *rel_par, int *status) {
   return inp;
 }
 
+// tolerance for comparing cached parameters (per thread, as the caches are thread_local)
+static thread_local double cache_limit = CACHE_LIMIT;
+
+void set_cache_limit(double limit) {
+  cache_limit = limit;
+}
+
+double get_cache_limit() {
+  return cache_limit;
+}
+
 int are_values_different(double val1, double val2) {
-  if (fabs(val1 - val2) <= CACHE_LIMIT) {
+  if (fabs(val1 - val2) <= cache_limit) {
     return 0;
   } else {
     return 1;
@@ -216,7 +228,7 @@ void set_cached_xill_param(xillParam *par, xillParam **ca_xill_param, int *statu
 
 }
 
-static int did_energy_grid_change(double *ener, int n_ener, relline_spec_multizone *ca) {
+static int did_energy_grid_change(const double *ener, int n_ener, const relline_spec_multizone *ca) {
   const int not_changed = 0;
   const int changed = 1;
 
@@ -389,6 +401,11 @@ cache_info *cli_check_cache(cnode *head,
   return ca_info;
 }
 
+static void add_cdata_nbytes(cdata *data, long long nbytes) {
+  data->nbytes += nbytes;
+  prof_mem_add(PROF_MEM_CACHE_NODES, nbytes);
+}
+
 // prepend new node and set parameters
 cnode *add_node_to_cache(cnode *head, const relParam *relpar, xillParam *xillpar, int *status) {
 
@@ -410,6 +427,9 @@ cnode *add_node_to_cache(cnode *head, const relParam *relpar, xillParam *xillpar
 
   assert(new_head != nullptr);
 
+  add_cdata_nbytes(data, static_cast<long long>(sizeof(cnode) + sizeof(cdata)
+      + ((data->par_rel != nullptr) ? sizeof(relParam) : 0) + ((data->par_xill != nullptr) ? sizeof(xillParam) : 0)));
+
   CHECK_RELXILL_DEFAULT_ERROR(status);
 
   return new_head;
@@ -426,6 +446,7 @@ void add_relspec_to_cache(cnode **node, const relParam *param, relline_spec_mult
 
   // set the data
   new_head->data->relbase_spec = spec;
+  add_cdata_nbytes(new_head->data, get_rel_spec_nbytes(spec));
 
   *node = new_head;
 
@@ -441,6 +462,7 @@ void set_cache_syspar(cnode **pt_head, const relParam *param, RelSysPar *syspar,
 
   // set the data
   new_head->data->relSysPar = syspar;
+  add_cdata_nbytes(new_head->data, get_relSysPar_nbytes(syspar));
 
   *pt_head = new_head;
 
@@ -462,6 +484,7 @@ cdata *init_cdata(int *status) {
   data->relSysPar = nullptr;
   data->relbase_spec = nullptr;
   data->relxill_cache = nullptr;
+  data->nbytes = 0;
 
   return data;
 }
@@ -469,7 +492,6 @@ cdata *init_cdata(int *status) {
 void free_relxill_cache(specCache *ca) {
 
   int ii;
-  int m = 2;
   if (ca != nullptr) {
     if (ca->xill_spec != nullptr) {
       for (ii = 0; ii < ca->n_cache; ii++) {
@@ -480,14 +502,6 @@ void free_relxill_cache(specCache *ca) {
       free(ca->xill_spec);
     }
 
-    if (ca->fft_xill != nullptr) {
-      free_fft_cache(ca->fft_xill, ca->n_cache, m);
-    }
-
-    if (ca->fft_rel != nullptr) {
-      free_fft_cache(ca->fft_rel, ca->n_cache, m);
-    }
-
     free_spectrum(ca->out_spec);
 
   }
@@ -500,6 +514,7 @@ static void free_cdata(cdata **pt_data) {
 
   if (*pt_data != nullptr) {
     cdata *data = *pt_data;
+    prof_mem_add(PROF_MEM_CACHE_NODES, -data->nbytes);
     free(data->par_rel);
     free(data->par_xill);
     free_rel_spec(data->relbase_spec);
@@ -40,6 +40,8 @@ typedef struct cdata {
   relline_spec_multizone *relbase_spec;
   RelSysPar *relSysPar;
   specCache *relxill_cache;
+
+  long long nbytes;  // memory of the node including its data (accounted as PROF_MEM_CACHE_NODES)
 } cdata;
 
 typedef struct cnode {
@@ -61,16 +63,20 @@ typedef struct cache_info {
 
 typedef struct inpar {
   const relParam *rel_par;
-  double *ener;
+  const double *ener;
   int n_ener;
 } inpar;
 
 /** set the input parameters in one single structure **/
-inpar *get_inputvals_struct(double *ener, int n_ener, const relParam *rel_par, int *status);
+inpar *get_inputvals_struct(const double *ener, int n_ener, const relParam *rel_par, int *status);
 inpar *set_input_syspar(const relParam *rel_par, int *status);
 
 int are_values_different(double val1, double val2);
 
+/** set the tolerance of are_values_different for the calling thread (default: CACHE_LIMIT) */
+void set_cache_limit(double limit);
+double get_cache_limit();
+
 /** create a caching node **/
 cnode *cli_create(cdata *data, cnode *next, int *status);
 
@@ -18,12 +18,19 @@
 
 #include "Rellp.h"
 #include "Relphysics.h"
+#include "Profiling.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
 
 extern "C" {
 #include "writeOutfiles.h"
 }
 
-lpTable *cached_lp_table = nullptr;
+lpTable *cached_lp_table = nullptr;  // shared by all threads
+static std::mutex lptable_mutex;
 
 
 /*
@@ -110,41 +117,49 @@ static void norm_emis_profile(const double *re, const int nr, double *emis) {
 
 
 /**
- *
- * @param emis_prof (required to be descending in radius)
- * @param emis_prof_tab (required to be ascending in radius)
- * @param status
- *
- * @detail function "invert_emis_profile" can be used to convert
+ * @brief interpolation of the radial grid of the LP table onto the radial grid of an emissivity profile
+ * @details only depends on the two grids (i.e., on the spin and on Rin and Rout), such that the indices
+ * and interpolation factors can be re-used for a different height of the primary source. The factor
+ * is stored for a linear and a logarithmic interpolation in radius, which is selected depending on the
+ * emission angle (see get_ipol_factor_radius)
  */
-void rebin_emisprofile_on_radial_grid(emisProfile *emis_prof, const emisProfile* emis_prof_tab, int *status) {
-
-  if (is_emis_grid_ascending(emis_prof)==1){
-    RELXILL_ERROR("rebinning emissivity profile failed (require output radial grid of emissivity to be descending with radius",
-                  status);
-    assert(emis_prof->re[0]>emis_prof->re[1]);
-    return;
+struct LpRadialInterpolation {
+  std::vector<double> re;      // radial grid of the emissivity profile (descending)
+  std::vector<double> re_tab;  // radial grid of the table (ascending)
+  std::vector<int> ind;        // re_tab[ind] <= re < re_tab[ind+1]
+  std::vector<double> ifac_lin;
+  std::vector<double> ifac_log;
+};
+
+static bool is_same_radial_grid(const std::vector<double> &cached_grid, const double *grid, int n) {
+  if (static_cast<int>(cached_grid.size()) != n) {
+    return false;
   }
-
-  if (is_emis_grid_ascending(emis_prof_tab)==0){
-    RELXILL_ERROR("rebinning emissivity profile failed (require input emissivity to be ASCENDING with radius",
-                  status);
-    assert(emis_prof_tab->re[1]>emis_prof_tab->re[0]);
-    return;
+  for (int ii = 0; ii < n; ii++) {
+    if (are_values_different(cached_grid[ii], grid[ii])) {
+      return false;
+    }
   }
+  return true;
+}
 
+static void set_lp_radial_interpolation(LpRadialInterpolation &ipol, const emisProfile *emis_prof,
+                                        const emisProfile *emis_prof_tab, int *status) {
 
-  double* re = emis_prof->re;
-  int nr = emis_prof->nr;
+  const double *re = emis_prof->re;
+  const int nr = emis_prof->nr;
 
-  double* re_tab = emis_prof_tab->re;
-  int nr_tab = emis_prof_tab->nr;
+  const double *re_tab = emis_prof_tab->re;
+  const int nr_tab = emis_prof_tab->nr;
 
-  assert(emis_prof->re[0]>emis_prof->re[1]); // decreasing radius in input emis profile
-  assert(emis_prof_tab->re[0]<emis_prof_tab->re[1]); // increasing radius in the table
+  ipol.re.assign(re, re + nr);
+  ipol.re_tab.assign(re_tab, re_tab + nr_tab);
+  ipol.ind.resize(nr);
+  ipol.ifac_lin.resize(nr);
+  ipol.ifac_log.resize(nr);
 
   // get the extent of the disk (indices are defined such that tab->r[ind] <= r < tab->r[ind+1]
-  int ind_rmin = binary_search(re_tab, nr_tab, re[ nr - 1]);
+  int ind_rmin = binary_search(re_tab, nr_tab, re[nr - 1]);
 
   assert(ind_rmin >= 0);
   assert(ind_rmin < nr_tab - 1);
@@ -160,12 +175,26 @@ void rebin_emisprofile_on_radial_grid(emisProfile *emis_prof, const emisProfile*
           RELXILL_ERROR("interpolation of rel_table on fine radial grid failed due to corrupted grid", status);
           printf("   --> radius %.4e ABOVE the maximal possible radius of %.4e \n",
                  re[ii], RELTABLE_MAX_R);
+          ipol.re.clear();  // the interpolation is not valid
           CHECK_STATUS_VOID(*status);
         }
       }
     }
 
-    const double inter_r = get_ipol_factor_radius(re_tab[kk], re_tab[kk + 1], emis_prof_tab->del_emit[kk], re[ii]);
+    ipol.ind[ii] = kk;
+    ipol.ifac_lin[ii] = get_ipol_factor_radius(re_tab[kk], re_tab[kk + 1], 0.0, re[ii]);
+    ipol.ifac_log[ii] = get_ipol_factor_radius(re_tab[kk], re_tab[kk + 1], M_PI / 2, re[ii]);
+  }
+}
+
+static void interpol_emisprofile_radius(emisProfile *emis_prof, const emisProfile *emis_prof_tab,
+                                        const LpRadialInterpolation &ipol) {
+
+  for (int ii = 0; ii < emis_prof->nr; ii++) {
+    const int kk = ipol.ind[ii];
+    // linear interpolation in radius for emission angles <= 75deg (see get_ipol_factor_radius)
+    const double inter_r =
+        (emis_prof_tab->del_emit[kk] / M_PI * 180.0 <= 75.0) ? ipol.ifac_lin[ii] : ipol.ifac_log[ii];
 
     //  log grid for the intensity (due to the function profile)
     emis_prof->emis[ii] = interp_log_1d(inter_r, emis_prof_tab->emis[kk], emis_prof_tab->emis[kk + 1]);
@@ -174,6 +203,46 @@ void rebin_emisprofile_on_radial_grid(emisProfile *emis_prof, const emisProfile*
   }
 }
 
+static int check_emis_grids_rebin(const emisProfile *emis_prof, const emisProfile *emis_prof_tab, int *status) {
+
+  if (is_emis_grid_ascending(emis_prof)==1){
+    RELXILL_ERROR("rebinning emissivity profile failed (require output radial grid of emissivity to be descending with radius",
+                  status);
+    assert(emis_prof->re[0]>emis_prof->re[1]);
+    return 0;
+  }
+
+  if (is_emis_grid_ascending(emis_prof_tab)==0){
+    RELXILL_ERROR("rebinning emissivity profile failed (require input emissivity to be ASCENDING with radius",
+                  status);
+    assert(emis_prof_tab->re[1]>emis_prof_tab->re[0]);
+    return 0;
+  }
+
+  return 1;
+}
+
+/**
+ *
+ * @param emis_prof (required to be descending in radius)
+ * @param emis_prof_tab (required to be ascending in radius)
+ * @param status
+ *
+ * @detail function "invert_emis_profile" can be used to convert
+ */
+void rebin_emisprofile_on_radial_grid(emisProfile *emis_prof, const emisProfile* emis_prof_tab, int *status) {
+
+  if (!check_emis_grids_rebin(emis_prof, emis_prof_tab, status)) {
+    return;
+  }
+
+  LpRadialInterpolation ipol;
+  set_lp_radial_interpolation(ipol, emis_prof, emis_prof_tab, status);
+  CHECK_STATUS_VOID(*status);
+
+  interpol_emisprofile_radius(emis_prof, emis_prof_tab, ipol);
+}
+
 
 
 int is_emis_grid_ascending(const emisProfile* emis){
@@ -253,23 +322,118 @@ void apply_emis_fluxboost_source_disk(emisProfile *emisProf, double a, double he
 }
 
 /**
- * @brief calculate the emissivity profile of a lamp post point source
- * Important: from the relParam input values, height and beta will be ignored (as this allows
- * the routine to be called for different values if height and beta for an extended source)
- * @param emis_profile
- * @param param
- * @param height
- * @param beta
- * @param tab
- * @param status
+ * parameters the emissivity profile of a lamp post point source depends on (additionally to the radial grid)
+ *  - beta: velocity of the source (for the flux boost)
+ *  - beta_refl_frac: velocity used for the reflection fraction (identical to beta for a single point source)
  */
-static void calc_emis_jet_point_source(emisProfile *emis_profile, const relParam *param, double height, double beta,
-                                       lpTable *tab, int *status) {
+struct LpEmisKey {
+  double a;
+  double height;
+  double beta;
+  double beta_refl_frac;
+  double gamma;
+  double rin;
+  double rout;
+
+  [[nodiscard]] bool is_different(const LpEmisKey &other) const {
+    return are_values_different(a, other.a) || are_values_different(height, other.height)
+        || are_values_different(beta, other.beta) || are_values_different(beta_refl_frac, other.beta_refl_frac)
+        || are_values_different(gamma, other.gamma)
+        || are_values_different(rin, other.rin) || are_values_different(rout, other.rout);
+  }
+};
+
+/** emissivity profile (on the radial grid re) and reflection fraction of a lamp post point source */
+struct LpEmisCacheEntry {
+  LpEmisKey key{};
+  std::vector<double> re;
+  std::vector<double> emis;
+  std::vector<double> del_emit;
+  std::vector<double> del_inc;
+  lpReflFrac photon_fate_fractions{};
+};
+
+/**
+ * cache of the lamp post emissivity (thread_local: every thread evaluating the model has its own context)
+ * @details The emissivity only depends on the LpEmisKey and the radial grid, but not on the other parameters
+ * of the system parameter cache (e.g., the inclination). The last LP_EMIS_CACHE_SIZE profiles are stored, as
+ * well as the interpolation of the table onto the radial grid, which only depends on the spin and the grid.
+ */
+#define LP_EMIS_CACHE_SIZE 4
+
+struct LpEmisCache {
+  std::vector<LpEmisCacheEntry> entries;
+  size_t next_entry = 0;  // the oldest entry is replaced
+  LpRadialInterpolation radial_ipol;
+};
+
+static thread_local LpEmisCache cached_lp_emis;
+
+/** find the entry of the given key, which was calculated on the radial grid of the emissivity profile */
+static LpEmisCacheEntry *find_lp_emis_entry(std::vector<LpEmisCacheEntry> &entries, const LpEmisKey &key,
+                                            const emisProfile *emis_profile) {
+  for (auto &entry: entries) {
+    if (!entry.key.is_different(key) && is_same_radial_grid(entry.re, emis_profile->re, emis_profile->nr)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+static void store_lp_emis_entry(LpEmisCacheEntry &entry, const LpEmisKey &key, const emisProfile *emis_profile) {
+  const int nr = emis_profile->nr;
+  entry.key = key;
+  entry.re.assign(emis_profile->re, emis_profile->re + nr);
+  entry.emis.assign(emis_profile->emis, emis_profile->emis + nr);
+  entry.del_emit.assign(emis_profile->del_emit, emis_profile->del_emit + nr);
+  entry.del_inc.assign(emis_profile->del_inc, emis_profile->del_inc + nr);
+  entry.photon_fate_fractions = *(emis_profile->photon_fate_fractions);
+}
+
+static void set_cached_lp_emis(const LpEmisKey &key, const emisProfile *emis_profile) {
+
+  auto &cache = cached_lp_emis;
+  if (cache.entries.size() < LP_EMIS_CACHE_SIZE) {
+    cache.entries.emplace_back();
+    cache.next_entry = cache.entries.size() - 1;
+  }
+  auto &entry = cache.entries[cache.next_entry];
+  cache.next_entry = (cache.next_entry + 1) % LP_EMIS_CACHE_SIZE;
+
+  store_lp_emis_entry(entry, key, emis_profile);
+}
+
+/**
+ * @brief get the interpolation of the table onto the radial grid of the emissivity profile (the radial grid
+ * of the table depends on the spin, so it is only re-calculated for a different spin or radial grid)
+ */
+static const LpRadialInterpolation &get_lp_radial_interpolation(const emisProfile *emis_profile,
+                                                                const emisProfile *emis_profile_table,
+                                                                int *status) {
+  auto &cache = cached_lp_emis;
+  if (!is_same_radial_grid(cache.radial_ipol.re, emis_profile->re, emis_profile->nr)
+      || !is_same_radial_grid(cache.radial_ipol.re_tab, emis_profile_table->re, emis_profile_table->nr)) {
+    set_lp_radial_interpolation(cache.radial_ipol, emis_profile, emis_profile_table, status);
+  }
+  return cache.radial_ipol;
+}
+
+/**
+ * @brief calculate the emissivity profile of a lamp post point source, without using the cache
+ * (see calc_emis_jet_point_source for the parameters)
+ */
+static void calc_emis_jet_point_source_uncached(emisProfile *emis_profile, const relParam *param, double height,
+                                                double beta, lpTable *tab, int *status) {
   CHECK_STATUS_VOID(*status);
 
   emisProfile *emis_profile_table = interpol_lptable(param->a, height, tab, status);
 
-  rebin_emisprofile_on_radial_grid(emis_profile, emis_profile_table, status);
+  if (check_emis_grids_rebin(emis_profile, emis_profile_table, status)) {
+    const auto &radial_ipol = get_lp_radial_interpolation(emis_profile, emis_profile_table, status);
+    if (*status == EXIT_SUCCESS) {
+      interpol_emisprofile_radius(emis_profile, emis_profile_table, radial_ipol);
+    }
+  }
 
   // calculate the angle under which photons are emitted from the source such that they hit the outer edge of
   // the simulated accretion disk (i.e., photons with a larger emission angle are able to reach the observer)
@@ -284,6 +448,41 @@ static void calc_emis_jet_point_source(emisProfile *emis_profile, const relParam
   emis_profile->normFactorPrimSpec = 0.0; // currently not used, calculated directly in add_primary_component
 }
 
+/**
+ * @brief calculate the emissivity profile of a lamp post point source
+ * Important: from the relParam input values, height and beta will be ignored (as this allows
+ * the routine to be called for different values if height and beta for an extended source)
+ * @param emis_profile
+ * @param param
+ * @param height
+ * @param beta
+ * @param tab
+ * @param status
+ */
+static void calc_emis_jet_point_source(emisProfile *emis_profile, const relParam *param, double height, double beta,
+                                       lpTable *tab, int *status) {
+  CHECK_STATUS_VOID(*status);
+
+  const LpEmisKey key{param->a, height, beta, param->beta, param->gamma, param->rin, param->rout};
+  const LpEmisCacheEntry *entry = find_lp_emis_entry(cached_lp_emis.entries, key, emis_profile);
+  prof_cache_access(PROF_CACHE_LP_EMIS, entry != nullptr);
+
+  if (entry != nullptr) {
+    std::copy(entry->emis.begin(), entry->emis.end(), emis_profile->emis);
+    std::copy(entry->del_emit.begin(), entry->del_emit.end(), emis_profile->del_emit);
+    std::copy(entry->del_inc.begin(), entry->del_inc.end(), emis_profile->del_inc);
+    emis_profile->photon_fate_fractions = new_lpReflFrac(status);
+    CHECK_STATUS_VOID(*status);
+    *(emis_profile->photon_fate_fractions) = entry->photon_fate_fractions;
+    emis_profile->normFactorPrimSpec = 0.0;
+  } else {
+    calc_emis_jet_point_source_uncached(emis_profile, param, height, beta, tab, status);
+    if (*status == EXIT_SUCCESS) {
+      set_cached_lp_emis(key, emis_profile);
+    }
+  }
+}
+
 int modelLampPostPointsource(const relParam *param) {
   const double htopPrecLimit = 1e-3;
   if ((fabs(param->htop) <= 1.0) || (param->htop - htopPrecLimit <= param->height)) {
@@ -315,16 +514,34 @@ double jetSpeedConstantAccel(double beta100, double height, double hbase) {
   return beta;
 }
 
-// get the extended source geometry in height and allocate necessary parameters
+/**
+ * @brief get the extended source geometry in height and allocate necessary parameters
+ * @details The boundaries of the slices are the base (height) and the top (htop) of the jet, and all
+ * points of a fixed logarithmic grid in height (NHBINS_PER_DECADE_EXTENDED_SOURCE per decade) in between.
+ * Therefore, all slices except the first and the last one do not change with height or htop, which allows
+ * their emissivity to be re-used (see calc_emis_jet_extended).
+ */
 extPrimSource *getExtendedJetGeom(const relParam *param, int *status) {
 
-  extPrimSource *source = new_extendedPrimarySource(NHBINS_VERTICALLY_EXTENDED_SOURCE, status);
+  // check and set the parameters as defined for the extended jet
+  assert(param->height < param->htop);
+
+  // index of the first and last grid point strictly in between the base and the top (a point very close to
+  // the base or the top is not used, as this would lead to a slice of almost zero width)
+  const double grid_prec = 1e-6;
+  const int ind_lo = static_cast<int>(floor(log10(param->height) * NHBINS_PER_DECADE_EXTENDED_SOURCE + grid_prec)) + 1;
+  const int ind_hi = static_cast<int>(ceil(log10(param->htop) * NHBINS_PER_DECADE_EXTENDED_SOURCE - grid_prec)) - 1;
+  const int nh = std::max(ind_hi - ind_lo + 2, 1);
+
+  extPrimSource *source = new_extendedPrimarySource(nh, status);
   CHECK_MALLOC_RET_STATUS(source, status, source)
 
-  get_log_grid(source->heightArr, source->nh + 1, param->height, param->htop);
+  source->heightArr[0] = param->height;
+  for (int ii = 1; ii < nh; ii++) {
+    source->heightArr[ii] = pow(10.0, (ind_lo + ii - 1) / static_cast<double>(NHBINS_PER_DECADE_EXTENDED_SOURCE));
+  }
+  source->heightArr[nh] = param->htop;
 
-  // check and set the parameters as defined for the extended jet
-  assert(param->height < param->htop);
   double beta100Rg = param->beta;
   for (int ii = 0; ii < source->nh; ii++) {
     source->heightMean[ii] = 0.5 * (source->heightArr[ii] + source->heightArr[ii + 1]);
@@ -338,7 +555,7 @@ extPrimSource *getExtendedJetGeom(const relParam *param, int *status) {
   return source;
 }
 
-static void addSingleReturnFractions(lpReflFrac *reflFracAvg, lpReflFrac *singleReflFrac, double fraction) {
+static void addSingleReturnFractions(lpReflFrac *reflFracAvg, const lpReflFrac *singleReflFrac, double fraction) {
 
   reflFracAvg->refl_frac += singleReflFrac->refl_frac * fraction;
   reflFracAvg->f_ad += singleReflFrac->f_ad * fraction;
@@ -347,11 +564,20 @@ static void addSingleReturnFractions(lpReflFrac *reflFracAvg, lpReflFrac *single
 
 }
 
+/**
+ * emissivity of all slices of the last extended source (thread_local: every thread evaluating the model has
+ * its own context). A slice only depends on the spin, its height and velocity, gamma, and the disk, such that
+ * the slices are re-used for a different inclination, and all slices except the top one are re-used for a
+ * different htop (and all except the lowest one for a different base of the jet, as long as beta=0).
+ */
+static thread_local std::vector<LpEmisCacheEntry> cached_lp_emis_slices;
+
 /*
- *  EXTENDED LAMP POST:  [deprecated, currently not used in any model]
+ *  EXTENDED LAMP POST:
  *  - if htop <= heigh=hbase we assume it's a point-like jet
  *  - the meaning of beta for the extended jet is the velocity at 100Rg, in case the
  *    profile is of interest, it will be output in the debug mode
+ *  - the emissivity of all slices which are not cached is calculated in parallel
  */
 void calc_emis_jet_extended(emisProfile *emisProf,
                             const relParam *param,
@@ -361,50 +587,77 @@ void calc_emis_jet_extended(emisProfile *emisProf,
   extPrimSource *source = getExtendedJetGeom(param, status);
   CHECK_STATUS_VOID(*status);
 
-  emisProfile *emisProfSingle = new_emisProfile(emisProf->re, emisProf->nr, status);
+  // take all cached slices (moving them is fine, as the cache is replaced by the current slices below)
+  auto &cached_slices = cached_lp_emis_slices;
+  std::vector<LpEmisCacheEntry> slices(source->nh);
+  std::vector<size_t> uncached_slices;
+  for (int ii = 0; ii < source->nh; ii++) {
+    const LpEmisKey key{param->a, source->heightMean[ii], source->beta[ii], param->beta, param->gamma,
+                        param->rin, param->rout};
+    LpEmisCacheEntry *entry = find_lp_emis_entry(cached_slices, key, emisProf);
+    prof_cache_access(PROF_CACHE_LP_EMIS, entry != nullptr);
+    if (entry != nullptr) {
+      slices[ii] = std::move(*entry);
+    } else {
+      slices[ii].key = key;
+      uncached_slices.push_back(ii);
+    }
+  }
+
+  std::vector<int> slice_status(uncached_slices.size(), EXIT_SUCCESS);
+  ThreadPool::instance().parallel_for(uncached_slices.size(), [&](size_t ii) {
+    auto &slice = slices[uncached_slices[ii]];
+    int *status_slice = &slice_status[ii];
+
+    emisProfile *emisProfSingle = new_emisProfile(emisProf->re, emisProf->nr, status_slice);
+    calc_emis_jet_point_source_uncached(emisProfSingle, param, slice.key.height, slice.key.beta, tab, status_slice);
+    if (*status_slice == EXIT_SUCCESS) {
+      store_lp_emis_entry(slice, slice.key, emisProfSingle);
+    }
+    free_emisProfile(emisProfSingle);
+  });
+
+  cached_slices.clear();
+  for (auto status_slice: slice_status) {
+    if (status_slice != EXIT_SUCCESS) {
+      RELXILL_ERROR("calculating the emissivity of the extended source failed", status);
+      free_extendedPrimarySource(source);
+      return;
+    }
+  }
 
   setArrayToZero(emisProf->emis, emisProf->nr);
+  setArrayToZero(emisProf->del_inc, emisProf->nr);
+  setArrayToZero(emisProf->del_emit, emisProf->nr);
   emisProf->photon_fate_fractions = new_lpReflFrac(status);
-  emisProf->normFactorPrimSpec = 0.0;
-
+  emisProf->normFactorPrimSpec = 0.0; // currently not used, calculated directly in add_primary_component
 
+  // add the slices in a fixed order (such that the result does not depend on the number of threads)
   for (int ii = 0; ii < source->nh; ii++) {
-
-    calc_emis_jet_point_source(emisProfSingle,
-                               param,
-                               source->heightMean[ii],
-                               source->beta[ii],
-                               tab,
-                               status);
+    const auto &slice = slices[ii];
 
     // assuming a constant luminosity in the frame of the jet
     double
         heightIntegrationFactor = (source->heightArr[ii + 1] - source->heightArr[ii]) / (param->htop - param->height);
 
     for (int jj = 0; jj < emisProf->nr; jj++) {
-      emisProf->emis[jj] += emisProfSingle->emis[jj] * heightIntegrationFactor;
-      emisProf->del_inc[jj] += emisProfSingle->del_inc[jj] * heightIntegrationFactor;
-      emisProf->del_emit[jj] += emisProfSingle->del_emit[jj] * heightIntegrationFactor;
+      emisProf->emis[jj] += slice.emis[jj] * heightIntegrationFactor;
+      emisProf->del_inc[jj] += slice.del_inc[jj] * heightIntegrationFactor;
+      emisProf->del_emit[jj] += slice.del_emit[jj] * heightIntegrationFactor;
     }
 
-    addSingleReturnFractions(emisProf->photon_fate_fractions,
-                             emisProfSingle->photon_fate_fractions,
-                             heightIntegrationFactor);
-
-    emisProf->normFactorPrimSpec += emisProfSingle->normFactorPrimSpec * heightIntegrationFactor;
-
-    free_lpReflFrac(&(emisProfSingle->photon_fate_fractions));
+    addSingleReturnFractions(emisProf->photon_fate_fractions, &slice.photon_fate_fractions, heightIntegrationFactor);
   }
 
   free_extendedPrimarySource(source);
-  free_emisProfile(emisProfSingle);
-
+  cached_slices = std::move(slices);
 }
 
 
 static lpTable* get_lp_table(int* status){
   CHECK_STATUS_RET(*status,nullptr);
 
+  std::lock_guard<std::mutex> lock(lptable_mutex);
   if (cached_lp_table == nullptr) {
     read_lp_table(LPTABLE_FILENAME, &cached_lp_table, status);
     CHECK_STATUS_RET(*status, nullptr);
@@ -582,10 +835,10 @@ extPrimSource *new_extendedPrimarySource(int nh, int *status) {
 
 void free_extendedPrimarySource(extPrimSource *source) {
   if (source != nullptr) {
-    free(source->heightArr);
-    free(source->heightMean);
-    free(source->beta);
-    free(source);
+    delete[] source->heightArr;
+    delete[] source->heightMean;
+    delete[] source->beta;
+    delete source;
   }
 
 }
@@ -604,7 +857,7 @@ lpReflFrac *new_lpReflFrac(int *status) {
 
 void free_lpReflFrac(lpReflFrac **str) {
   if (*str != nullptr) {
-    free(*str);
+    delete *str;
     *str = nullptr;
   }
 }
@@ -26,7 +26,9 @@ extern "C" {
 #include "common.h"
 }
 
-#define NHBINS_VERTICALLY_EXTENDED_SOURCE 50
+// number of slices of a vertically extended source per decade in height (at least as dense as the former
+// 50 slices between base and top for any jet extending over more than half a decade)
+#define NHBINS_PER_DECADE_EXTENDED_SOURCE 100
 
 typedef struct {
 
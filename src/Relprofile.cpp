@@ -19,6 +19,10 @@
 #include "Relcache.h"
 #include "Rellp.h"
 #include "Relphysics.h"
+#include "Profiling.h"
+#include "Buffer2D.h"
+
+#include <mutex>
 
 extern "C" {
 #include "relutility.h"
@@ -26,11 +30,13 @@ extern "C" {
 #include "reltable.h"
 }
 
-cnode *cache_syspar = nullptr;
+// caches are thread_local, i.e., every thread evaluating the model has its own context
+thread_local cnode *cache_syspar = nullptr;
 
 /** global parameters, which can be used for several calls of the model */
-relTable *ptr_rellineTable = nullptr;
-RelSysPar *cached_tab_sysPar = nullptr;
+relTable *ptr_rellineTable = nullptr;  // shared by all threads
+static std::mutex reltable_mutex;
+thread_local RelSysPar *cached_tab_sysPar = nullptr;
 
 // precision to calculate gstar from [H:1-H] instead of [0:1]
 const double GFAC_H = 5e-3;
@@ -138,16 +144,20 @@ RelSysPar *new_relSysPar(int nr, int ng, int *status) {
 }
 
 /* function interpolating the rel table values for rin,rout,mu0,incl   */
-static RelSysPar *interpol_relTable(double a, double incl, double rin, double rout,
-                                    int *status) {
+RelSysPar *interpol_relTable(double a, double incl, double rin, double rout,
+                             int *status) {
 
   // load tables
-  if (ptr_rellineTable == nullptr) {
-    print_version_number();
-    read_relline_table(RELTABLE_FILENAME, &ptr_rellineTable, status);
-    CHECK_STATUS_RET(*status, nullptr);
+  relTable *tab;
+  {
+    std::lock_guard<std::mutex> lock(reltable_mutex);
+    if (ptr_rellineTable == nullptr) {
+      print_version_number();
+      read_relline_table(RELTABLE_FILENAME, &ptr_rellineTable, status);
+      CHECK_STATUS_RET(*status, nullptr);
+    }
+    tab = ptr_rellineTable;
   }
-  relTable *tab = ptr_rellineTable;
   assert(tab != nullptr);
 
   double rms = kerr_rms(a);
@@ -310,6 +320,7 @@ static RelSysPar *interpol_relTable(double a, double incl, double rin, double ro
 RelSysPar *get_system_parameters(const relParam *param, int *status) {
 
   CHECK_STATUS_RET(*status, nullptr);
+  ProfileTimer timer{PROF_SYSTEM_PARAMETERS};
 
   inpar *sysinp = set_input_syspar(param, status);
   CHECK_STATUS_RET(*status, nullptr);
@@ -318,6 +329,10 @@ RelSysPar *get_system_parameters(const relParam *param, int *status) {
   CHECK_STATUS_RET(*status, nullptr);
 
   RelSysPar *sysPar = nullptr;
+  prof_cache_access(PROF_CACHE_SYSPAR, ca_info->syscache == 1);
+  if (is_tracing_enabled()) {
+    timer.set_args("\"cached\": " + std::to_string(ca_info->syscache));
+  }
   if (ca_info->syscache == 1 ) {
     // system parameter values are cached, so we can take it from there
     sysPar = ca_info->store->data->relSysPar;
@@ -367,16 +382,10 @@ relline_spec_multizone *new_rel_spec(int nzones, const int n_ener, int *status)
   spec->n_zones = nzones;
   spec->n_ener = n_ener;
 
-  spec->flux = (double **) malloc(spec->n_zones * sizeof(double *));
+  // all zones in one contiguous block from the memory pool
+  spec->flux = new_buffer_2d(spec->n_zones, n_ener, status);
   CHECK_MALLOC_RET_STATUS(spec->flux, status, spec)
 
-  int ii;
-
-  for (ii = 0; ii < spec->n_zones; ii++) {
-    spec->flux[ii] = (double *) malloc(n_ener * sizeof(double));
-    CHECK_MALLOC_RET_STATUS(spec->flux[ii], status, spec)
-  }
-
   spec->ener = (double *) malloc((spec->n_ener + 1) * sizeof(double));
   CHECK_MALLOC_RET_STATUS(spec->ener, status, spec)
 
@@ -398,16 +407,9 @@ RelCosne *new_rel_cosne(int nzones, int n_incl, int *status) {
   spec->cosne = (double *) malloc(spec->n_cosne * sizeof(double));
   CHECK_MALLOC_RET_STATUS(spec->cosne, status, spec)
 
-  spec->dist = (double **) malloc(spec->n_zones * sizeof(double *));
+  spec->dist = new_buffer_2d(spec->n_zones, spec->n_cosne, status);
   CHECK_MALLOC_RET_STATUS(spec->dist, status, spec)
 
-  int ii;
-
-  for (ii = 0; ii < spec->n_zones; ii++) {
-    spec->dist[ii] = (double *) malloc(spec->n_cosne * sizeof(double));
-    CHECK_MALLOC_RET_STATUS(spec->dist[ii], status, spec)
-  }
-
   return spec;
 }
 
@@ -415,7 +417,7 @@ RelCosne *new_rel_cosne(int nzones, int n_incl, int *status) {
   * Initialize the structure to store the relline spectra for multiple radial zones
   **/
 void init_relline_spec_multizone(relline_spec_multizone **spec, relParam *param, xillTable *xill_tab, const double *radial_zones,
-                                 double **pt_ener, const int n_ener, int *status) {
+                                 const double *const *pt_ener, const int n_ener, int *status) {
 
   CHECK_STATUS_VOID(*status);
 
@@ -480,6 +482,7 @@ static str_relb_func *new_str_relb_func(RelSysPar *sysPar, int *status) {
 
   str->gstar = sysPar->gstar;
   str->ng = sysPar->ng;
+  set_grid_descriptor(&str->gstar_grid, str->gstar, str->ng);
   str->limb_law = 0;
 
   return str;
@@ -495,7 +498,7 @@ static double relb_func(double eg, int k, str_relb_func *str) {
   // find the indices in the original g-grid, but check first if they have already been calculated
   int ind;
   if (!((egstar >= str->gstar[str->save_g_ind]) && (egstar < str->gstar[str->save_g_ind + 1]))) {
-    str->save_g_ind = binary_search(str->gstar, str->ng, egstar);
+    str->save_g_ind = grid_search(&str->gstar_grid, egstar);
   }
   ind = str->save_g_ind;
 
@@ -801,7 +804,7 @@ int static get_cosne_bin(double mu, RelCosne *dat) {
 }
 
 /** calculate the relline profile(s) for all given zones **/
-str_relb_func *cached_str_relb_func = nullptr;
+thread_local str_relb_func *cached_str_relb_func = nullptr;
 
 static double calculate_radiallyResolvedFluxObs(str_relb_func *relb_func, relline_spec_multizone *spec, double weight) {
 
@@ -832,9 +835,13 @@ bool write_outfile_radial_flux(int n_zones) {
   return shouldOutfilesBeWritten() && n_zones == 1;
 }
 
-void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *status) {
-
-  CHECK_STATUS_VOID(*status);
+/**
+ * @brief integrate the relline profile (and the angular distribution, if calc_angular_dist) over the disk
+ * @details specialized at compile time, such that the bookkeeping of the angular distribution is
+ * only compiled into the loop over the radii if it is needed (i.e., not for relline and relconv)
+ */
+template<bool calc_angular_dist>
+static void integrate_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *status) {
 
   double line_ener = 1.0;
 
@@ -846,12 +853,19 @@ void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *
   }
 
   // store the (energy)-integrated flux in an array for debugging
+  const bool write_radial_flux = write_outfile_radial_flux(spec->n_zones);
   double *radialFlux = nullptr;
-  if (write_outfile_radial_flux(spec->n_zones)) {
+  if (write_radial_flux) {
     radialFlux = (double *) malloc(sizeof(double) * sysPar->nr);
     CHECK_MALLOC_VOID_STATUS(radialFlux, status)
   }
 
+  // the energy grid is usually logarithmic and the radial zones are either logarithmic or a single zone
+  gridDescriptor ener_grid;
+  gridDescriptor zone_grid;
+  set_grid_descriptor(&ener_grid, spec->ener, spec->n_ener + 1);
+  set_grid_descriptor(&zone_grid, spec->rgrid, spec->n_zones + 1);
+
   int ii;
   int jj;
   for (ii = 0; ii < sysPar->nr; ii++) {
@@ -874,11 +888,11 @@ void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *
 
       /** search for the indices in the ener-array
           index is such that: ener[k]<=e<ener[k+1] **/
-      int ielo = binary_search(spec->ener, spec->n_ener + 1, egmin);
-      int iehi = binary_search(spec->ener, spec->n_ener + 1, egmax);
+      int ielo = grid_search(&ener_grid, egmin);
+      int iehi = grid_search(&ener_grid, egmax);
 
       // in which ionization bin are we?
-      int izone = binary_search(spec->rgrid, spec->n_zones + 1, sysPar->re[ii]);
+      int izone = grid_search(&zone_grid, sysPar->re[ii]);
 
       // set the current parameters in a cached structure (and reset some values) [optimizes speed]
       set_str_relbf(cached_str_relb_func,
@@ -899,13 +913,13 @@ void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *
         spec->flux[izone][jj] += tmp_var * weight;
       }
 
-      if (write_outfile_radial_flux(spec->n_zones)) {
+      if (write_radial_flux) {
         assert(radialFlux != nullptr);
         radialFlux[ii] = calculate_radiallyResolvedFluxObs(cached_str_relb_func, spec, weight);
       }
 
       /** only calculate the distribution if we need it here  **/
-      if (spec->rel_cosne != nullptr) {
+      if constexpr (calc_angular_dist) {
         int kk;
         int imu;
         str_relb_func *da = cached_str_relb_func; // define a shortcut
@@ -945,7 +959,7 @@ void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *
        which is freed if the cache is full and therefore causes "invalid reads" **/
   free_str_relb_func(&cached_str_relb_func);
 
-  if (write_outfile_radial_flux(spec->n_zones)) {
+  if (write_radial_flux) {
     save_relline_radial_flux_profile(sysPar->re, radialFlux, sysPar->nr);
   }
   if (radialFlux != nullptr) {
@@ -953,6 +967,19 @@ void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *
     radialFlux = nullptr;
   }
 
+}
+
+void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *status) {
+
+  CHECK_STATUS_VOID(*status);
+  ProfileTimer timer{PROF_RELLINE_PROFILE};
+
+  if (spec->rel_cosne != nullptr) {
+    integrate_relline_profile<true>(spec, sysPar, status);
+  } else {
+    integrate_relline_profile<false>(spec, sysPar, status);
+  }
+
   CHECK_RELXILL_DEFAULT_ERROR(status);
 
 }
@@ -961,6 +988,23 @@ void free_cached_relTable() {
   free_relTable(ptr_rellineTable);
 }
 
+long long get_relSysPar_nbytes(const RelSysPar *sys_par) {
+  if (sys_par == nullptr) {
+    return 0;
+  }
+  const int nr = sys_par->nr;
+  const int ng = sys_par->ng;
+  auto nbytes = static_cast<long long>(sizeof(RelSysPar) + (3 * nr + 2 * ng) * sizeof(double)
+      + 2 * nr * (sizeof(double **) + ng * (sizeof(double *) + 2 * sizeof(double))));
+  if (sys_par->emis != nullptr) {
+    nbytes += static_cast<long long>(sizeof(emisProfile) + 3 * sys_par->emis->nr * sizeof(double));
+    if (sys_par->emis->photon_fate_fractions != nullptr) {
+      nbytes += static_cast<long long>(sizeof(lpReflFrac));
+    }
+  }
+  return nbytes;
+}
+
 // should not be called manually as it is automatically freed in the cache
 void free_relSysPar(RelSysPar *sysPar) {
   if (sysPar != nullptr) {
@@ -26,17 +26,21 @@ void calc_relline_profile(relline_spec_multizone *spec, RelSysPar *sysPar, int *
 
 RelSysPar *get_system_parameters(const relParam *param, int *status);
 
+RelSysPar *interpol_relTable(double a, double incl, double rin, double rout, int *status);
+
 void renorm_relline_profile(relline_spec_multizone *spec, relParam *rel_param, const int *status);
 
 void init_relline_spec_multizone(relline_spec_multizone **spec,
                                  relParam *param,
                                  xillTable *xill_tab,
                                  const double *radial_zones,
-                                 double **pt_ener,
+                                 const double *const *pt_ener,
                                  int n_ener,
                                  int *status);
 
 void free_relSysPar(RelSysPar *sysPar);
+/** memory of the system parameters, including the emissivity profile (in bytes) */
+long long get_relSysPar_nbytes(const RelSysPar *sys_par);
 void free_cached_relTable();
 void free_relprofile_cache();
 void free_cache_syspar();
@@ -17,10 +17,14 @@
 */
 
 #include <iostream>
+#include <vector>
 #include "Relreturn_BlackBody.h"
 #include "Relbase.h"
 #include "Relphysics.h"
 #include "Relreturn_Datastruct.h"
+#include "Profiling.h"
+#include "RebinOperator.h"
+#include "Buffer2D.h"
 
 extern "C" {
 #include "xilltable.h"
@@ -151,7 +155,8 @@ returnSpec2D *spec_returnrad_blackbody(double *ener, double *spec, double *spec_
                          dat->rlo, dat->rhi, dat->nrad, dat, status);
   }
 
-  free(temperature);
+  delete[] temperature;
+  free_returningFractions(&dat);  // the returnSpec has its own copy of the radial grid
 
   return returnSpec;
 
@@ -169,6 +174,7 @@ static void calc_rr_bbspec_gzone(double *ener, int nener, double *spec, double t
       spec[jj] += spec_g[jj] * frac_g[kk];
     }
   }
+  delete[] spec_g;
 
 }
 
@@ -204,6 +210,8 @@ static void calc_rr_bbspec_ring(double* ener, double* spec, int nener, int irad,
     }
 
   }
+  delete[] gfac;
+  delete[] spec_r;
 }
 
 
@@ -233,6 +241,7 @@ static double **get_returnrad_specs(double *ener_inp, int nener_inp, returningFr
 
     rebin_mean_flux(ener_inp, spec_zones[ii], nener_inp, ener, spec, nener, status);
   }
+  delete[] spec;
 
   normalizeFluxRrad(dat->nrad, nener_inp, ener_inp, spec_zones);
 
@@ -331,7 +340,8 @@ void spec_diskbb(double* ener, double* spec, int n, double Tin,  double spin, in
 
   sum_2Dspec(spec, spec_arr, n, dat->nrad, status);
 
-  free_2d(&spec_arr, dat->nrad);
+  free_buffer_2d(spec_arr);
+  free_returningFractions(&dat);
   delete[]temperature;
 }
 
@@ -388,16 +398,23 @@ double calcXillverNormfacRetrad2BoodyAtHighenergy(double kTbb,
   return normReturnSpec / normBbodySpec;
 }
 
-void getZoneReflectedReturnFluxDiskframe(xillParam *xill_param, relline_spec_multizone* rel_profile, const returnSpec2D *returnSpec,
-                                         double *xill_flux_returnrad, int izone, int* status) {
+/**
+ * @brief normalized xillver reflection of the returning radiation of zone izone (i.e., without the boost)
+ * @return factor the reflection needs to be scaled with, to match the incident returning radiation
+ */
+static double getZoneReflectedReturnFluxUnboosted(xillParam *xill_param, relline_spec_multizone *rel_profile,
+                                                  const returnSpec2D *returnSpec, double *xill_flux, int izone,
+                                                  int *status) {
+
+  CHECK_STATUS_RET(*status, 0.0);
 
   // assumption: we use Tin for all zones
-  getNormalizedXillverSpec(xill_flux_returnrad, returnSpec->ener, returnSpec->n_ener, xill_param,
+  getNormalizedXillverSpec(xill_flux, returnSpec->ener, returnSpec->n_ener, xill_param,
                            rel_profile->rel_cosne->dist[izone], status);
 
 
   double xillverReflectionNormFactor = getXillverNormFactorFromPrimarySpectrum(returnSpec->specRet[izone], returnSpec->ener, returnSpec->n_ener, status);
-  CHECK_STATUS_VOID(*status);
+  CHECK_STATUS_RET(*status, 0.0);
 
   double* xillver_prim_out = getXillverPrimaryBBodyNormalized(xill_param->kTbb, returnSpec->specRet[izone],
       returnSpec->ener, returnSpec->n_ener, status);
@@ -407,17 +424,33 @@ void getZoneReflectedReturnFluxDiskframe(xillParam *xill_param, relline_spec_mul
                                                                                  xillver_prim_out,
                                                                                  returnSpec->ener,
                                                                                  returnSpec->n_ener);
-  free(xillver_prim_out);
+  delete[] xillver_prim_out;
+
+  return xillverReflectionNormFactor * normfacMatchAtHighEnergies;
+}
+
+static void applyBoostZoneReflectedFlux(double boost, double norm_factor, const double *xill_flux_unboosted,
+                                        const returnSpec2D *returnSpec, double *xill_flux_returnrad, int izone) {
 
   for (int jj = 0; jj < returnSpec->n_ener; jj++) {
-    xill_flux_returnrad[jj] *= fabs(xill_param->boost) ;
-    xill_flux_returnrad[jj] *= xillverReflectionNormFactor * normfacMatchAtHighEnergies;
+    xill_flux_returnrad[jj] = xill_flux_unboosted[jj] * fabs(boost);
+    xill_flux_returnrad[jj] *= norm_factor;
 
-    if (xill_param->boost >= 0) {
+    if (boost >= 0) {
       xill_flux_returnrad[jj] += returnSpec->specPri[izone][jj];
     }
   }
+}
 
+void getZoneReflectedReturnFluxDiskframe(xillParam *xill_param, relline_spec_multizone* rel_profile, const returnSpec2D *returnSpec,
+                                         double *xill_flux_returnrad, int izone, int* status) {
+
+  double norm_factor =
+      getZoneReflectedReturnFluxUnboosted(xill_param, rel_profile, returnSpec, xill_flux_returnrad, izone, status);
+  CHECK_STATUS_VOID(*status);
+
+  applyBoostZoneReflectedFlux(xill_param->boost, norm_factor, xill_flux_returnrad, returnSpec,
+                              xill_flux_returnrad, izone);
 }
 
 void getZoneIncidentReturnFlux(xillParam *xill_param, const returnSpec2D *returnSpec, double *returnFlux, int ii) {
@@ -515,114 +548,284 @@ static int should_noXillverRefl_calculated(){
 
 }
 
-void relxill_bb_kernel(double *ener_inp, double *spec_inp, int n_ener_inp, xillParam *xill_param, relParam *rel_param,
-    int *status) {
+
+/**
+ * cache of the relxillBB kernel (thread_local: every thread evaluating the model has its own context), where
+ * all buffers are owned by the cache and are only re-allocated if the number of zones or bins changes
+ *  - return spectra: only depend on (kTbb, Rin, Rout, a)
+ *  - reflection of each zone (without the boost): depends on the xillver and the relativistic parameters
+ *  - output spectrum: additionally depends on the boost and the input energy grid
+ */
+class BbodyKernelCache {
+ public:
+  ~BbodyKernelCache() {
+    free_returnSpec2D(&return_spec);
+    free(rel_param);
+    free(xill_param);
+  }
+
+  void invalidate() {
+    free_returnSpec2D(&return_spec);
+    zones_valid = false;
+    output_valid = false;
+  }
+
+  // return spectra
+  double kTbb = 0.0;
+  double rin = 0.0;
+  double rout = 0.0;
+  double spin = 0.0;
+  returnSpec2D *return_spec = nullptr;
+  std::vector<double> radial_grid;
+
+  // reflection of each zone
+  relParam *rel_param = nullptr;
+  xillParam *xill_param = nullptr;
+  double shift_tmax = 0.0;
+  int no_refl = -1;
+  bool zones_valid = false;
+  std::vector<std::vector<double>> zone_flux_unboosted;
+  std::vector<double> zone_norm_factor;
+
+  // work space and output spectrum
+  std::vector<std::vector<double>> zone_flux;
+  std::vector<std::vector<double>> zone_conv_out;
+  std::vector<double> single_spec_inp;
+  double boost = 0.0;
+  bool output_valid = false;
+  std::vector<double> ener_inp;
+  std::vector<double> spec_out;
+};
+
+static thread_local BbodyKernelCache cached_bbody_kernel;
+
+static void resize_zone_buffers(std::vector<std::vector<double>> &buffers, int nzones, int n_ener) {
+  buffers.resize(nzones);
+  for (auto &buf: buffers) {
+    buf.resize(n_ener);
+  }
+}
+
+static bool is_bbody_return_spec_cached(const BbodyKernelCache &cache, const xillParam *xill_param,
+                                        const relParam *rel_param) {
+  return cache.return_spec != nullptr
+      && !are_values_different(cache.kTbb, xill_param->kTbb)
+      && !are_values_different(cache.rin, rel_param->rin)
+      && !are_values_different(cache.rout, rel_param->rout)
+      && !are_values_different(cache.spin, rel_param->a);
+}
+
+static void set_cached_bbody_return_spec(BbodyKernelCache &cache, double *ener, int n_ener,
+                                         const xillParam *xill_param, const relParam *rel_param, int *status) {
 
   CHECK_STATUS_VOID(*status);
-  assert(xill_param->model_type == MOD_TYPE_RELXILLBBRET);
+  cache.invalidate();
+
+  cache.return_spec = spec_returnrad_blackbody(ener, nullptr, nullptr, n_ener, xill_param->kTbb, rel_param->rin,
+                                               rel_param->rout, rel_param->a, status);
+  CHECK_STATUS_VOID(*status);
 
+  double *radialGrid = getRadialGridFromReturntab(cache.return_spec, status);
+  CHECK_STATUS_VOID(*status);
+  cache.radial_grid.assign(radialGrid, radialGrid + cache.return_spec->nrad + 1);
+  delete[] radialGrid;
 
-  // get a standard grid for the convolution (is rebinned later to the input grid)
-  int n_ener;
-  double *ener;
-  get_relxill_conv_energy_grid(&n_ener, &ener, status);
+  cache.kTbb = xill_param->kTbb;
+  cache.rin = rel_param->rin;
+  cache.rout = rel_param->rout;
+  cache.spin = rel_param->a;
+}
 
-  xillTable *xill_tab = nullptr;
-  get_init_xillver_table(&xill_tab, xill_param->model_type, xill_param->prim_type, status);
+static bool are_bbody_zones_cached(const BbodyKernelCache &cache, const xillParam *xill_param,
+                                   const relParam *rel_param, int no_refl) {
+  return cache.zones_valid
+      && cache.no_refl == no_refl
+      && !are_values_different(cache.shift_tmax, xill_param->shiftTmaxRRet)
+      && did_xill_param_change(cache.xill_param, xill_param) == 0
+      && did_rel_param_change(cache.rel_param, rel_param) == 0;
+}
 
-  returnSpec2D *returnSpec = spec_returnrad_blackbody(ener, nullptr, nullptr, n_ener, xill_param->kTbb, rel_param->rin,
-                                                      rel_param->rout, rel_param->a, status);
+static bool is_bbody_output_cached(const BbodyKernelCache &cache, const double *ener_inp, int n_ener_inp,
+                                   double boost) {
+  if (!cache.output_valid || are_values_different(cache.boost, boost)
+      || static_cast<int>(cache.spec_out.size()) != n_ener_inp) {
+    return false;
+  }
+  for (int ii = 0; ii <= n_ener_inp; ii++) {
+    if (cache.ener_inp[ii] != ener_inp[ii]) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  double *radialGrid = getRadialGridFromReturntab(returnSpec, status);
-  RelSysPar* sys_par = get_system_parameters(rel_param, status);
-  relline_spec_multizone
-      *rel_profile = relbase_profile(ener, n_ener, rel_param, sys_par, xill_tab, radialGrid, returnSpec->nrad, status);
+static void write_bbody_kernel_debug_output(BbodyKernelCache &cache, xillParam *xill_param, double *ener,
+                                            int n_ener, int no_refl, int *status) {
 
-  // ========== //
-  auto single_spec_inp = new double[n_ener_inp];
-  auto spec_conv_out = new double *[returnSpec->nrad];
-  auto xillver_out = new double*[returnSpec->nrad];
-  auto xillver_prim_out = new double*[returnSpec->nrad];
- // ========== //
+  const returnSpec2D *returnSpec = cache.return_spec;
 
-  double Tin = xill_param ->kTbb;
+  std::vector<double *> spec_conv_out(returnSpec->nrad);
+  std::vector<double *> xillver_out(returnSpec->nrad);
+  std::vector<double *> xillver_prim_out(returnSpec->nrad);
+  const double kTbb = (no_refl) ? xill_param->kTbb : xill_param->kTbb * xill_param->shiftTmaxRRet;
+  for (int ii = 0; ii < returnSpec->nrad; ii++) {
+    spec_conv_out[ii] = cache.zone_conv_out[ii].data();
+    xillver_out[ii] = cache.zone_flux[ii].data();
+    xillver_prim_out[ii] = scaledXillverPrimaryBBodyHighener(kTbb, returnSpec->specRet[ii],
+                                                             returnSpec->ener, returnSpec->n_ener, status);
+  }
 
-  specCache* spec_cache =  init_global_specCache(status);
-  CHECK_STATUS_VOID(*status);
-  setArrayToZero(spec_inp, n_ener_inp);
-  for (int ii = 0; ii < rel_profile->n_zones; ii++) {
-    assert(returnSpec->n_ener==n_ener);
+  //  std::cout << " writing BBret diagnose outfiles " << std::endl;
 
-    xillver_out[ii] = new double[n_ener];
+  std::string fname = "!debug-testrr-bbody-obs-reflect.fits";
 
-    if ( should_noXillverRefl_calculated() ){
-      getZoneIncidentReturnFlux(xill_param, returnSpec, xillver_out[ii], ii);
+  if (no_refl) {
+    if (fabs(xill_param->boost) < 1e-8) {
+      fname = "!debug-testrr-bbody-obs-mirror-primary.fits";
+    } else if (xill_param->boost < 0) {
+      fname = "!debug-testrr-bbody-obs-mirror-refl.fits";
     } else {
-      xill_param->kTbb=Tin*xill_param->shiftTmaxRRet;  // currently set for testing
-      getZoneReflectedReturnFluxDiskframe(xill_param, rel_profile, returnSpec, xillver_out[ii], ii, status);
+      fname = "!debug-testrr-bbody-obs-mirror.fits";
     }
+  } else if (fabs(xill_param->boost) < 1e-8) {
+    fname = "!debug-testrr-bbody-obs-primary.fits";
+  }
 
+  fits_rr_write_2Dspec(fname.c_str(), spec_conv_out.data(), ener, n_ener,
+                       returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
 
-    xillver_prim_out[ii] = scaledXillverPrimaryBBodyHighener(xill_param->kTbb, returnSpec->specRet[ii],
-                                                             returnSpec->ener, returnSpec->n_ener, status);
- //   calculated_combined_flux(xillver_out[ii], xillver_prim_out[ii], n_ener, xill_param->boost);
 
-    spec_conv_out[ii] = new double[n_ener];
-    convolveSpectrumFFTNormalized(ener, xillver_out[ii], rel_profile->flux[ii], spec_conv_out[ii], n_ener,
-        1, 1, ii, spec_cache, status);
+  fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-xillverRefl.fits", xillver_out.data(), ener, n_ener,
+                       returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
 
+  fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-xillverPrim.fits", xillver_prim_out.data(), ener, n_ener,
+                       returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
 
-    rebin_spectrum(ener_inp, single_spec_inp, n_ener_inp, ener, spec_conv_out[ii], n_ener);
 
-    for (int jj = 0; jj < n_ener_inp; jj++) {
-      spec_inp[jj] += single_spec_inp[jj];
-    }
+  fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-specRet.fits", returnSpec->specRet, ener, n_ener,
+                       returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
+  fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-specPri.fits", returnSpec->specPri, ener, n_ener,
+                       returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
 
+  for (auto spec: xillver_prim_out) {
+    delete[] spec;
   }
+}
 
-  // clean spectrum
-  setLowValuesToZero(spec_inp, n_ener_inp);
-  setValuesOutsideToZero(spec_inp, ener_inp, n_ener_inp);
+void relxill_bb_kernel(const double *ener_inp, double *spec_inp, int n_ener_inp, xillParam *xill_param, relParam *rel_param,
+    int *status) {
 
-  // reset Tin parameter to be safe
-  xill_param->kTbb = Tin;
+  CHECK_STATUS_VOID(*status);
+  assert(xill_param->model_type == MOD_TYPE_RELXILLBBRET);
 
-  if ( is_debug_run() ) {
+  auto &cache = cached_bbody_kernel;
 
-  //  std::cout << " writing BBret diagnose outfiles " << std::endl;
+  // special case: no caching if output files are to be written
+  if (shouldOutfilesBeWritten() || is_debug_run()) {
+    cache.invalidate();
+  }
+
+  // get a standard grid for the convolution (is rebinned later to the input grid)
+  int n_ener;
+  double *ener;
+  get_relxill_conv_energy_grid(&n_ener, &ener, status);
 
-    std::string fname = "!debug-testrr-bbody-obs-reflect.fits";
+  const int no_refl = should_noXillverRefl_calculated();
 
-    if ( should_noXillverRefl_calculated() ){
-      if (fabs(xill_param->boost) < 1e-8) {
-        fname = "!debug-testrr-bbody-obs-mirror-primary.fits";
-      } else if (xill_param->boost < 0 ){
-        fname = "!debug-testrr-bbody-obs-mirror-refl.fits";
-      } else {
-        fname = "!debug-testrr-bbody-obs-mirror.fits";
-      }
-    } else if (fabs(xill_param->boost) < 1e-8) {
-      fname = "!debug-testrr-bbody-obs-primary.fits";
+  // (1) return spectra, only depending on (kTbb, Rin, Rout, a)
+  const bool return_spec_cached = is_bbody_return_spec_cached(cache, xill_param, rel_param);
+  prof_cache_access(PROF_CACHE_BBRET_SPEC, return_spec_cached);
+  if (!return_spec_cached) {
+    set_cached_bbody_return_spec(cache, ener, n_ener, xill_param, rel_param, status);
+    CHECK_STATUS_VOID(*status);
+  }
+  returnSpec2D *returnSpec = cache.return_spec;
+  assert(returnSpec->n_ener == n_ener);
+
+  const bool zones_cached = return_spec_cached && are_bbody_zones_cached(cache, xill_param, rel_param, no_refl);
+  const bool output_cached = zones_cached && is_bbody_output_cached(cache, ener_inp, n_ener_inp, xill_param->boost);
+  prof_cache_access(PROF_CACHE_RELXILL_XILL, zones_cached);
+  prof_cache_access(PROF_CACHE_RELXILL_SPEC, output_cached);
+
+  if (output_cached) {
+    for (int jj = 0; jj < n_ener_inp; jj++) {
+      spec_inp[jj] = cache.spec_out[jj];
+    }
+    return;
+  }
+  cache.output_valid = false;
+
+  xillTable *xill_tab = get_xillver_table(xill_param->model_type, xill_param->prim_type, status);
+  RelSysPar* sys_par = get_system_parameters(rel_param, status);
+  relline_spec_multizone *rel_profile = relbase_profile(ener, n_ener, rel_param, sys_par, xill_tab,
+                                                        cache.radial_grid.data(), returnSpec->nrad, status);
+  CHECK_STATUS_VOID(*status);
+  assert(rel_profile->n_zones == returnSpec->nrad);
+
+  const int nzones = returnSpec->nrad;
+  resize_zone_buffers(cache.zone_flux_unboosted, nzones, n_ener);
+  resize_zone_buffers(cache.zone_flux, nzones, n_ener);
+  resize_zone_buffers(cache.zone_conv_out, nzones, n_ener);
+  cache.zone_norm_factor.resize(nzones);
+  cache.single_spec_inp.resize(n_ener_inp);
+
+  // (2) reflection of the returning radiation of each zone (the boost is only applied afterwards)
+  if (!zones_cached && !no_refl) {
+    cache.zones_valid = false;
+    double Tin = xill_param->kTbb;
+    xill_param->kTbb = Tin * xill_param->shiftTmaxRRet;  // currently set for testing
+    for (int ii = 0; ii < nzones; ii++) {
+      cache.zone_norm_factor[ii] = getZoneReflectedReturnFluxUnboosted(xill_param, rel_profile, returnSpec,
+                                                                       cache.zone_flux_unboosted[ii].data(),
+                                                                       ii, status);
+    }
+    // reset Tin parameter to be safe
+    xill_param->kTbb = Tin;
+  }
+  CHECK_STATUS_VOID(*status);
+  set_cached_xill_param(xill_param, &cache.xill_param, status);
+  set_cached_rel_param(rel_param, &cache.rel_param, status);
+  cache.shift_tmax = xill_param->shiftTmaxRRet;
+  cache.no_refl = no_refl;
+  cache.zones_valid = true;
+
+  // (3) convolution and rebinning to the input energy grid
+  specCache* spec_cache =  init_global_specCache(status);
+  CHECK_STATUS_VOID(*status);
+  setArrayToZero(spec_inp, n_ener_inp);
+  auto rebin_conv_to_inp = get_rebin_operator(ener_inp, n_ener_inp, ener, n_ener);
+  for (int ii = 0; ii < nzones; ii++) {
+    double *zone_flux = cache.zone_flux[ii].data();
+    if (no_refl) {
+      getZoneIncidentReturnFlux(xill_param, returnSpec, zone_flux, ii);
+    } else {
+      applyBoostZoneReflectedFlux(xill_param->boost, cache.zone_norm_factor[ii], cache.zone_flux_unboosted[ii].data(),
+                                  returnSpec, zone_flux, ii);
     }
 
-    fits_rr_write_2Dspec(fname.c_str(), spec_conv_out, ener, n_ener,
-                         returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
+    convolveSpectrumFFTNormalized(ener, zone_flux, rel_profile->flux[ii], cache.zone_conv_out[ii].data(), n_ener,
+        1, 1, ii, spec_cache, status);
 
+    rebin_conv_to_inp->apply(cache.zone_conv_out[ii].data(), cache.single_spec_inp.data());
 
-    fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-xillverRefl.fits", xillver_out, ener, n_ener,
-                         returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
+    for (int jj = 0; jj < n_ener_inp; jj++) {
+      spec_inp[jj] += cache.single_spec_inp[jj];
+    }
 
-    fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-xillverPrim.fits", xillver_prim_out, ener, n_ener,
-                         returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
+  }
+  CHECK_STATUS_VOID(*status);
 
+  // clean spectrum
+  setLowValuesToZero(spec_inp, n_ener_inp);
+  setValuesOutsideToZero(spec_inp, ener_inp, n_ener_inp);
 
-    fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-specRet.fits", returnSpec->specRet, ener, n_ener,
-                         returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
-    fits_rr_write_2Dspec("!debug-testrr-bbody-rframe-specPri.fits", returnSpec->specPri, ener, n_ener,
-                         returnSpec->rlo, returnSpec->rhi, returnSpec->nrad, nullptr, status);
+  cache.boost = xill_param->boost;
+  cache.ener_inp.assign(ener_inp, ener_inp + n_ener_inp + 1);
+  cache.spec_out.assign(spec_inp, spec_inp + n_ener_inp);
+  cache.output_valid = true;
 
+  if ( is_debug_run() ) {
+    write_bbody_kernel_debug_output(cache, xill_param, ener, n_ener, no_refl, status);
   }
-  free_2d(&spec_conv_out, returnSpec->nrad);
-  free_2d(&xillver_prim_out, returnSpec->nrad);
 
 }
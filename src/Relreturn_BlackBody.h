@@ -55,7 +55,7 @@ returnSpec2D *spec_returnrad_blackbody(double *ener, double *spec, double *spec_
                                        double Tin, double Rin, double Rout, double spin, int *status);
 
 
-void relxill_bb_kernel(double *ener_inp,
+void relxill_bb_kernel(const double *ener_inp,
                        double *spec_inp,
                        int n_ener_inp,
                        xillParam *xill_param,
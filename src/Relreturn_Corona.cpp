@@ -20,6 +20,10 @@
 #include "Relbase.h"
 #include "Relreturn_Datastruct.h"
 #include "Relreturn_Table.h"
+#include "Relcache.h"
+#include "ThreadPool.h"
+
+#include <vector>
 
 extern "C" {
 #include "relutility.h"
@@ -94,31 +98,115 @@ double corrected_gshift_fluxboost_factor(double xill_gshift_fac, double g, doubl
  * @param ind_table_re
  * @param gamma (double) photon index)
  * @param corrfac_gshift (double)
+ * @param g [ng] work space for the energy shift grid
  * @return
  */
-static double calc_rrad_emis_zone(tabulatedReturnFractions* tabData, int ind_table_ro, int ind_table_re,
-                                  double gamma, double corrfac_gshift) {
+static double calc_rrad_emis_zone(const tabulatedReturnFractions *tabData, int ind_table_ro, int ind_table_re,
+                                  double gamma, double corrfac_gshift, double *g) {
 
   const int ng = tabData->ng;
-  auto g  = new double[ng];
   get_gfac_grid(g, tabData->gmin[ind_table_ro][ind_table_re], tabData->gmax[ind_table_ro][ind_table_re], ng);
 
+  const double *frac_g = tabData->frac_g[ind_table_ro][ind_table_re];
   double emis_zone = 0.0;
-  for (int jj = 0; jj < ng; jj++) {
-    double emis_single_g = tabData->frac_g[ind_table_ro][ind_table_re][jj];
-    if (fabs(corrfac_gshift - 1) > 1e-3) {  // only flux boost (plus correction) for a significant correction
-      emis_single_g *= corrected_gshift_fluxboost_factor(corrfac_gshift, g[jj], gamma) / g[jj];
-    } else if (fabs(g[jj] - 1) > 1e-3) {
-      emis_single_g *= pow(g[jj], gamma - 1);
+  if (fabs(corrfac_gshift - 1) > 1e-3) {  // only flux boost (plus correction) for a significant correction
+    for (int jj = 0; jj < ng; jj++) {
+      emis_zone += frac_g[jj] * (corrected_gshift_fluxboost_factor(corrfac_gshift, g[jj], gamma) / g[jj]);
+    }
+  } else {
+    for (int jj = 0; jj < ng; jj++) {
+      emis_zone += (fabs(g[jj] - 1) > 1e-3) ? frac_g[jj] * pow(g[jj], gamma - 1) : frac_g[jj];
     }
-    emis_zone += emis_single_g;
   }
 
-  delete[] g;
-
   return emis_zone;
 }
 
+/**
+ * weights \sum_g f_g * g^(gamma-1) for all pairs of (incident, emitted) zones, stored contiguously
+ * as [i_rad_incident * nrad + i_rad_emitted]
+ * (Tf_r is not included, as its values at the inner and outer zone depend on Rin, Rout and the spin)
+ */
+struct RradEmisWeights {
+  const tabulatedReturnFractions *tab_data = nullptr;
+  int generation = -1;  // of the return table, as a new table could be allocated at the same address
+  std::vector<int> irad;
+  double gamma = 0.0;
+  std::vector<double> corrfac_gshift;  // empty if no correction factors are given
+  std::vector<double> weights;
+};
+
+// the weights only depend on the table (and its generation), its zones used for the radial grid, gamma and the
+// correction factors
+static thread_local RradEmisWeights cached_rrad_weights;
+
+static bool is_rrad_weights_cached(const returningFractions *ret_fractions, const rradCorrFactors *corr_factors,
+                                   double gamma) {
+
+  const auto &cache = cached_rrad_weights;
+  const int nrad = ret_fractions->nrad;
+  if (cache.tab_data != ret_fractions->tabData || cache.generation != get_rettable_generation()
+      || static_cast<int>(cache.irad.size()) != nrad
+      || are_values_different(cache.gamma, gamma)
+      || cache.corrfac_gshift.empty() != (corr_factors == nullptr)) {
+    return false;
+  }
+
+  for (int ii = 0; ii < nrad; ii++) {
+    if (cache.irad[ii] != ret_fractions->irad[ii]) {
+      return false;
+    }
+    if (corr_factors != nullptr && are_values_different(cache.corrfac_gshift[ii], corr_factors->corrfac_gshift[ii])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief calculate the weights of all pairs of zones (see RradEmisWeights), where the rows (i.e., the
+ * incident radii) are calculated in parallel
+ */
+static const std::vector<double> &get_rrad_emis_weights(const returningFractions *ret_fractions,
+                                                       const rradCorrFactors *corr_factors, double gamma) {
+
+  auto &cache = cached_rrad_weights;
+  if (is_rrad_weights_cached(ret_fractions, corr_factors, gamma)) {
+    return cache.weights;
+  }
+
+  const int nrad = ret_fractions->nrad;
+  const tabulatedReturnFractions *tab_data = ret_fractions->tabData;
+
+  cache.tab_data = tab_data;
+  cache.generation = get_rettable_generation();
+  cache.irad.assign(ret_fractions->irad, ret_fractions->irad + nrad);
+  cache.gamma = gamma;
+  if (corr_factors != nullptr) {
+    cache.corrfac_gshift.assign(corr_factors->corrfac_gshift, corr_factors->corrfac_gshift + nrad);
+  } else {
+    cache.corrfac_gshift.clear();
+  }
+  cache.weights.resize(static_cast<size_t>(nrad) * nrad);
+
+  ThreadPool::instance().parallel_for(static_cast<size_t>(nrad), [&](size_t i_rad_incident) {
+    std::vector<double> g(tab_data->ng);
+    const int ind_table_ro = ret_fractions->irad[i_rad_incident];
+    double *weights_row = &cache.weights[i_rad_incident * nrad];
+
+    for (int i_rad_emitted = 0; i_rad_emitted < nrad; i_rad_emitted++) {
+      const double corr_factor_gshift = (corr_factors != nullptr)
+                                        ? corr_factors->corrfac_gshift[i_rad_emitted] : 1.0;
+
+      weights_row[i_rad_emitted] =
+          calc_rrad_emis_zone(tab_data, ind_table_ro, ret_fractions->irad[i_rad_emitted], gamma,
+                              corr_factor_gshift, g.data());
+    }
+  });
+
+  return cache.weights;
+}
+
 static void test_radial_emis_grid(const returningFractions *ret_fractions,
                            const emisProfile *emis_input) {
   // need to have emis_input on the SAME radial zone grid, ASCENDING (as tables are ascending in radius)
@@ -128,6 +216,12 @@ static void test_radial_emis_grid(const returningFractions *ret_fractions,
   assert(emis_input->re[0] < emis_input->re[1]);
 }
 
+/**
+ * @brief calculate the emissivity of the returning radiation, given by
+ *   emis(r_i) = \sum_e Tf_r(r_i,r_e) * emis(r_e) * \sum_g f_g * g^(gamma-1)
+ * @details the weights (everything except Tf_r and the input emissivity) are cached, such that for a changed
+ * emissivity only the matrix-vector product needs to be calculated
+ */
 emisProfile* calc_rrad_emis_corona(const returningFractions *ret_fractions, rradCorrFactors* corr_factors,
                                    const emisProfile* emis_input, double gamma, int* status) {
 
@@ -137,35 +231,25 @@ emisProfile* calc_rrad_emis_corona(const returningFractions *ret_fractions, rrad
   }
 
   const int nrad = ret_fractions->nrad;
-  auto emis_single_zone = new double[nrad];
+  const auto &weights = get_rrad_emis_weights(ret_fractions, corr_factors, gamma);
 
   emisProfile* emis_return = new_emisProfile(ret_fractions->rad, ret_fractions->nrad, status); // ret_fractions->rad is not owned by emisReturn
 
   for (int i_rad_incident = 0; i_rad_incident < nrad; i_rad_incident++) {
-    int ind_table_ro = ret_fractions->irad[i_rad_incident];
+    const double *weights_row = &weights[i_rad_incident * nrad];
+    const double *tf_r_row = ret_fractions->tf_r[i_rad_incident];
 
+    double emis = 0.0;
     for (int i_rad_emitted = 0; i_rad_emitted < nrad; i_rad_emitted++) {
-
-      int ind_table_re = ret_fractions->irad[i_rad_emitted];
-
-      double corr_factor_gshift = (corr_factors != nullptr)
-                                  ? corr_factors->corrfac_gshift[i_rad_emitted] : 1.0;
-
-      // emis_single_zone = Tf_r * emis(re) * \sum_g f_g * g^(gamma-1)
-      emis_single_zone[i_rad_emitted] =
-          calc_rrad_emis_zone(ret_fractions->tabData, ind_table_ro, ind_table_re, gamma, corr_factor_gshift)
-              * ret_fractions->tf_r[i_rad_incident][i_rad_emitted]
-              * emis_input->emis[i_rad_emitted];
+      emis += weights_row[i_rad_emitted] * tf_r_row[i_rad_emitted] * emis_input->emis[i_rad_emitted];
     }
 
-    emis_return->emis[i_rad_incident] = calcSum(emis_single_zone, nrad);
-   if (corr_factors != nullptr){
+    emis_return->emis[i_rad_incident] = emis;
+    if (corr_factors != nullptr){
       emis_return->emis[i_rad_incident] *= corr_factors->corrfac_flux[i_rad_incident];
     }
   }
 
-  delete[] emis_single_zone;
-
   return emis_return;
 }
 
@@ -258,7 +342,7 @@ static void rebin_to_grid(double* value, const double* rmean, const double nzone
 }
 
 rradCorrFactors* rebin_corrfactors_to_rradtable_grid
-    (rradCorrFactors* input_corr_factors, returningFractions* ret_fractions, int* status) {
+    (rradCorrFactors* input_corr_factors, const returningFractions* ret_fractions, int* status) {
 
   if (input_corr_factors == nullptr){
     return nullptr;
@@ -292,7 +376,9 @@ emisProfile *get_rrad_emis_corona(const emisProfile* emis_input, const relParam*
   double rlo_emis, rhi_emis;
   determine_rlo_rhi(emis_input, &rlo_emis, &rhi_emis);
 
-  returningFractions *ret_fractions = get_rrad_fractions(param->a, rlo_emis, rhi_emis, status);
+  // the fractions only depend on the spin and the radial grid, so they are cached (and owned by the cache)
+  const returningFractions *ret_fractions = get_cached_rrad_fractions(param->a, rlo_emis, rhi_emis, status);
+  CHECK_STATUS_RET(*status, NULL);
 
   emisProfile* emis_input_rebinned = new_emisProfile(ret_fractions->rad, ret_fractions->nrad, status); // ret_fractions->rad is not owned by emis_return
   inv_rebin_mean(emis_input->re, emis_input->emis, emis_input->nr,
@@ -311,7 +397,6 @@ emisProfile *get_rrad_emis_corona(const emisProfile* emis_input, const relParam*
 
   free_emisProfile(emis_return);
   free_emisProfile(emis_input_rebinned);
-  free_returningFractions(&ret_fractions);
   free_rrad_corr_factors(&rrad_corr_factors);
 
   return emis_return_rebinned;
@@ -34,7 +34,7 @@ rradCorrFactors *init_rrad_corr_factors(const double *rlo, const double *rhi, in
 rradCorrFactors *init_rrad_corr_factors(const double *rgrid, int n_zones);
 
 rradCorrFactors* rebin_corrfactors_to_rradtable_grid
-    (rradCorrFactors* input_corr_factors, returningFractions* ret_fractions, int* status);
+    (rradCorrFactors* input_corr_factors, const returningFractions* ret_fractions, int* status);
 void free_rrad_corr_factors(rradCorrFactors** p_corr_factors);
 
 #endif //RELXILL_RELRETURN_C_RELRETURN_CORONA_H_
@@ -18,6 +18,9 @@
 
 #include "Relreturn_Datastruct.h"
 #include "Relreturn_Table.h"
+#include "Buffer2D.h"
+
+#include <mutex>
 
 extern "C" {
 #include "common.h"
@@ -32,6 +35,7 @@ extern "C" {
 #define EMIN_BBODY 0.01
 #define EMAX_BBODY 50
 double *global_bbody_ener_std = NULL;
+static std::mutex bbody_ener_std_mutex;
 
 
 returnSpec2D *getReturnradOutputStructure(const returningFractions *dat,
@@ -60,6 +64,7 @@ void get_gfac_grid(double* gfac, double gmin, double gmax, int ng) {
 
 void get_std_bbody_energy_grid(int *n_ener, double **ener, int *status) {
   CHECK_STATUS_VOID(*status);
+  std::lock_guard<std::mutex> lock(bbody_ener_std_mutex);
   if (global_bbody_ener_std == NULL) {
     global_bbody_ener_std = (double *) malloc((N_BBODY_ENER + 1) * sizeof(double));
     CHECK_MALLOC_VOID_STATUS(global_bbody_ener_std, status)
@@ -82,23 +87,26 @@ void sum_2Dspec(double *spec, double **spec_arr, int nener, int nrad, const int
 }
 
 double **new_specZonesArr(int nener_inp, int nrad, int *status) {
-  auto **spec_zones = (double **) malloc(sizeof(double *) * nrad);
+  double **spec_zones = new_buffer_2d(nrad, nener_inp, status);
   CHECK_MALLOC_RET_STATUS(spec_zones, status, spec_zones);
-  for (int ii = 0; ii < nrad; ii++) {
-    spec_zones[ii] = (double *) malloc(sizeof(double) * nener_inp);
-    CHECK_MALLOC_RET_STATUS(spec_zones[ii], status, spec_zones);
-  }
   return spec_zones;
 }
 
 
-returnSpec2D *new_returnSpec2D(double *rlo, double *rhi, int nrad, double* ener, int n_ener, int *status) {
+returnSpec2D *new_returnSpec2D(const double *rlo, const double *rhi, int nrad, double* ener, int n_ener, int *status) {
 
   auto rspec = (returnSpec2D *) malloc(sizeof(returnSpec2D));
   CHECK_MALLOC_RET_STATUS(rspec, status, rspec)
 
-  rspec->rlo = rlo;
-  rspec->rhi = rhi;
+  // the radial grid is copied, as it typically belongs to the (temporary) returningFractions
+  rspec->rlo = (double *) malloc(sizeof(double) * nrad);
+  CHECK_MALLOC_RET_STATUS(rspec->rlo, status, rspec)
+  rspec->rhi = (double *) malloc(sizeof(double) * nrad);
+  CHECK_MALLOC_RET_STATUS(rspec->rhi, status, rspec)
+  for (int ii = 0; ii < nrad; ii++) {
+    rspec->rlo[ii] = rlo[ii];
+    rspec->rhi[ii] = rhi[ii];
+  }
   rspec->nrad = nrad;
 
   rspec->ener = ener;
@@ -110,3 +118,14 @@ returnSpec2D *new_returnSpec2D(double *rlo, double *rhi, int nrad, double* ener,
   return rspec;
 }
 
+void free_returnSpec2D(returnSpec2D **rspec) {
+  if (*rspec != NULL) {
+    free((*rspec)->rlo);
+    free((*rspec)->rhi);
+    free_buffer_2d((*rspec)->specRet);
+    free_buffer_2d((*rspec)->specPri);
+    free(*rspec);
+    *rspec = NULL;
+  }
+}
+
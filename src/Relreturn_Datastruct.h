@@ -42,7 +42,10 @@ void get_std_bbody_energy_grid(int *n_ener, double **ener, int *status);
 double **new_specZonesArr(int nener_inp, int nrad, int *status);
 void sum_2Dspec(double *spec, double **spec_arr, int nener, int nrad, const int *status);
 
-returnSpec2D *new_returnSpec2D(double *rlo, double *rhi, int nrad, double* ener, int n_ener, int *status);
+returnSpec2D *new_returnSpec2D(const double *rlo, const double *rhi, int nrad, double* ener, int n_ener, int *status);
+
+/** free the spectra and the radial grid (the energy grid is not owned by the returnSpec2D) */
+void free_returnSpec2D(returnSpec2D **rspec);
 
 returnSpec2D *getReturnradOutputStructure(const returningFractions *dat,
                                           double **spec_rr_zones,
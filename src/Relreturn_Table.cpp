@@ -18,16 +18,34 @@
 
 #include "Relphysics.h"
 #include "Relreturn_Table.h"
+#include "Relcache.h"
+#include "Profiling.h"
+
+#include <atomic>
+#include <mutex>
 
 extern "C" {
 #include "relutility.h"
 #include "xilltable.h"
 }
 
-returnTable *cached_retTable = nullptr;
+returnTable *cached_retTable = nullptr;  // shared by all threads
+static std::mutex rettable_mutex;
+static std::atomic<int> rettable_generation{0};  // increased whenever the table is freed
 
 int global_rr_do_interpolation = 1;
 
+/** memory of the tabulated fractions of a single spin (as loaded by fits_rr_load_single_fractions) */
+static long long get_returnFracData_nbytes(int nrad, int ng) {
+  return static_cast<long long>(sizeof(tabulatedReturnFractions) + 5 * nrad * sizeof(double)
+      + 4 * nrad * (sizeof(double *) + nrad * sizeof(double))
+      + nrad * (sizeof(double **) + nrad * (sizeof(double *) + ng * sizeof(double))));
+}
+
+static long long get_returnTable_nbytes(int nspin) {
+  return static_cast<long long>(sizeof(returnTable) + nspin * (sizeof(double) + sizeof(tabulatedReturnFractions *)));
+}
+
 /** create a new return table */
 static returnTable *new_returnTable(int *status) {
 
@@ -49,6 +67,8 @@ static void init_returnTable(returnTable *tab, int nspin, int *status) {
   tab->retFrac = (tabulatedReturnFractions **) malloc(nspin * sizeof(tabulatedReturnFractions *));
   CHECK_MALLOC_VOID_STATUS(tab->retFrac, status)
 
+  prof_mem_add(PROF_MEM_RETURNRAD_TABLE, get_returnTable_nbytes(nspin));
+
 }
 
 void free_2d(double ***vals, int n1) {
@@ -84,6 +104,7 @@ static void free_returnFracData(tabulatedReturnFractions *dat) {
       free(dat->frac_g);
     }
 
+    prof_mem_add(PROF_MEM_RETURNRAD_TABLE, -get_returnFracData_nbytes(dat->nrad, dat->ng));
     free(dat);
   }
 }
@@ -98,6 +119,7 @@ static void free_returnTable(returnTable **tab) {
       }
       free((*tab)->spin);
       free((*tab)->retFrac);
+      prof_mem_add(PROF_MEM_RETURNRAD_TABLE, -get_returnTable_nbytes((*tab)->nspin));
     }
     free(*tab);
   }
@@ -106,7 +128,13 @@ static void free_returnTable(returnTable **tab) {
 }
 
 void free_cached_returnTable(void) {
+  std::lock_guard<std::mutex> lock(rettable_mutex);
   free_returnTable(&cached_retTable);
+  rettable_generation++;  // invalidates all cached returningFractions, as they point to the table
+}
+
+int get_rettable_generation(void) {
+  return rettable_generation;
 }
 
 static tabulatedReturnFractions *new_returnFracData(int nrad, int ng, int *status) {
@@ -133,6 +161,8 @@ static tabulatedReturnFractions *new_returnFracData(int nrad, int ng, int *statu
   dat->rlo = NULL;
   dat->rhi = NULL;
 
+  prof_mem_add(PROF_MEM_RETURNRAD_TABLE, get_returnFracData_nbytes(nrad, ng));
+
   return dat;
 }
 
@@ -385,6 +415,7 @@ static void fits_read_returnRadTable(char *filename, returnTable **inp_tab, int
 
 returnTable *get_returnrad_table(int *status) {
 
+  std::lock_guard<std::mutex> lock(rettable_mutex);
   if (cached_retTable==NULL) {
     fits_read_returnRadTable((char *) RETURNRAD_TABLE_FILENAME, &cached_retTable, status);
   }
@@ -609,3 +640,83 @@ returningFractions *get_rrad_fractions(double spin, double rin, double rout, int
 
   return ret_fractions;
 }
+
+
+/**
+ * returningFractions for a given (spin, Rin, Rout), which are kept for the lifetime of the thread. The
+ * cache is small, as a fit usually only alternates between a few values (e.g., derivative steps in Rin)
+ */
+struct CachedReturningFractions {
+  double spin = 0.0;
+  double rin = 0.0;
+  double rout = 0.0;
+  int generation = -1;
+  returningFractions *fractions = nullptr;
+};
+
+static const int N_CACHE_RRAD_FRACTIONS = 4;
+
+class RradFractionsCache {
+ public:
+  ~RradFractionsCache() {
+    for (auto &entry: m_entries) {
+      free_returningFractions(&entry.fractions);
+    }
+  }
+
+  CachedReturningFractions *find(double spin, double rin, double rout, int generation) {
+    for (auto &entry: m_entries) {
+      if (entry.fractions != nullptr && entry.generation == generation
+          && !are_values_different(entry.spin, spin) && !are_values_different(entry.rin, rin)
+          && !are_values_different(entry.rout, rout)) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  /** the next entry to be overwritten (the entries are replaced in a round robin way) */
+  CachedReturningFractions &next_entry() {
+    auto &entry = m_entries[m_next];
+    m_next = (m_next + 1) % N_CACHE_RRAD_FRACTIONS;
+    free_returningFractions(&entry.fractions);
+    return entry;
+  }
+
+ private:
+  CachedReturningFractions m_entries[N_CACHE_RRAD_FRACTIONS];
+  int m_next = 0;
+};
+
+static thread_local RradFractionsCache cached_rrad_fractions;
+
+const returningFractions *get_cached_rrad_fractions(double spin, double rin, double rout, int *status) {
+
+  CHECK_STATUS_RET(*status, NULL);
+
+  // the table needs to be loaded first, as this determines the generation the fractions belong to
+  get_returnrad_table(status);
+  CHECK_STATUS_RET(*status, NULL);
+  const int generation = get_rettable_generation();
+
+  auto *cached = cached_rrad_fractions.find(spin, rin, rout, generation);
+  prof_cache_access(PROF_CACHE_RRAD_FRACTIONS, cached != nullptr);
+  if (cached != nullptr) {
+    return cached->fractions;
+  }
+
+  returningFractions *ret_fractions = get_rrad_fractions(spin, rin, rout, status);
+  if (*status != EXIT_SUCCESS) {
+    free_returningFractions(&ret_fractions);
+    return NULL;
+  }
+
+  auto &entry = cached_rrad_fractions.next_entry();
+  entry.spin = spin;
+  entry.rin = rin;
+  entry.rout = rout;
+  entry.generation = generation;
+  entry.fractions = ret_fractions;
+
+  return ret_fractions;
+}
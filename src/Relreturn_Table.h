@@ -90,8 +90,18 @@ returnTable *get_returnrad_table(int *status);
 
 void free_2d(double ***vals, int n1);
 void free_cached_returnTable(void);
+
+/** number of times the cached return table was freed (data pointing to an older table is not valid) */
+int get_rettable_generation(void);
 void free_returningFractions(returningFractions **dat);
 
 returningFractions *get_rrad_fractions(double spin, double rin, double rout, int *status);
 
+/**
+ * @brief same as get_rrad_fractions, but cached for the calling thread for the last few values of
+ * (spin, rin, rout), as they do not depend on any other parameter
+ * @return pointer owned by the cache (must not be freed, valid until 4 new values are requested)
+ */
+const returningFractions *get_cached_rrad_fractions(double spin, double rin, double rout, int *status);
+
 #endif /* RELRETURN_TABLE_H_ */
@@ -21,24 +21,23 @@
 #include "XspecSpectrum.h"
 #include "Relreturn_Corona.h"
 #include "PrimarySource.h"
+#include "ThreadPool.h"
+#include "RebinOperator.h"
+#include "Profiling.h"
 
 extern "C" {
 #include "xilltable.h"
 }
 
-/** caching parameters **/
-relParam *cached_rel_param = nullptr;
-xillParam *cached_xill_param = nullptr;
+/** caching parameters (thread_local: every thread evaluating the model has its own context) **/
+thread_local relParam *cached_rel_param = nullptr;
+thread_local xillParam *cached_xill_param = nullptr;
+thread_local std::vector<int> cached_merged_zone_start;  // the spectra in the specCache are stored per merged zone
 
 ///////////////////////////////////////
 // Forward Definitions of Functions  //
 ///////////////////////////////////////
 
-void free_arrays_relxill_kernel(int n_zones,
-                                const double *conv_out,
-                                const double *single_spec_inp,
-                                double *const *xill_angledep_spec);
-
 
 
 ///////////////////////////////////////
@@ -54,34 +53,20 @@ void relxill_convolution_multizone(const XspecSpectrum &spectrum,
                                    int *status);
 /**
  * check if the complete spectrum is cached and if the energy grid did not change
- *  -> additionally we adapt the energy grid to the new dimensions and energy values
- *     if it's not the case yet
+ *  -> the energy grid is identified by its fingerprint (see XspecSpectrum::energy_fingerprint)
  */
 static void check_caching_energy_grid(CachingStatus &caching_status, specCache *cache, const XspecSpectrum &spectrum) {
 
   caching_status.energy_grid = cached::no;
 
-  if (cache->out_spec == nullptr) {
+  if (cache->out_spec == nullptr || cache->out_spec->n_ener != spectrum.num_flux_bins()) {
     return;
-  } else {
-    // first need to check if the energy grid has a different number of bins
-    if (cache->out_spec->n_ener != spectrum.num_flux_bins()) {
-      return;
-    }
+  }
 
-    for (int ii = 0; ii < spectrum.num_flux_bins(); ii++) { // now check if the energies themselves changes
-      if (fabs(cache->out_spec->ener[ii] - spectrum.energy[ii]) > 1e-4) {
-        //        for (int jj = 0; jj < spectrum.num_flux_bins(); jj++) {
-        //          cache->out_spec->ener[jj] = spectrum.energy[jj];
-        //        }
-        return;
-      }
-    }
-    // no nullptr, same number of bins and energies are the same
+  if (cache->out_spec_fingerprint == spectrum.energy_fingerprint()) {
     caching_status.energy_grid = cached::yes;
   }
 
-
 }
 
 /**
@@ -138,7 +123,7 @@ static void write_output_spec_zones(const XspecSpectrum &spectrum, double *spec_
   if (sprintf(vstr, "test_relxill_spec_zones_%03i.dat", ii + 1) == -1) {
     RELXILL_ERROR("failed to get filename", status);
   }
-  save_xillver_spectrum(spectrum.energy, spec_inp_single, spectrum.num_flux_bins(), vstr);
+  save_xillver_spectrum(spectrum.energy(), spec_inp_single, spectrum.num_flux_bins(), vstr);
 }
 
 /** initialize the cached output spec array **/
@@ -151,15 +136,16 @@ void copy_spectrum_to_cache(const XspecSpectrum &spectrum,
   if ((spec_cache->out_spec != nullptr)) {
     if (spec_cache->out_spec->n_ener != spectrum.num_flux_bins()) {
       free_spectrum(spec_cache->out_spec);
-      spec_cache->out_spec = new_spectrum(spectrum.num_flux_bins(), spectrum.energy, status);
+      spec_cache->out_spec = new_spectrum(spectrum.num_flux_bins(), spectrum.energy(), status);
     }
   } else {
-    spec_cache->out_spec = new_spectrum(spectrum.num_flux_bins(), spectrum.energy, status);
+    spec_cache->out_spec = new_spectrum(spectrum.num_flux_bins(), spectrum.energy(), status);
   }
 
   for (int ii = 0; ii < spectrum.num_flux_bins(); ii++) {
     spec_cache->out_spec->flux[ii] = spectrum.flux[ii];
   }
+  spec_cache->out_spec_fingerprint = spectrum.energy_fingerprint();
 }
 
 
@@ -194,14 +180,6 @@ rradCorrFactors* calc_rrad_corr_factors(xillSpec **xill_spec, const RadialGrid &
   return rrad_corr_factors;
 }
 
-static void free_xill_table_param_array(const relParam *rel_param, xillTableParam *const *xill_table_param) {
-  for (int ii = 0; ii < rel_param->num_zones; ii++) {
-    delete xill_table_param[ii];
-  }
-  delete[] xill_table_param;
-}
-
-
 void get_relxill_params(const ModelParams &params, relParam *&rel_param, xillParam *&xill_param) {
   rel_param = get_rel_params(params);
   xill_param = get_xill_params(params);
@@ -248,6 +226,41 @@ xillSpec **get_xillver_reflection_spectra(specCache *spec_cache,
 }
 
 
+/**
+ * @brief merge the zones of the ionization gradient if enabled (see MergedZones)
+ * @details if the merged zones are different from the previous evaluation, the spectra stored for each zone
+ * in the specCache can not be re-used
+ */
+static MergedZones get_merged_zones(xillTableParam *const *xill_param_zone, int nzones,
+                                    CachingStatus &caching_status) {
+
+  auto merged_zones = MergedZones(xill_param_zone, nzones, get_zone_merge_tolerance());
+
+  if (merged_zones.zone_start() != cached_merged_zone_start) {
+    caching_status.relat = cached::no;
+    caching_status.xill = cached::no;
+    cached_merged_zone_start = merged_zones.zone_start();
+  }
+
+  if (is_debug_run() && merged_zones.is_merged()) {
+    printf(" DEBUG:  merged %i ionization zones with similar xillver parameters to %i zones (tolerance %.2e)\n",
+           merged_zones.num_input_zones(), merged_zones.num_zones(), get_zone_merge_tolerance());
+  }
+
+  return merged_zones;
+}
+
+/** work arrays of the zones in relxill_kernel */
+struct KernelScratch {
+  std::vector<xillTableParam> xill_param_storage;
+  std::vector<xillTableParam *> xill_param_zone;
+  std::vector<xillTableParam *> xill_param_merged;
+  std::vector<xillSpec *> xill_refl_spectra_zone;
+  std::vector<double> norm_change_factors;
+  std::vector<double> inv_norm_change_factors;
+  std::vector<double> inv_norm_change_merged;
+};
+
 ///////////////////////////////////////
 // MAIN: Relxill Kernel Function     //
 ///////////////////////////////////////
@@ -258,6 +271,8 @@ void relxill_kernel(const XspecSpectrum &spectrum,
                     const ModelParams &params,
                     int *status) {
 
+  ProfileTimer timer{PROF_RELXILL_KERNEL};
+
   relParam *rel_param = nullptr;
   xillParam *xill_param = nullptr;
   get_relxill_params(params, rel_param, xill_param);
@@ -273,6 +288,14 @@ void relxill_kernel(const XspecSpectrum &spectrum,
   auto caching_status = CachingStatus();
   check_caching_parameters(caching_status, rel_param, xill_param);
   check_caching_energy_grid(caching_status, spec_cache, spectrum);
+  prof_cache_access(PROF_CACHE_RELXILL_RELAT, caching_status.relat == cached::yes);
+  prof_cache_access(PROF_CACHE_RELXILL_XILL, caching_status.xill == cached::yes);
+  prof_cache_access(PROF_CACHE_RELXILL_SPEC, caching_status.is_all_cached());
+  if (is_tracing_enabled()) {
+    timer.set_args("\"relat_cached\": " + std::to_string(caching_status.relat == cached::yes)
+                       + ", \"xill_cached\": " + std::to_string(caching_status.xill == cached::yes)
+                       + ", \"num_zones\": " + std::to_string(rel_param->num_zones));
+  }
 
   RelSysPar *sys_par = get_system_parameters(rel_param, status);
   auto primary_source = PrimarySource(params, sys_par, spectrum);
@@ -293,26 +316,48 @@ void relxill_kernel(const XspecSpectrum &spectrum,
     IonGradient ion_gradient{radial_grid, rel_param->ion_grad_type, xill_param->iongrad_index};
     ion_gradient.calculate_gradient(*(sys_par->emis), primary_source.source_parameters);
 
-    auto xill_param_zone =
-        ion_gradient.get_xill_param_zone(primary_source.source_parameters.xilltab_param());
+    // the work arrays of the zones are kept by the calling thread, such that they are only allocated once
+    static thread_local KernelScratch scratch;
+    const int nzones = ion_gradient.nzones();
+    scratch.xill_param_storage.resize(nzones);
+    scratch.xill_param_zone.resize(nzones);
+    for (int ii = 0; ii < nzones; ii++) {
+      scratch.xill_param_zone[ii] = &scratch.xill_param_storage[ii];
+    }
+    xillTableParam *const *xill_param_zone = scratch.xill_param_zone.data();
+    ion_gradient.set_xill_param_zone(primary_source.source_parameters.xilltab_param(), xill_param_zone);
+
+    // zones with (nearly) identical xillver parameters are merged for the xillver and the convolution stage
+    const auto merged_zones = get_merged_zones(xill_param_zone, nzones, caching_status);
+    const int nzones_merged = merged_zones.num_zones();
+    auto &xill_param_merged = scratch.xill_param_merged;
+    xill_param_merged.resize(nzones_merged);
+    for (int kk = 0; kk < nzones_merged; kk++) {
+      xill_param_merged[kk] = xill_param_zone[merged_zones.first_zone(kk)];
+    }
 
     // --- 2 --- get xillver reflection spectra (are internally stored in a general, cached structure "SpecCache")
     //           such that they are re-used of the caching_status.xill==yes
-    auto xill_refl_spectra_zone =
-        get_xillver_reflection_spectra(spec_cache, xill_param_zone, ion_gradient.nzones(), caching_status.xill);
+    auto xill_refl_spectra_merged =
+        get_xillver_reflection_spectra(spec_cache, xill_param_merged.data(), nzones_merged, caching_status.xill);
+
+    auto &xill_refl_spectra_zone = scratch.xill_refl_spectra_zone;
+    xill_refl_spectra_zone.resize(nzones);
+    for (int ii = 0; ii < nzones; ii++) {
+      xill_refl_spectra_zone[ii] = xill_refl_spectra_merged[merged_zones.merged_index(ii)];
+    }
 
     // -- 3 -- returning radiation correction factors (only calculated if above a given threshold)
     rel_param->rrad_corr_factors =
         (rel_param->return_rad != 0 && rel_param->a > SPIN_MIN_RRAD_CALC_CORRFAC) ?
-        calc_rrad_corr_factors(xill_refl_spectra_zone, radial_grid, xill_param_zone, status) :
+        calc_rrad_corr_factors(xill_refl_spectra_zone.data(), radial_grid, xill_param_zone, status) :
         nullptr;
 
     //  calculate the emissivity including the rrad correction factors (for those the disk parameters need to be known)
     sys_par = get_system_parameters(rel_param, status); // no need to free this, is automatically done by the cache
 
     // --- 4 --- calculate multi-zone relline profile
-    xillTable *xill_tab = nullptr; // needed for the relbase_profile call
-    get_init_xillver_table(&xill_tab, xill_param->model_type, xill_param->prim_type, status);
+    xillTable *xill_tab = get_xillver_table(xill_param->model_type, xill_param->prim_type, status); // for relbase_profile
 
     // calculate the relline profile
     int n_ener_conv; // energy grid for the convolution, only created
@@ -320,18 +365,7 @@ void relxill_kernel(const XspecSpectrum &spectrum,
     get_relxill_conv_energy_grid(&n_ener_conv, &ener_conv, status);
     relline_spec_multizone *rel_profile =
         relbase_profile(ener_conv, n_ener_conv, rel_param, sys_par, xill_tab,
-                        ion_gradient.radial_grid.radius, ion_gradient.nzones(), status);
-
-    // --- 5 --- calculate the xillver spectra depending on the angular distribution (stored in the rel_profile)
-    auto xillver_spectra_zones =
-        SpectrumZones(xill_refl_spectra_zone[0]->ener, xill_refl_spectra_zone[0]->n_ener, ion_gradient.nzones());
-    for (int ii = 0; ii < ion_gradient.nzones(); ii++) {
-      calc_xillver_angdep(xillver_spectra_zones.flux[ii],
-                          xill_refl_spectra_zone[ii],
-                          rel_profile->rel_cosne->dist[ii],
-                          status);
-
-    }
+                        ion_gradient.radial_grid.radius, nzones, status);
 
     // need to re-normalize the spectra due to the energy shift from the source to the disk
     // reason: xillver is defined on a fixed energy flux integrated from 0.1-1000keV (see Dauser+16, A1), therefore
@@ -342,27 +376,64 @@ void relxill_kernel(const XspecSpectrum &spectrum,
 
     // we need to calculate the normalization change from disk to source, therefore calculate from source to disk and take
     // the inverse
-    auto norm_change_factors = calc_xillver_normalization_change_source_to_disk(
-        ion_gradient.m_energy_shift_source_disk, ion_gradient.nzones(), primary_source.source_parameters.xilltab_param()
+    auto &norm_change_factors = scratch.norm_change_factors;
+    norm_change_factors.resize(nzones);
+    calc_xillver_normalization_change_source_to_disk(
+        ion_gradient.m_energy_shift_source_disk, nzones, primary_source.source_parameters.xilltab_param(),
+        norm_change_factors.data()
     );
-    for (int ii = 0; ii < ion_gradient.nzones(); ii++) {
-      for (int jj = 0; jj < xillver_spectra_zones.num_flux_bins; jj++) {
-        xillver_spectra_zones.flux[ii][jj] /= norm_change_factors[ii];
-      }
+
+    // the relline profile is owned by the cache, only the merged profile needs to be freed
+    relline_spec_multizone *merged_rel_profile =
+        (merged_zones.is_merged()) ? merged_zones.merge_rel_profile(rel_profile, status) : nullptr;
+    const relline_spec_multizone *conv_rel_profile =
+        (merged_rel_profile != nullptr) ? merged_rel_profile : rel_profile;
+
+    // --- 5 --- calculate the xillver spectra depending on the angular distribution (stored in the rel_profile)
+    auto xillver_spectra_zones =
+        SpectrumZones(xill_refl_spectra_merged[0]->ener, xill_refl_spectra_merged[0]->n_ener, nzones_merged);
+    for (int ii = 0; ii < nzones_merged; ii++) {
+      calc_xillver_angdep(xillver_spectra_zones.flux[ii],
+                          xill_refl_spectra_merged[ii],
+                          conv_rel_profile->rel_cosne->dist[ii],
+                          status);
 
     }
-    delete[] norm_change_factors;
 
-    free_xill_table_param_array(rel_param, xill_param_zone);
+    // re-normalize the spectra of the zones due to the energy shift from the source to the disk (the factors are
+    // kept out of the relline kernel, as it is cached independently of Ecut/kTe; a merged zone consists of zones
+    // with a different energy shift, therefore it uses the average of their factors, weighted with their flux)
+    if (!merged_zones.is_merged()) {
+      for (int ii = 0; ii < nzones_merged; ii++) {
+        for (int jj = 0; jj < xillver_spectra_zones.num_flux_bins; jj++) {
+          xillver_spectra_zones.flux[ii][jj] /= norm_change_factors[ii];
+        }
+      }
+    } else {
+      auto &inv_norm_change_factors = scratch.inv_norm_change_factors;
+      auto &inv_norm_change_merged = scratch.inv_norm_change_merged;
+      inv_norm_change_factors.resize(nzones);
+      inv_norm_change_merged.resize(nzones_merged);
+      for (int ii = 0; ii < nzones; ii++) {
+        inv_norm_change_factors[ii] = 1.0 / norm_change_factors[ii];
+      }
+      merged_zones.average_zone_factors(rel_profile, inv_norm_change_factors.data(), inv_norm_change_merged.data());
+      for (int ii = 0; ii < nzones_merged; ii++) {
+        for (int jj = 0; jj < xillver_spectra_zones.num_flux_bins; jj++) {
+          xillver_spectra_zones.flux[ii][jj] *= inv_norm_change_merged[ii];
+        }
+      }
+    }
 
     // --- 6 --- convolve the reflection with the relativistic kernel
     relxill_convolution_multizone(spectrum,
-                                  rel_profile,
+                                  conv_rel_profile,
                                   xillver_spectra_zones,
                                   spec_cache,
                                   rel_param,
                                   caching_status,
                                   status);
+    free_rel_spec(merged_rel_profile);
 
     copy_spectrum_to_cache(spectrum, spec_cache, status);
     free_rrad_corr_factors(&(rel_param->rrad_corr_factors));
@@ -376,6 +447,20 @@ void relxill_kernel(const XspecSpectrum &spectrum,
 }
 
 
+/** status of the zones in relxill_convolution_multizone */
+struct ZoneStatus {
+  std::vector<int> status;
+  std::vector<char> is_convolved;
+  std::vector<const double *> rebin_inp;
+  std::vector<double *> rebin_out;
+};
+
+/**
+ * @brief convolve the xillver spectrum of every zone with its relline profile and sum them up
+ * @details The zones are convolved in parallel on the global ThreadPool (each worker uses its own FFT
+ * workspace, the FFT of zone ii is stored in spec_cache at index ii). The spectra of the zones are
+ * added in the order of the zones, such that the result does not depend on the number of threads.
+ */
 void relxill_convolution_multizone(const XspecSpectrum &spectrum,
                                    const relline_spec_multizone *rel_profile,
                                    const SpectrumZones &xill_spec_zones,
@@ -388,64 +473,85 @@ void relxill_convolution_multizone(const XspecSpectrum &spectrum,
 
   const int n_ener_conv = rel_profile->n_ener;
   double* ener_conv = rel_profile->ener;
+  const int n_zones = rel_profile->n_zones;
+  assert(n_zones <= rel_param->num_zones);
 
-  auto conv_out = new double[n_ener_conv];
-  auto single_spec_inp = new double[spectrum.num_flux_bins()];
-  auto xill_rebinned_spec = new double *[rel_param->num_zones];
+  // the conversion factor is shared by all zones, so set it before the parallel loop
+  set_energyflux_conversion(spec_cache, ener_conv, n_ener_conv, status);
+  CHECK_STATUS_VOID(*status);
 
-  // make sure the output array is set to 0
-  for (int ie = 0; ie < spectrum.num_flux_bins(); ie++) {
-    spectrum.flux[ie] = 0.0;
-  }
+  // the grids are fixed during a fit, so the rebinning operators are usually taken from the cache
+  auto rebin_xill_to_conv = get_rebin_operator(ener_conv, n_ener_conv,
+                                               xill_spec_zones.energy(), xill_spec_zones.num_flux_bins);
+  auto rebin_conv_to_out = get_rebin_operator(spectrum.energy(), spectrum.num_flux_bins(), ener_conv, n_ener_conv);
 
-  for (int ii = 0; ii < rel_profile->n_zones; ii++) { /***** loop over ionization zones   ******/
+  // the work arrays of all zones are taken from the memory pool (re-used by every evaluation)
+  Buffer2D xill_rebinned_spec{n_zones, n_ener_conv};
+  Buffer2D zone_conv{n_zones, n_ener_conv};
+  Buffer2D zone_spec{n_zones, spectrum.num_flux_bins()};
+
+  // status of each zone, kept by the calling thread such that it is only allocated once (note that the
+  // workers need to access it through the reference, and not through their own thread_local instance)
+  static thread_local ZoneStatus zone_status_thread;
+  auto &zone_status = zone_status_thread.status;
+  auto &is_zone_convolved = zone_status_thread.is_convolved;
+  auto &rebin_inp = zone_status_thread.rebin_inp;
+  auto &rebin_out = zone_status_thread.rebin_out;
+  zone_status.assign(n_zones, EXIT_SUCCESS);
+  is_zone_convolved.assign(n_zones, 0);
+
+  ThreadPool::instance().parallel_for(static_cast<size_t>(n_zones), [&](size_t ii) {
 
     /** avoid problems where no relxill bin falls into an ionization bin **/
     if (calcSum(rel_profile->flux[ii], rel_profile->n_ener) < 1e-12) {
-      continue;
+      return;
     }
 
-    xill_rebinned_spec[ii] = new double[n_ener_conv];
-    rebin_spectrum(ener_conv, xill_rebinned_spec[ii], n_ener_conv,
-                   xill_spec_zones.energy() , xill_spec_zones.flux[ii], xill_spec_zones.num_flux_bins);
+    const auto izone = static_cast<int>(ii);
+    rebin_xill_to_conv->apply(xill_spec_zones.flux[ii], xill_rebinned_spec[izone]);
 
     // --2-- convolve the spectrum on the energy grid "ener_conv" **
     int recompute_xill = 1; // always recompute fft for xillver, as relat changes the angular distribution
-    convolveSpectrumFFTNormalized(ener_conv, xill_rebinned_spec[ii], rel_profile->flux[ii], conv_out, n_ener_conv,
-                                  caching_status.recomput_relat(), recompute_xill, ii, spec_cache, status);
-    CHECK_STATUS_VOID(*status);
-    rebin_spectrum(spectrum.energy, single_spec_inp, spectrum.num_flux_bins(), ener_conv, conv_out, n_ener_conv);
+    convolveSpectrumFFTNormalized(ener_conv, xill_rebinned_spec[izone], rel_profile->flux[ii], zone_conv[izone],
+                                  n_ener_conv, caching_status.recomput_relat(), recompute_xill,
+                                  izone, spec_cache, &zone_status[ii]);
+    is_zone_convolved[ii] = 1;
+  });
+
+  // rebin all convolved zones to the output grid at once
+  rebin_inp.clear();
+  rebin_out.clear();
+  for (int ii = 0; ii < n_zones; ii++) {
+    if (is_zone_convolved[ii] && zone_status[ii] == EXIT_SUCCESS) {
+      rebin_inp.push_back(zone_conv[ii]);
+      rebin_out.push_back(zone_spec[ii]);
+    }
+  }
+  rebin_conv_to_out->apply(rebin_inp.data(), rebin_out.data(), static_cast<int>(rebin_inp.size()));
 
-    // --3-- add it to the final output spectrum
-    for (int jj = 0; jj < spectrum.num_flux_bins(); jj++) {
-      spectrum.flux[jj] += single_spec_inp[jj];
+  // --3-- add the zones to the final output spectrum (in a fixed order)
+  for (int jj = 0; jj < spectrum.num_flux_bins(); jj++) {
+    spectrum.flux[jj] = 0.0;
+  }
+
+  for (int ii = 0; ii < n_zones; ii++) {
+    if (zone_status[ii] != EXIT_SUCCESS) {
+      RELXILL_ERROR("convolution of the ionization zones failed", status);
+      return;
+    }
+    if (!is_zone_convolved[ii]) {
+      continue;
     }
 
-    if (is_debug_run() && rel_profile->n_zones <= 10) {
-      write_output_spec_zones(spectrum, single_spec_inp, ii, status);
+    for (int jj = 0; jj < spectrum.num_flux_bins(); jj++) {
+      spectrum.flux[jj] += zone_spec[ii][jj];
     }
 
-  } /**** END OF LOOP OVER RADIAL ZONES *****/
+    if (is_debug_run() && n_zones <= 10) {
+      write_output_spec_zones(spectrum, zone_spec[ii], ii, status);
+    }
+  }
 
-  free_arrays_relxill_kernel(rel_profile->n_zones, conv_out, single_spec_inp, xill_rebinned_spec);
 }
 
-/**
- * @brief free arrays allocated and needed by relxill_kernel
- * @param n_zones
- * @param conv_out
- * @param single_spec_inp
- * @param xill_angledep_spec
- */
-void free_arrays_relxill_kernel(int n_zones,
-                                const double *conv_out,
-                                const double *single_spec_inp,
-                                double *const *xill_angledep_spec) {
-  delete[] single_spec_inp;
-  delete[] conv_out;
-  for (int ii = 0; ii < n_zones; ii++) {
-    delete[] xill_angledep_spec[ii];
-  }
-  delete[] xill_angledep_spec;
-}
 
@@ -23,6 +23,7 @@
 #include "Xillspec.h"
 #include "IonGradient.h"
 #include "ModelParams.h"
+#include "Buffer2D.h"
 
 extern "C" {
 #include "writeOutfiles.h"
@@ -36,36 +37,26 @@ enum cached {
   no
 };
 
+/**
+ * spectra of all zones on a common energy grid (contiguous and taken from the memory pool, see Buffer2D)
+ */
 class SpectrumZones{
 
  public:
   SpectrumZones(const double* _energy, int _num_flux, int _num_zones):
-      num_flux_bins(_num_flux), num_zones(_num_zones), num_ener_bins(_num_flux+1) {
-
-    flux = new double*[num_zones];
-    for (int ii=0; ii<num_zones; ii++){
-      flux[ii] = new double[num_flux_bins];
-      for (int jj=0; jj<num_flux_bins; jj++) {
-        flux[ii][jj] = 0.0;
-      }
-    }
+      num_flux_bins(_num_flux), num_zones(_num_zones), num_ener_bins(_num_flux+1),
+      m_flux(_num_zones, _num_flux), m_energy(1, _num_flux+1) {
 
-    m_energy = new double[num_flux_bins+1];
-    for (int ii=0; ii<num_ener_bins; ii++) {
-      m_energy[ii] = _energy[ii];
-    }
-  }
+    flux = m_flux.rows();
+    m_flux.fill(0.0);
 
-  ~SpectrumZones(){
-    for (int ii=0; ii<num_zones; ii++) {
-      delete[] flux[ii];
+    for (int ii=0; ii<num_ener_bins; ii++) {
+      m_energy[0][ii] = _energy[ii];
     }
-    delete[] m_energy;
-    delete[] flux;
   }
 
   [[nodiscard]] double* energy() const{
-    return m_energy;
+    return m_energy[0];
   }
 
   const int num_flux_bins;
@@ -74,7 +65,8 @@ class SpectrumZones{
   double** flux;
 
  private:
-  double* m_energy;
+  Buffer2D m_flux;
+  Buffer2D m_energy;
 
 };
 
@@ -0,0 +1,175 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "ThreadPool.h"
+#include "Relbase.h"
+
+extern "C" {
+#include "relutility.h"
+}
+
+// index of the worker (of any pool) the current thread is running as
+static thread_local int tl_worker_index = -1;
+
+ThreadPool::ThreadPool(int num_workers) {
+  if (num_workers < 1) {
+    num_workers = 1;
+  }
+  for (int ii = 0; ii < num_workers; ii++) {
+    m_queues.emplace_back(new TaskQueue);
+  }
+  for (int ii = 0; ii < num_workers; ii++) {
+    m_workers.emplace_back(&ThreadPool::worker_loop, this, ii);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv_work.notify_all();
+  for (auto &worker: m_workers) {
+    worker.join();
+  }
+}
+
+int ThreadPool::current_worker_index() {
+  return tl_worker_index;
+}
+
+int ThreadPool::default_num_workers() {
+  int num_threads = get_num_threads();
+  if (num_threads < 1) {
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  return (num_threads < 1) ? 1 : num_threads;
+}
+
+void ThreadPool::parallel_for(size_t n_tasks, const std::function<void(size_t)> &task) {
+
+  if (n_tasks == 0) {
+    return;
+  }
+
+  // nested call from a worker (the pool is busy) or a single task: simply execute the tasks in this thread
+  if (current_worker_index() >= 0 || n_tasks == 1) {
+    for (size_t ii = 0; ii < n_tasks; ii++) {
+      task(ii);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> job_lock(m_job_mutex);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_exception = nullptr;
+    m_num_remaining = n_tasks;
+
+    // every worker gets a contiguous block of tasks (similar parameters are usually adjacent)
+    const auto nw = m_queues.size();
+    for (size_t iw = 0; iw < nw; iw++) {
+      std::lock_guard<std::mutex> queue_lock(m_queues[iw]->mutex);
+      for (size_t ii = iw * n_tasks / nw; ii < (iw + 1) * n_tasks / nw; ii++) {
+        m_queues[iw]->tasks.push_back(ii);
+      }
+    }
+    m_job_id++;
+  }
+  m_cv_work.notify_all();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv_done.wait(lock, [this] { return m_num_remaining.load() == 0; });
+  m_task = nullptr;
+
+  if (m_exception != nullptr) {
+    auto exception = m_exception;
+    m_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+bool ThreadPool::next_task(int iworker, size_t &itask) {
+
+  {  // own queue first
+    auto &queue = *m_queues[iworker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      itask = queue.tasks.front();
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+
+  // steal from the back of the other queues
+  const int nw = num_workers();
+  for (int ii = 1; ii < nw; ii++) {
+    auto &queue = *m_queues[(iworker + ii) % nw];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      itask = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::run_task(size_t itask) {
+  try {
+    (*m_task)(itask);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_exception == nullptr || itask < m_exception_index) {
+      m_exception = std::current_exception();
+      m_exception_index = itask;
+    }
+  }
+}
+
+void ThreadPool::worker_loop(int iworker) {
+
+  tl_worker_index = iworker;
+
+  size_t job_seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv_work.wait(lock, [this, job_seen] { return m_stop || m_job_id != job_seen; });
+      if (m_stop) {
+        break;
+      }
+      job_seen = m_job_id;
+    }
+
+    size_t itask;
+    while (next_task(iworker, itask)) {
+      run_task(itask);
+      if (m_num_remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cv_done.notify_all();
+      }
+    }
+  }
+
+  // the caches of the model evaluation are thread_local, i.e., they are the context of this worker
+  free_cache();
+}
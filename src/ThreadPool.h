@@ -0,0 +1,101 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#ifndef RELXILL_SRC_THREADPOOL_H_
+#define RELXILL_SRC_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief persistent pool of worker threads with work stealing
+ * @details Each worker owns a queue of task indices, which is initially filled with a contiguous block
+ * of the tasks. A worker takes tasks from the front of its own queue and, if this is empty, steals
+ * from the back of the queues of the other workers. The workers
+ * are kept alive between calls, such that all caches of the model evaluation (which are thread_local)
+ * act as a persistent context per worker. The tables are shared between all workers.
+ *
+ * The number of workers is given by the environment variable RELXILL_NUM_THREADS (default: number of
+ * cores). If called from within a worker (nested parallelism), the tasks are executed serially in the
+ * calling thread, as is a single task.
+ */
+class ThreadPool {
+
+ public:
+  explicit ThreadPool(int num_workers);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+
+  static ThreadPool &instance() {
+    static auto *instance = new ThreadPool(default_num_workers());
+    return *instance;
+  }
+
+  [[nodiscard]] int num_workers() const {
+    return static_cast<int>(m_workers.size());
+  }
+
+  /**
+   * @brief execute task(ii) for ii=0..n_tasks-1 and wait until all are finished
+   * @details the first exception (lowest task index) thrown by any task is re-thrown after all tasks
+   * finished
+   */
+  void parallel_for(size_t n_tasks, const std::function<void(size_t)> &task);
+
+  /** index of the worker the calling thread belongs to (-1 if not a worker of any pool) */
+  static int current_worker_index();
+
+  static int default_num_workers();
+
+ private:
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  std::vector<std::thread> m_workers;
+  std::vector<std::unique_ptr<TaskQueue>> m_queues;
+
+  std::mutex m_mutex;                      // guards the job state below
+  std::condition_variable m_cv_work;
+  std::condition_variable m_cv_done;
+  std::mutex m_job_mutex;                  // only one parallel_for at a time
+  const std::function<void(size_t)> *m_task{nullptr};
+  std::atomic<size_t> m_num_remaining{0};
+  size_t m_job_id{0};
+  bool m_stop{false};
+
+  std::exception_ptr m_exception{nullptr};
+  size_t m_exception_index{0};
+
+  void worker_loop(int iworker);
+  bool next_task(int iworker, size_t &itask);
+  void run_task(size_t itask);
+};
+
+#endif //RELXILL_SRC_THREADPOOL_H_
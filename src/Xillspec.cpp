@@ -18,6 +18,7 @@
 
 #include "Xillspec.h"
 #include "Relphysics.h"
+#include "Nthcomp.h"
 
 extern "C" {
 #include "xilltable.h"
@@ -25,7 +26,26 @@ extern "C" {
 #include "common.h"
 }
 
-EnerGrid *global_xill_egrid_coarse = nullptr;
+#include <mutex>
+#include <vector>
+
+EnerGrid *global_xill_egrid_coarse = nullptr;  // shared by all threads
+static std::mutex xill_egrid_coarse_mutex;
+
+// the xillver tables are shared by all threads; their spectra are loaded on demand
+static std::mutex xilltable_mutex;
+
+/** @brief thread-safe access to the (initialized) xillver table for the given model
+ * @details note that the spectra of the table are only loaded by get_xillver_spectra_table
+ */
+xillTable *get_xillver_table(int model_type, int prim_type, int *status) {
+  CHECK_STATUS_RET(*status, nullptr);
+
+  std::lock_guard<std::mutex> lock(xilltable_mutex);
+  xillTable *tab = nullptr;
+  get_init_xillver_table(&tab, model_type, prim_type, status);
+  return tab;
+}
 
 /** @brief main routine for the xillver table: returns a spectrum for the given parameters
  *  @details
@@ -41,18 +61,22 @@ xillSpec *get_xillver_spectra_table(xillTableParam *param, int *status) {
   CHECK_STATUS_RET(*status, nullptr);
 
   xillTable *tab = nullptr;
-  const char *fname = get_init_xillver_table(&tab, param->model_type, param->prim_type, status);
+  int *indparam;
+  {
+    std::lock_guard<std::mutex> lock(xilltable_mutex);
+    const char *fname = get_init_xillver_table(&tab, param->model_type, param->prim_type, status);
 
-  CHECK_STATUS_RET(*status, nullptr);
-  assert(fname != nullptr);
+    CHECK_STATUS_RET(*status, nullptr);
+    assert(fname != nullptr);
 
-  // =1=  get the inidices
-  int *indparam = get_xilltab_indices_for_paramvals(param, tab, status);
+    // =1=  get the inidices
+    indparam = get_xilltab_indices_for_paramvals(param, tab, status);
 
-  // =2=  check if the necessary spectra for interpolation are loaded
-  check_xilltab_cache(fname, param, tab, indparam, status);
+    // =2=  check if the necessary spectra for interpolation are loaded
+    check_xilltab_cache(fname, param, tab, indparam, status);
+  }
 
-  // =3= interpolate values
+  // =3= interpolate values (without the lock, the loaded spectra are published atomically, see set_dat)
   xillSpec *spec = interp_xill_table(tab, param, indparam, status);
 
   CHECK_RELXILL_DEFAULT_ERROR(status);
@@ -145,6 +169,7 @@ static double get_photon_flux_band(const double *ener,
 EnerGrid *get_coarse_xillver_energrid(int *status) {
   CHECK_STATUS_RET(*status, nullptr);
 
+  std::lock_guard<std::mutex> lock(xill_egrid_coarse_mutex);
   if (global_xill_egrid_coarse == nullptr) {
     global_xill_egrid_coarse = new_EnerGrid(status);
     global_xill_egrid_coarse->nbins = N_ENER_COARSE;
@@ -226,11 +251,9 @@ void spec_nthcomp(double *pl_flux_xill,
                   int n_ener,
                   const xillTableParam *xill_param,
                   double ener_shift = 1.0) {
-  double nthcomp_param[5];
   double kTe = xill_param->ect; // Important: kTe is given in the frame of the source
   double z = 1 / ener_shift - 1; // convert energy shift to redshift
-  get_nthcomp_param(nthcomp_param, xill_param->gam, kTe, z);
-  c_donthcomp(ener, n_ener, nthcomp_param, pl_flux_xill);
+  nthcomp_spectrum(pl_flux_xill, ener, n_ener, xill_param->gam, kTe, z);
 }
 
 /**
@@ -384,40 +407,38 @@ double calc_xillver_normalization_change(double energy_shift, const xillTablePar
  * @param energy_shift_source_disk [energy shift from the source to the disk for each zone]
  * @param n_zones [number of zones]
  * @param xill_param_0 [xillver parameters for the inital spectrum]
- * @return norm_flux_cgs
+ * @param norm_factors [output: normalization factor for each zone, n_zones values]
  */
-double *calc_xillver_normalization_change_source_to_disk(const double *energy_shift,
-                                                         int n_zones,
-                                                         const xillTableParam *xill_param_0) {
+void calc_xillver_normalization_change_source_to_disk(const double *energy_shift,
+                                                      int n_zones,
+                                                      const xillTableParam *xill_param_0,
+                                                      double *norm_factors) {
 
   int status = EXIT_SUCCESS;
   EnerGrid *egrid = get_coarse_xillver_energrid(&status);
-  auto prime_spec = new double[egrid->nbins];
 
-  calc_primary_spectrum(prime_spec, egrid->ener, egrid->nbins, xill_param_0, &status);
-  double source_spec_norm_factor = 1. / calcNormWrtXillverTableSpec(prime_spec, egrid->ener, egrid->nbins, &status);
-  // normalized disk spec: prime_spec_source*source_spec_norm_factor
+  // work array of the primary spectrum, kept by each thread such that it is only allocated once
+  static thread_local std::vector<double> prime_spec;
+  prime_spec.resize(egrid->nbins);
 
-  auto norm_factors = new double[n_zones];
+  calc_primary_spectrum(prime_spec.data(), egrid->ener, egrid->nbins, xill_param_0, &status);
+  double source_spec_norm_factor =
+      1. / calcNormWrtXillverTableSpec(prime_spec.data(), egrid->ener, egrid->nbins, &status);
+  // normalized disk spec: prime_spec_source*source_spec_norm_factor
 
   // get parameters for the source spectrum (ecut shifted in energy)
-  auto xill_param_disk = new xillTableParam;
-  *xill_param_disk = *xill_param_0; // shallow copy
+  xillTableParam xill_param_disk = *xill_param_0; // shallow copy
   for (int ii = 0; ii < n_zones; ii++) {
-    xill_param_disk->ect = xill_param_0->ect * energy_shift[ii];
+    xill_param_disk.ect = xill_param_0->ect * energy_shift[ii];
 
     // calculate the primary spectrum at the source
-    calc_primary_spectrum(prime_spec, egrid->ener, egrid->nbins, xill_param_disk, &status);
-    double disk_spec_norm_factor = 1. / calcNormWrtXillverTableSpec(prime_spec, egrid->ener, egrid->nbins, &status);
+    calc_primary_spectrum(prime_spec.data(), egrid->ener, egrid->nbins, &xill_param_disk, &status);
+    double disk_spec_norm_factor =
+        1. / calcNormWrtXillverTableSpec(prime_spec.data(), egrid->ener, egrid->nbins, &status);
     // normalized prime spec: prime_spec_source*source_spec_norm_factor
 
     norm_factors[ii] = disk_spec_norm_factor / source_spec_norm_factor;
   }
-
-  delete xill_param_disk;
-  delete[] prime_spec;
-
-  return norm_factors;
 }
 
 /**
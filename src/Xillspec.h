@@ -38,6 +38,8 @@ void norm_xillver_spec(xillSpec *spec, double incl);
 
 
 
+xillTable *get_xillver_table(int model_type, int prim_type, int *status);
+
 xillSpec *get_xillver_spectra_table(xillTableParam *param, int *status);
 
 xillSpec *get_xillver_spectra(xillParam *param, int *status);
@@ -72,9 +74,10 @@ double *calc_normalized_primary_spectrum(const double *ener, int n_ener,
                                          const relParam *rel_param, const xillTableParam *xill_param, int *status);
 
 double calc_xillver_normalization_change(double energy_shift, const xillTableParam *xill_param_0);
-double *calc_xillver_normalization_change_source_to_disk(const double *energy_shift,
-                                                         int n_zones,
-                                                         const xillTableParam *xill_param_0);
+void calc_xillver_normalization_change_source_to_disk(const double *energy_shift,
+                                                      int n_zones,
+                                                      const xillTableParam *xill_param_0,
+                                                      double *norm_factors);
 
 double calcNormWrtXillverTableSpec(const double *flux, const double *ener, int n, int *status);
 EnerGrid *get_coarse_xillver_energrid(int *status);
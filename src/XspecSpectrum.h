@@ -22,30 +22,31 @@
 #include <xsTypes.h>
 
 #include "common.h"
+#include "RebinOperator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 typedef RealArray Array; // using the Xspec defined std::valarray type
 
 
 
 
+/**
+ * @brief spectrum as given by XSPEC: the energy grid of the caller (read-only) and the flux (output)
+ * @details The energy grid is not copied. Shifts of the energy grid (redshift, line energy) are stored as
+ * a scale factor and only applied if the shifted grid is actually needed (see energy()). For the caching of
+ * the output spectrum, the energy grid is identified by its fingerprint (see energy_fingerprint()).
+ */
 class XspecSpectrum {
 
  public:
 
   XspecSpectrum(const double *_energy, double *_flux, size_t _nbins_xspec)
-      : flux{_flux}, m_num_flux_bins{_nbins_xspec} {
-    // need to allocate the energy grid, as we are not allowed to change the original energy grid
-    // (Xspec requires it to be constant, but we need to shift it in energy)
-    energy = new double[n_energy()];
-    for (size_t ii = 0; ii < n_energy(); ii++) {
-      energy[ii] = _energy[ii];
-    }
+      : flux{_flux}, m_energy_inp{_energy}, m_num_flux_bins{_nbins_xspec} {
   };
 
-  ~XspecSpectrum() {
-    delete[] energy;
-  }
-
   [[nodiscard]] size_t n_energy() const {   // array holds num_bins+1 bins, as bin_lo and bin_hi are combined
     return m_num_flux_bins + 1;
   }
@@ -54,24 +55,48 @@ class XspecSpectrum {
     return static_cast<int>(m_num_flux_bins);
   }
 
+  /** energy grid (n_energy values), including all shifts; only copied if it is shifted */
+  [[nodiscard]] const double *energy() const {
+    if (m_energy_scale == 1.0) {
+      return m_energy_inp;
+    }
+    if (m_energy_shifted.empty()) {
+      m_energy_shifted.resize(n_energy());
+      for (size_t ii = 0; ii < n_energy(); ii++) {
+        m_energy_shifted[ii] = m_energy_inp[ii] * m_energy_scale;
+      }
+    }
+    return m_energy_shifted.data();
+  }
+
+  /**
+   * fingerprint of the (shifted) energy grid, the grid of the caller is only hashed once
+   * (grids are identified by their values and not by the address of the array)
+   */
+  [[nodiscard]] uint64_t energy_fingerprint() const {
+    if (!m_has_fingerprint_inp) {
+      m_fingerprint_inp = get_energy_grid_fingerprint(m_energy_inp, num_flux_bins());
+      m_has_fingerprint_inp = true;
+    }
+    uint64_t scale_bits;
+    memcpy(&scale_bits, &m_energy_scale, sizeof(scale_bits));
+    return (m_fingerprint_inp ^ scale_bits) * 1099511628211ULL;
+  }
+
   /**
    * shift the spectrum such that we can calculate if the line would be at 1keV
    * (if the line is at 5keV, the energy grid is multiplied by 1/5)
    */
-  void shift_energy_grid_1keV(double line_energy) const {
-    for (size_t ii = 0; ii < m_num_flux_bins + 1; ii++) {
-      energy[ii] /= line_energy;
-    }
+  void shift_energy_grid_1keV(double line_energy) {
+    set_energy_scale(m_energy_scale / line_energy);
   }
 
   /**
    * shift the spectrum in redshift
    */
-  void shift_energy_grid_redshift(double z) const {
+  void shift_energy_grid_redshift(double z) {
     if (z > 0) {
-      for (size_t ii = 0; ii < m_num_flux_bins + 1; ii++) {
-        energy[ii] *= (1 + z);
-      }
+      set_energy_scale(m_energy_scale * (1 + z));
     }
   }
 
@@ -91,19 +116,30 @@ class XspecSpectrum {
 
   // get the energy flux in ergs/cm^2/s
   [[nodiscard]] double get_energy_flux() const {
+    const double *ener = energy();
     double ener_flux = 0.0;
     for (size_t ii = 0; ii < m_num_flux_bins; ii++) {
-      ener_flux += flux[ii] * 0.5 * (energy[ii] + energy[ii + 1]);
+      ener_flux += flux[ii] * 0.5 * (ener[ii] + ener[ii + 1]);
     }
     return ener_flux * CONVERT_KEV2ERG;
   }
 
  public:
-  double *energy{nullptr};
   double *flux{nullptr};
  private:
+
+  void set_energy_scale(double scale) {
+    m_energy_scale = scale;
+    m_energy_shifted.clear();  // will be re-calculated when needed
+  }
+
+  const double *m_energy_inp{nullptr};
   size_t m_num_flux_bins{};
+  double m_energy_scale{1.0};
 
+  mutable std::vector<double> m_energy_shifted;
+  mutable uint64_t m_fingerprint_inp{0};
+  mutable bool m_has_fingerprint_inp{false};
 };
 
 
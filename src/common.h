@@ -176,6 +176,22 @@ enum xillTableIds {
 
 /****** TYPE DEFINITIONS ******/
 
+/** spacing of a grid, which determines how the index of a value is found (see grid_search) **/
+typedef enum {
+  GRID_ARBITRARY,
+  GRID_LIN_UNIFORM,
+  GRID_LOG_UNIFORM
+} gridType;
+
+/** grid (sorted ASCENDING) together with its spacing, such that uniform grids have an O(1) index lookup **/
+typedef struct {
+  const double *val;  // length=n (not owned by the descriptor)
+  int n;
+  gridType type;
+  double x0;          // val[0] (log(val[0]) for GRID_LOG_UNIFORM)
+  double inv_step;    // 1 / step of val (of log(val) for GRID_LOG_UNIFORM)
+} gridDescriptor;
+
 typedef struct{
   double* rgrid;
   int n_zones;
@@ -351,19 +367,15 @@ typedef struct {
   int n_cache;  // number of array (nzones <= n_cache !!)
   int n_ener;
   double* conversion_factor_energyflux; // conversion from photons/bin to keV/keV
-  double ***fft_xill;  // dimensions [n_cache,2,n_ener]
-  double ***fft_rel;   // dimensions [n_cache,2,n_ener]
 
   fftw_complex** fftw_xill;  // dimensions [n_cache,n_ener]
   fftw_complex** fftw_rel;   // dimensions [n_cache,n_ener]
 
-  fftw_complex* fftw_backwards_input;  // [nener]
-  double* fftw_output;  // [nener]
-  fftw_plan plan_c2r;
 
 
   xillSpec **xill_spec;
   spectrum *out_spec;
+  unsigned long long out_spec_fingerprint;  // fingerprint of the energy grid of out_spec
 } specCache;
 
 typedef struct {
@@ -385,5 +397,8 @@ typedef struct {
 /******************************/
 /* define the c_donthcomp function here */
 void c_donthcomp(const double *ear, int ne, double *param, double *photar);
+void c_nthcomp_intrinsic(const double *param, double *xth, int *nth, double *spt);
+void c_nthcomp_rebin(const double *ear, int ne, double z_red, const double *xth, int nth, const double *spt,
+                     double *photar);
 
 #endif /* COMMON_H_ */
@@ -152,7 +152,7 @@ def get_model_names(lmodeldat_file):
 
 def get_wrapper_lmod(local_model_name, function_name):
     parameter_list = "const double *energy, int Nflux, const double *parameter, int spectrum, double *flux, double *fluxError, const char *init"
-    function_call = "xspec_C_wrapper_eval_model(ModelName::" + local_model_name + ", parameter, flux, Nflux, energy);"
+    function_call = "xspec_C_wrapper_eval_model<ModelName::" + local_model_name + ">(parameter, flux, Nflux, energy);"
 
     return f"""
 extern "C" void {function_name}({parameter_list}) 
@@ -180,29 +180,24 @@ def write_xspec_wrapper_file(outfile_name, model_definition):
     file.close()
 
 
-def get_implemented_lmod(local_model_name, param_list):
-    param_class = "XPar::"
-
-    lmodel_str = \
-        f"""   {{ModelName::{local_model_name},
-    XspecParamList(\"{local_model_name}\", 
-        {{ """
+def get_layout_name(local_model_name):
+    return f"{local_model_prefix}_{local_model_name}_layout"
 
-    separator = ""
-    for par_key in param_list.keys():
-        lmodel_str += separator +param_class + par_key
-        separator = ", "
-
-    lmodel_str += "}, \n\t {"
-    separator = ""
-    for par_key in param_list.keys():
-        lmodel_str += separator + param_list[par_key]
-        separator = ", "
 
+def get_implemented_lmod(local_model_name, param_list):
+    """ constexpr parameter layout of the model: parameter names and default values in the Xspec order """
+    param_class = "XPar::"
+    prefix = f"{local_model_prefix}_{local_model_name}"
 
-    lmodel_str += "})\n   },\n"
+    parnames = ", ".join([param_class + par_key for par_key in param_list.keys()])
+    default_values = ", ".join(param_list.values())
 
-    return lmodel_str
+    return f"""
+inline constexpr XPar {prefix}_parnames[] = {{{parnames}}};
+inline constexpr double {prefix}_default_values[] = {{{default_values}}};
+inline constexpr ParamLayout {get_layout_name(local_model_name)}{{ModelName::{local_model_name}, "{local_model_name}",
+    {prefix}_parnames, {prefix}_default_values}};
+"""
 
 
 def write_class_definition(file):
@@ -210,20 +205,18 @@ def write_class_definition(file):
 
 #include "ModelParams.h"
 
+#include <stdexcept>
+#include <type_traits>
+
 class XspecParamList: public ParamList {
 
  public:
-  XspecParamList(std::string model_name, std::vector<XPar> parnames, std::vector<double> parvalues):
-      ParamList(std::move(parnames), std::move(parvalues)) {
-        m_name = std::move(model_name);
-      };
+  explicit XspecParamList(const ParamLayout &layout) : ParamList(layout) {
+  };
 
   [[nodiscard]] std::string name() const {
-    return m_name;
+    return layout().name;
   }
-
- private:
-  std::string m_name;
 };
 
 
@@ -231,31 +224,72 @@ class XspecModelDatabase{
 
  public:
   std::string name_string(ModelName name) const{
-    return model_definition.at(name).name();
+    return param_layout(name).name;
   }
 
   ParamList param_list(ModelName name) const{
-    return model_definition.at(name);
+    return ParamList(param_layout(name));
   }
 
   std::unordered_map<ModelName, XspecParamList> all_models() const{
-    return model_definition;
+    std::unordered_map<ModelName, XspecParamList> models;
+    for (const auto *layout: all_param_layouts) {
+      models.insert(std::make_pair(layout->model_name, XspecParamList(*layout)));
+    }
+    return models;
   }
 
- private:
-  const std::unordered_map<ModelName, XspecParamList> model_definition = {
-  {"""
+  /**
+   * parameter layout of the model (O(1) lookup, without any allocation)
+   * @throw std::out_of_range if the model is not defined in the lmodel.dat file
+   */
+  static const ParamLayout &param_layout(ModelName name) {
+    switch (name) {
+"""
     file.write(class_definition_cpp)
 
 
 def write_model_database(file, definition):
     for model in definition:
-        file.write(get_implemented_lmod(model.model_name, model.params))
-    file.write("  }\n };\n")
+        file.write(f"      case ModelName::{model.model_name}: return {get_layout_name(model.model_name)};\n")
+    file.write("""      default: break;
+    }
+    throw std::out_of_range("model not defined in the lmodel.dat file");
+  }
+
+ private:
+  static constexpr const ParamLayout *all_param_layouts[] = {
+""")
+    for model in definition:
+        file.write(f"      &{get_layout_name(model.model_name)},\n")
+    file.write("  };\n")
+
+
+def write_model_visitor(file, definition):
+    """ compile-time dispatch: call the visitor with the model name as std::integral_constant """
+    file.write("""
+
+/**
+ * call the visitor with the model name as compile-time constant (std::integral_constant<ModelName, name>),
+ * such that a (templated) evaluation can be specialized for every model
+ * @throw std::out_of_range if the model is not defined in the lmodel.dat file
+ */
+template<typename Visitor>
+decltype(auto) visit_model_name(ModelName name, Visitor &&visitor) {
+  switch (name) {
+""")
+    for model in definition:
+        file.write(f"    case ModelName::{model.model_name}: "
+                   f"return visitor(std::integral_constant<ModelName, ModelName::{model.model_name}>{{}});\n")
+    file.write("""    default: break;
+  }
+  throw std::out_of_range("model not defined in the lmodel.dat file");
+}
+""")
 
 
 def write_xspec_implement_models(outfile_name, model_definition):
-    includes = ""
+    includes = "#include \"ModelParams.h\"\n"
 
     file = open(outfile_name, "w")
 
@@ -267,11 +301,16 @@ def write_xspec_implement_models(outfile_name, model_definition):
 
     file.write(includes)
 
+    for model in model_definition:
+        file.write(get_implemented_lmod(model.model_name, model.params))
+
     write_class_definition(file)
 
     write_model_database(file, model_definition)
 
-    file.write("\n };\n")
+    file.write("};\n")
+
+    write_model_visitor(file, model_definition)
 
     file.write(f"\n#endif //{c_define_string}")
 
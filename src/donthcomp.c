@@ -680,114 +680,75 @@ static double f_spp__(double *y, double *xnonth, int *nnonth,
     return ret_val;
 } /* f_spp__ */
 
-void c_donthcomp(const double *ear, int ne, double *param, double *photar) {
-  /* Initialized data */
-  double prim[ne];
+/* intrinsic spectrum of the Comptonization code (param as for c_donthcomp, redshift is not used): */
+/*   xth[nth]: energy array (units m_e c^2), spt[nth]: spectrum (E F_E), both need 900 elements */
+/*   (not re-entrant, as the f2c translated routines use static variables) */
+void c_nthcomp_intrinsic(const double *param, double *xth, int *nth, double *spt) {
+  double gam = param[0];
+  double d__1 = param[2] / 511.;
+  double d__2 = param[1] / 511.;
+
+  if (param[3] < .5) {
+    f_thcompton__(&d__1, &d__2, &gam, xth, nth, spt);
+  } else {
+    f_thdscompton__(&d__1, &d__2, &gam, xth, nth, spt);
+  }
+}
 
-  static double pa0[5] = {9999., 9999., 9999., 9999., 9999.};
+/* rebin the intrinsic spectrum (xth,spt) on the energy grid ear[ne+1] (keV), shifted by the */
+/* redshift z_red, photar[ne] is given in counts/bin (normalized to 1 at 1keV) */
+void c_nthcomp_rebin(const double *ear, int ne, double z_red, const double *xth, int nth, const double *spt,
+                     double *photar) {
 
-  /* System generated locals */
-  int i__1;
-  double d__1, d__2;
+  double prim[ne + 1];
+  int ii, j, jl, ih, il;
 
-  /* Local variables */
-    static int i__, j, n, jl, np;
-    static double xn;
-    static int fl0;
-    static int nth;
-    static double xth[900], spt[900];
-  static double z_red__;
-  static double normfac;
+  /* normalization: spectrum at 1keV in the observer frame (see f_spp__) */
+  double xx = (z_red + 1) / 511.;
+  ih = 1;
+  while (ih < nth - 1 && xx > xth[ih]) {
+    ++ih;
+  }
+  il = ih - 1;
+  double normfac = 1 / (spt[il] + (spt[ih] - spt[il]) * (xx - xth[il]) / (xth[ih] - xth[il]));
+
+  /* put primary into final array */
+  j = 1;
+  for (ii = 0; ii <= ne; ++ii) {
+    prim[ii] = 0.;
+    while (j <= nth && xth[j - 1] * 511. < ear[ii] * (z_red + 1)) {
+      ++j;
+    }
+    if (j <= nth) {
+      if (j > 1) {
+        jl = j - 1;
+        prim[ii] = spt[jl - 1] + (ear[ii] / 511. * (z_red + 1) - xth[jl - 1]) * (spt[jl] - spt[jl - 1])
+            / (xth[jl] - xth[jl - 1]);
+      } else {
+        prim[ii] = spt[0];
+      }
+    }
+  }
 
+  for (ii = 1; ii <= ne; ++ii) {
+    photar[ii - 1] = (prim[ii] / pow(ear[ii], c_b2) + prim[ii - 1] / pow(ear[ii - 1], c_b2)) * .5
+        * (ear[ii] - ear[ii - 1]) * normfac;
+  }
+}
 
 /*     driver for the Comptonization code solving Kompaneets equation */
 /*     seed photons - (disc) blackbody */
-/*     reflection + Fe line with smearing */
 
-/*     Version optimized for a number of data files but with the same values */
-/*     of parameters: */
-/*        computes the model when ifl=1, in broad energy range, and rebins */
-/*        it only for subsequent files */
-
-/*     number of model parameters: 16 */
+/*     number of model parameters: 5 */
 /*     1: photon spectral index */
 /*     2: plasma temperature in keV */
 /*     3: (disc)blackbody temperature in keV */
 /*     4: type of seed spectrum (0-blackbody, 1-diskbb) */
 /*     5: redshift */
-/*      INCLUDE 'xspec.inc' */
-/*     SPP is external (xansrc/functions/xsnteea.f) */
-    /* Parameter adjustments */
-    --photar;
-    --param;
-
-    /* Function Body */
-
-/*     xtot is the energy array (units m_e c^2) */
-/*     spnth is the nonthermal spectrum alone (E F_E) */
-/*     sptot is the total spectrum array (E F_E), = spref if no reflection */
-    z_red__ = param[5];
-/*  calculate internal source spectrum if necessary */
-/*  (only for the first file) */
-    np = 5;
-    i__1 = np;
-    for (n = 1; n <= i__1; ++n) {
-	if (param[n] != pa0[n - 1]) {
-	    fl0 = 1;
-	}
-    }
-    if (fl0) {
-	if (param[4] < .5) {
-	    d__1 = param[3] / 511.;
-	    d__2 = param[2] / 511.;
-	    f_thcompton__(&d__1, &d__2, &param[1], xth, &nth, spt);
-	} else {
-	    d__1 = param[3] / 511.;
-	    d__2 = param[2] / 511.;
-	    f_thdscompton__(&d__1, &d__2, &param[1], xth, &nth, spt);
-	}
-    }
-    xn = (z_red__ + 1) / 511.;
-    d__1 = 1 / xn;
-    normfac = 1 / f_spp__(&d__1, xth, &nth, spt);
-  /* Calculate luminosity normalization  (used in another model!) */
-  /*    double normlum = 0.;
-      i__1 = nth - 1;
-      for (i__ = 2; i__ <= i__1; ++i__) {
-      normlum += (spt[i__ - 1] / xth[i__ - 1] + spt[i__ - 2] / xth[i__ - 2])
-           * .5 * (xth[i__ - 1] - xth[i__ - 2]);
-      }
-      normlum *= normfac; */
-  /*     zero arrays */
-    i__1 = ne;
-    for (i__ = 1; i__ <= i__1; ++i__) {
-	photar[i__] = 0.;
-	prim[i__] = 0.;
-    }
-    prim[0] = 0.;
+void c_donthcomp(const double *ear, int ne, double *param, double *photar) {
+  double xth[900], spt[900];
+  int nth;
 
-/*     put primary into final array only if scale >= 0. */
-    j = 1;
-    i__1 = ne;
-    for (i__ = 0; i__ <= i__1; ++i__) {
-	while(j <= nth && xth[j - 1] * 511. < ear[i__] * (z_red__ + 1)) {
-	    ++j;
-	}
-	if (j <= nth) {
-	    if (j > 1) {
-		jl = j - 1;
-		prim[i__] = spt[jl - 1] + (ear[i__] / 511. * (z_red__ + 1) -
-			xth[jl - 1]) * (spt[jl] - spt[jl - 1]) / (xth[jl] -
-			xth[jl - 1]);
-	    } else {
-		prim[i__] = spt[0];
-	    }
-	}
-    }
-    i__1 = ne;
-    for (i__ = 1; i__ <= i__1; ++i__) {
-      photar[i__] = (prim[i__] / pow(ear[i__], c_b2) + prim[i__ - 1] /
-          pow(ear[i__ - 1], c_b2)) * .5 * (ear[i__] - ear[i__ - 1])
-          * normfac;
-    }
+  c_nthcomp_intrinsic(param, xth, &nth, spt);
+  c_nthcomp_rebin(ear, ne, param[4], xth, nth, spt, photar);
 } /* f_donthcomp__ */
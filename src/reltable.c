@@ -17,8 +17,24 @@
 */
 
 #include "reltable.h"
+#include "Profiling.h"
 #include "time.h"
 
+/** memory of a rel table with all its data (as allocated by new_relTable and new_relDat) */
+static long long get_relTable_nbytes(int n_a, int n_mu0, int n_r, int n_g) {
+  const long long nbytes_dat = (long long) (sizeof(relDat) + 3 * n_r * sizeof(float)
+      + 4 * n_r * (sizeof(float *) + n_g * sizeof(float)));
+  return (long long) (sizeof(relTable) + (n_a + n_mu0) * sizeof(float) + n_a * sizeof(relDat **)
+      + n_a * n_mu0 * sizeof(relDat *)) + n_a * n_mu0 * nbytes_dat;
+}
+
+/** memory of a LP table with all its data (as allocated by new_lpTable and new_lpDat) */
+static long long get_lpTable_nbytes(int n_a, int n_h, int n_rad) {
+  const long long nbytes_dat = (long long) (n_h * sizeof(lpDat) + (n_h + n_rad) * sizeof(float)
+      + 3 * n_h * (sizeof(float *) + n_rad * sizeof(float)));
+  return (long long) (sizeof(lpTable) + n_a * (sizeof(float) + sizeof(lpDat *))) + n_a * nbytes_dat;
+}
+
 static relDat *new_relDat(int nr, int ng, int *status) {
   relDat *dat = (relDat *) malloc(sizeof(relDat));
   CHECK_MALLOC_RET_STATUS(dat, status, dat);
@@ -98,6 +114,8 @@ relTable *new_relTable(int n_a, int n_mu0, int n_r, int n_g, int *status) {
 
   tab->arr = NULL;
 
+  prof_mem_add(PROF_MEM_RELTABLE, get_relTable_nbytes(n_a, n_mu0, n_r, n_g));
+
   tab->arr = (relDat ***) malloc(sizeof(relDat **) * tab->n_a);
   CHECK_MALLOC_RET_STATUS(tab->arr, status, tab);
 
@@ -483,6 +501,8 @@ void free_relTable(relTable *tab) {
       }
       free(tab->arr);
     }
+    prof_mem_add(PROF_MEM_RELTABLE, -get_relTable_nbytes(tab->n_a, tab->n_mu0, tab->n_r, tab->n_g));
+
     free(tab->a);
     free(tab->mu0);
     free(tab);
@@ -499,6 +519,8 @@ lpTable *new_lpTable(int n_a, int n_h, int n_rad, int *status) {
 
   tab->a = NULL;
 
+  prof_mem_add(PROF_MEM_LPTABLE, get_lpTable_nbytes(n_a, n_h, n_rad));
+
   tab->dat = (lpDat **) malloc(sizeof(lpDat *) * tab->n_a);
   CHECK_MALLOC_RET_STATUS(tab->dat, status, tab);
 
@@ -539,6 +561,8 @@ void free_lpTable(lpTable *tab) {
       }
       free(tab->dat);
     }
+    prof_mem_add(PROF_MEM_LPTABLE, -get_lpTable_nbytes(tab->n_a, tab->n_h, tab->n_rad));
+
     free(tab->a);
     free(tab);
   }
@@ -19,6 +19,7 @@
 #include "relutility.h"
 #include "common.h"
 #include "config.h"
+#include "Profiling.h"
 
 /** linear interpolation in 1 dimension **/
 double interp_lin_1d(double ifac_r, double rlo, double rhi) {
@@ -170,6 +171,78 @@ int binary_search(const double *arr, int n, double val) {
   return klo;
 }
 
+/** check if all steps (or ratios, if logarithmic) of the array are the same within a relative precision **/
+static int is_uniform_grid(const double *arr, int n, int logarithmic) {
+  const double prec = 1e-8;
+  double step = (logarithmic) ? pow(arr[n - 1] / arr[0], 1.0 / (n - 1)) - 1.0 : (arr[n - 1] - arr[0]) / (n - 1);
+  if (step <= 0) {
+    return 0;
+  }
+  for (int ii = 0; ii < n - 1; ii++) {
+    double del = (logarithmic) ? arr[ii + 1] / arr[ii] - 1.0 : arr[ii + 1] - arr[ii];
+    if (fabs(del - step) > prec * step) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void set_grid_descriptor(gridDescriptor *grid, const double *arr, int n) {
+
+  grid->val = arr;
+  grid->n = n;
+  grid->type = GRID_ARBITRARY;
+  grid->x0 = 0.0;
+  grid->inv_step = 0.0;
+
+  if (n < 3) {
+    return;
+  }
+
+  if (is_uniform_grid(arr, n, 0)) {
+    grid->type = GRID_LIN_UNIFORM;
+    grid->x0 = arr[0];
+    grid->inv_step = (n - 1) / (arr[n - 1] - arr[0]);
+  } else if (arr[0] > 0 && is_uniform_grid(arr, n, 1)) {
+    grid->type = GRID_LOG_UNIFORM;
+    grid->x0 = log(arr[0]);
+    grid->inv_step = (n - 1) / log(arr[n - 1] / arr[0]);
+  }
+}
+
+int grid_search(const gridDescriptor *grid, double val) {
+
+  const double *arr = grid->val;
+  const int n = grid->n;
+
+  if (grid->type == GRID_ARBITRARY) {
+    return binary_search(arr, n, val);
+  }
+
+  if (val <= arr[0]) {
+    return 0;
+  } else if (!(val < arr[n - 1])) {  // (also catches NaN, as binary_search)
+    return n - 2;
+  }
+
+  double x = (grid->type == GRID_LOG_UNIFORM) ? log(val) : val;
+  int k = (int) ((x - grid->x0) * grid->inv_step);
+  if (k < 0) {
+    k = 0;
+  } else if (k > n - 2) {
+    k = n - 2;
+  }
+
+  // correct for the rounding of the closed form, such that the result is identical to binary_search
+  while (k > 0 && arr[k] > val) {
+    k--;
+  }
+  while (k < n - 2 && arr[k + 1] <= val) {
+    k++;
+  }
+  return k;
+}
+
 /**  FLOAT search for value "val" in array "arr" (sorted DESCENDING!) with length n and
  	 return bin k for which arr[k]<=val<arr[k+1] **/
 int inv_binary_search_float(const float *arr, int n, float val) {
@@ -372,6 +445,83 @@ int do_not_normalize_relline(void) {
   return 0;
 }
 
+/** get the filename for the trace of the model evaluation (NULL if it should not be written) **/
+char *get_relxill_trace_filename(void) {
+  char *fname = getenv("RELXILL_TRACE");
+  if (fname != NULL && strlen(fname) > 0) {
+    return fname;
+  }
+  return NULL;
+}
+
+/** get the filename for recording all calls of the model (NULL if they should not be recorded) **/
+char *get_relxill_record_filename(void) {
+  char *fname = getenv("RELXILL_RECORD");
+  if (fname != NULL && strlen(fname) > 0) {
+    return fname;
+  }
+  return NULL;
+}
+
+/** check if the model evaluation should be profiled (see Profiling.h) **/
+int is_profiling_run(void) {
+  char *env;
+  env = getenv("RELXILL_PROFILE");
+  if (env != NULL) {
+    int envval = (int) strtod(env, NULL);
+    if (envval == 1) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/** check if the nthcomp spectrum should be interpolated from a table (see Nthcomp.h) **/
+int use_nthcomp_table(void) {
+  char *env;
+  env = getenv("RELXILL_NTHCOMP_TABLE");
+  if (env != NULL) {
+    int envval = (int) strtod(env, NULL);
+    if (envval == 1) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/** get the number of threads for parallel evaluations from ENV (returns 0 if not set) **/
+int get_num_threads(void) {
+  char *env;
+  env = getenv("RELXILL_NUM_THREADS");
+  if (env != NULL) {
+    int num_threads = (int) strtod(env, NULL);
+    if (num_threads > 0) {
+      return num_threads;
+    }
+    printf(" *** warning: value of %i for RELXILL_NUM_THREADS needs to be larger than 0 \n", num_threads);
+  }
+  return 0;
+}
+
+static int is_merge_tolerance_warned = 0;
+
+/** get the tolerance for merging ionization zones with similar xillver parameters from ENV (0 if not set) **/
+double get_zone_merge_tolerance(void) {
+  char *env;
+  env = getenv("RELXILL_MERGE_ZONES");
+  if (env != NULL) {
+    double tolerance = strtod(env, NULL);
+    if (tolerance > 0) {
+      return tolerance;
+    }
+    // only warn once (and not for every evaluation of the model)
+    if (!__atomic_exchange_n(&is_merge_tolerance_warned, 1, __ATOMIC_RELAXED)) {
+      printf(" *** warning: value of %e for RELXILL_MERGE_ZONES needs to be larger than 0 \n", tolerance);
+    }
+  }
+  return 0.0;
+}
+
 /* get a logarithmic grid from emin to emax with n_ener bins  */
 void get_log_grid(double *ener, int n_ener, double emin, double emax) {
   int ii;
@@ -540,6 +690,8 @@ void rebin_spectrum(const double *ener, double *flu, int nbins, const double *en
   int imin = 0;
   int imax = 0;
 
+  long long t_start = prof_start();
+
   for (ii = 0; ii < nbins; ii++) {
 
     flu[ii] = 0.0;
@@ -585,6 +737,7 @@ void rebin_spectrum(const double *ener, double *flu, int nbins, const double *en
     }
 
   }
+  prof_stop(PROF_REBIN, t_start);
 }
 
 int do_renorm_model(relParam *rel_param) {
@@ -726,7 +879,7 @@ double calcSum(const double *array, int n_array) {
 /*
  * ener has n_array+1 bins
  */
-double calcSumInEnergyBand(const double *array, int n_array, double *ener, double valLo, double valHi) {
+double calcSumInEnergyBand(const double *array, int n_array, const double *ener, double valLo, double valHi) {
   double testSum = 0.0;
   for (int jj = 0; jj < n_array; jj++) {
     if (ener[jj] >= valLo && ener[jj + 1] <= valHi) {
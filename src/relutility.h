@@ -98,6 +98,12 @@ int binary_search_float(const float *arr, int n, float val);
 
 int binary_search(const double *arr, int n, double val);
 
+/** describe the grid arr (length n, sorted ASCENDING), detecting if it is linear or logarithmic uniform **/
+void set_grid_descriptor(gridDescriptor *grid, const double *arr, int n);
+
+/** same as binary_search on the grid, but O(1) for linear or logarithmic uniform grids **/
+int grid_search(const gridDescriptor *grid, double val);
+
 /** trapez integration around a single bin (returns only r*dr*PI!) **/
 double trapez_integ_single(const double *re, int ii, int nr);
 double trapez_integ_single_rad_ascending(const double *re, int ii, int nr);
@@ -122,6 +128,24 @@ void rebin_spectrum(const double *ener, double *flu, int nbins, const double *en
 /** get the relxill table path (dynamically from env variable)  **/
 char *get_relxill_table_path(void);
 
+/** check if the model evaluation should be profiled (see Profiling.h) **/
+int is_profiling_run(void);
+
+/** get the filename for the trace of the model evaluation (NULL if it should not be written) **/
+char *get_relxill_trace_filename(void);
+
+/** get the filename for recording all calls of the model (NULL if they should not be recorded) **/
+char *get_relxill_record_filename(void);
+
+/** check if the nthcomp spectrum should be interpolated from a table (see Nthcomp.h) **/
+int use_nthcomp_table(void);
+
+/** get the number of threads for parallel evaluations from ENV (returns 0 if not set) **/
+int get_num_threads(void);
+
+/** get the tolerance for merging ionization zones with similar xillver parameters from ENV (0 if not set) **/
+double get_zone_merge_tolerance(void);
+
 /** get the number of zones **/
 int get_num_zones(int model_type, int emis_type, int ion_grad_type);
 
@@ -145,7 +169,7 @@ void inv_rebin_mean(double *x0, double *y0, int n0, double *xn, double *yn, int
 void rebin_mean_flux(double *x0, double *y0, int n0, double *xn, double *yn, int nn, int *status);
 
 double calcSum(const double *array, int n_array);
-double calcSumInEnergyBand(const double *array, int n_array, double *ener, double valLo, double valHi);
+double calcSumInEnergyBand(const double *array, int n_array, const double *ener, double valLo, double valHi);
 
 void setArrayToZero(double *arr, int n);
 
@@ -18,6 +18,8 @@
 
 #include "xilltable.h"
 #include "common.h"
+#include "Profiling.h"
+#include "Buffer2D.h"
 
 
 // possible parameters for the xillver tables
@@ -57,6 +59,7 @@ static void init_xilltable_data_struct(xillTable *tab, int *status) {
 
   tab->data_storage = (float **) malloc(sizeof(float *) * tab->num_elements);
   CHECK_MALLOC_VOID_STATUS(tab->data_storage, status)
+  prof_mem_add(PROF_MEM_XILLTABLE, (long long) (sizeof(float *) * tab->num_elements));
 
   // important to make sure everything is set to NULL (used to only load spectra if !=NULL)
   int ii;
@@ -336,10 +339,15 @@ get_xillspec_rownum(const int *num_param_vals, int num_param, int nn, int ii, in
   return -1;
 }
 
+/* the spectra of a table are shared by all threads: a spectrum is only loaded (under the lock of
+ * get_xillver_spectra_table) if it was not loaded before, and it is published only after it is
+ * completely written and never changed afterwards. As it is read without the lock, the pointer is
+ * stored with release and loaded with acquire semantics (see get_xillspec) */
 static void set_dat(float *spec, xillTable *tab, int i0, int i1, int i2, int i3, int i4, int i5) {
   int index = get_xillspec_rownum(tab->num_param_vals, tab->num_param,
                                   i0, i1, i2, i3, i4, i5);
-  tab->data_storage[index] = spec;
+  __atomic_store_n(&(tab->data_storage[index]), spec, __ATOMIC_RELEASE);
+  prof_mem_add(PROF_MEM_XILLTABLE, (long long) (sizeof(float) * tab->n_ener));
 }
 
 // get one Spectrum from the Data Storage
@@ -348,7 +356,7 @@ float *get_xillspec(xillTable *tab, int i0, int i1, int i2, int i3, int i4, int
   int index = get_xillspec_rownum(tab->num_param_vals, tab->num_param,
                                   i0, i1, i2, i3, i4, i5);
 
-  return tab->data_storage[index];
+  return __atomic_load_n(&(tab->data_storage[index]), __ATOMIC_ACQUIRE);
 }
 
 static char *getFullPathTableName(const char *filename, int *status) {
@@ -593,6 +601,9 @@ void check_xilltab_cache(const char *fname, const xillTableParam *param, xillTab
   double defDensity = getDefaultDensity(param);
   double defLogxi = getDefaultLogxi(param);
 
+  long long t_start = prof_start();
+  int num_loaded = 0;
+
   int ii, jj, kk, ll, mm, nn;
   for (nn = i0lo; nn <= i0hi; nn++) { // for 5dim this is a dummy loop
     for (ii = ind[istart]; ii <= ind[istart] + 1; ii++) {
@@ -602,7 +613,9 @@ void check_xilltab_cache(const char *fname, const xillTableParam *param, xillTab
             // always load **all** incl bins as for relxill we will certainly need it
             for (mm = 0; mm < tab->n_incl; mm++) {
 
+              prof_cache_access(PROF_CACHE_XILLTAB_SPEC, get_xillspec(tab, nn, ii, jj, kk, ll, mm) != NULL);
               if (get_xillspec(tab, nn, ii, jj, kk, ll, mm) == NULL) {
+                num_loaded++;
                 xilltable_fits_load_single_spec(fname,
                                                 &fptr,
                                                 tab,
@@ -632,6 +645,12 @@ void check_xilltab_cache(const char *fname, const xillTableParam *param, xillTab
     }
   }
 
+  if (num_loaded > 0) {
+    char trace_args[64];
+    sprintf(trace_args, "\"num_spectra_loaded\": %i", num_loaded);
+    prof_stop_args(PROF_XILLTAB_FITS_LOAD, t_start, trace_args);
+  }
+
 }
 
 xillSpec *new_xill_spec(int n_incl, int n_ener, int *status) {
@@ -650,15 +669,9 @@ xillSpec *new_xill_spec(int n_incl, int n_ener, int *status) {
   spec->incl = (double *) malloc(sizeof(double) * (n_incl));
   CHECK_MALLOC_RET_STATUS(spec->incl, status, spec)
 
-  spec->flu = (double **) malloc(sizeof(double *) * n_incl);
+  spec->flu = new_buffer_2d(n_incl, n_ener, status);
   CHECK_MALLOC_RET_STATUS(spec->flu, status, spec)
 
-  int ii;
-  for (ii = 0; ii < n_incl; ii++) {
-    spec->flu[ii] = (double *) malloc(sizeof(double) * n_ener);
-    CHECK_MALLOC_RET_STATUS(spec->flu[ii], status, spec)
-  }
-
   assert(spec != NULL);
 
   return spec;
@@ -668,13 +681,7 @@ void free_xill_spec(xillSpec *spec) {
   if (spec != NULL) {
     free(spec->ener);
     free(spec->incl);
-    if (spec->flu != NULL) {
-      int ii;
-      for (ii = 0; ii < spec->n_incl; ii++) {
-        free(spec->flu[ii]);
-      }
-      free(spec->flu);
-    }
+    free_buffer_2d(spec->flu);
     free(spec);
   }
 }
@@ -776,10 +783,12 @@ void free_xillTable(xillTable *tab) {
       for (ii = 0; ii < tab->num_elements; ii++) {
         if (tab->data_storage[ii] != NULL) {
           free(tab->data_storage[ii]);
+          prof_mem_add(PROF_MEM_XILLTABLE, -(long long) (sizeof(float) * tab->n_ener));
         }
 
       }
       free(tab->data_storage);
+      prof_mem_add(PROF_MEM_XILLTABLE, -(long long) (sizeof(float *) * tab->num_elements));
     }
 
     if (tab->param_vals != NULL) {
@@ -1091,6 +1100,8 @@ xillSpec *interp_xill_table(xillTable *tab, xillTableParam *param, const int *in
 
   CHECK_STATUS_RET(*status, NULL);
 
+  long long t_start = prof_start();
+
   xillSpec *spec = NULL;
   if (is_xill_model(param->model_type)) {
     spec = new_xill_spec(1, tab->n_ener, status);
@@ -1177,5 +1188,6 @@ xillSpec *interp_xill_table(xillTable *tab, xillTableParam *param, const int *in
 
   free(ipol_fac);
 
+  prof_stop(PROF_XILLTAB_INTERP, t_start);
   return spec;
 }
@@ -0,0 +1,394 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+/*
+ * Benchmarks of the single stages of the model evaluation, each of them isolated from the rest of the
+ * model (and its caches). Every benchmark is run for a number of warm-up calls (e.g., loading the
+ * tables) and then timed for a number of repetitions, reporting the median and the 95th percentile.
+ *
+ * usage: ./benchmark_stages [-n <repetitions>] [-w <warmup>] [-o <output.json>] [<filter>]
+ *   (only benchmarks whose name contains <filter> are run)
+ */
+
+#include "LocalModel.h"
+#include "XspecSpectrum.h"
+#include "Relbase.h"
+#include "Relprofile.h"
+#include "Rellp.h"
+#include "Relphysics.h"
+#include "IonGradient.h"
+#include "Xillspec.h"
+#include "Relreturn_Corona.h"
+#include "Relreturn_Table.h"
+
+extern "C" {
+#include "relutility.h"
+#include "xilltable.h"
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchmarkConfig {
+  int num_repetitions = 50;
+  int num_warmup = 3;
+  std::string filter{};
+};
+
+struct BenchmarkResult {
+  std::string name;
+  std::string config;   // body of a JSON object
+  int num_repetitions;
+  double median_usec;
+  double p95_usec;
+  double min_usec;
+  double mean_usec;
+};
+
+/**
+ * run func() num_warmup times without timing and then time num_repetitions calls
+ */
+static void run_benchmark(std::vector<BenchmarkResult> &results, const BenchmarkConfig &bench_config,
+                          const std::string &name, const std::string &config,
+                          const std::function<void()> &func) {
+
+  if (!bench_config.filter.empty() && name.find(bench_config.filter) == std::string::npos) {
+    return;
+  }
+
+  for (int ii = 0; ii < bench_config.num_warmup; ii++) {
+    func();
+  }
+
+  std::vector<double> times_usec;
+  for (int ii = 0; ii < bench_config.num_repetitions; ii++) {
+    auto tstart = std::chrono::steady_clock::now();
+    func();
+    auto tend = std::chrono::steady_clock::now();
+    times_usec.push_back(std::chrono::duration<double, std::micro>(tend - tstart).count());
+  }
+
+  std::sort(times_usec.begin(), times_usec.end());
+  const auto num = times_usec.size();
+  double sum = 0.0;
+  for (auto time: times_usec) {
+    sum += time;
+  }
+
+  BenchmarkResult result{name, config, static_cast<int>(num),
+                         0.5 * (times_usec[(num - 1) / 2] + times_usec[num / 2]),
+                         times_usec[static_cast<size_t>(ceil(0.95 * static_cast<double>(num))) - 1],
+                         times_usec[0],
+                         sum / static_cast<double>(num)};
+
+  printf(" %-28s %-40s median %10.1f usec   p95 %10.1f usec \n",
+         name.c_str(), config.c_str(), result.median_usec, result.p95_usec);
+  results.push_back(result);
+}
+
+static void check_status(int status, const char *name) {
+  if (status != EXIT_SUCCESS) {
+    printf(" *** error: benchmark %s failed \n", name);
+    exit(EXIT_FAILURE);
+  }
+}
+
+static std::vector<double> get_log_energy_grid(int n_bins, double emin, double emax) {
+  std::vector<double> ener(n_bins + 1);
+  DefaultSpec::set_log_grid(ener.data(), ener.size(), emin, emax);
+  return ener;
+}
+
+// ------------------------- //
+
+static void bench_interpol_relTable(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg) {
+  int status = EXIT_SUCCESS;
+  double spin = 0.9;
+  run_benchmark(results, cfg, "interpol_relTable", "\"a\": 0.9", [&]() {
+    // slightly change the spin such that nothing can be re-used
+    spin = (spin > 0.95) ? 0.9 : spin + 1e-4;
+    RelSysPar *sys_par = interpol_relTable(spin, 30.0 * M_PI / 180, kerr_rms(spin), 400.0, &status);
+    free_relSysPar(sys_par);
+  });
+  check_status(status, "interpol_relTable");
+}
+
+static void bench_calc_relline_profile(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg,
+                                       int num_zones) {
+  int status = EXIT_SUCCESS;
+
+  LocalModel local_model{ModelName::relxilllp};
+  relParam *rel_param = local_model.get_rel_params();
+  xillParam *xill_param = local_model.get_xill_params();
+  rel_param->num_zones = num_zones;
+  RelSysPar *sys_par = get_system_parameters(rel_param, &status);
+
+  int n_ener;
+  double *ener;
+  get_relxill_conv_energy_grid(&n_ener, &ener, &status);
+  RadialGrid radial_grid{rel_param->rin, rel_param->rout, num_zones, rel_param->height};
+  xillTable *xill_tab = get_xillver_table(xill_param->model_type, xill_param->prim_type, &status);
+
+  relline_spec_multizone *spec = nullptr;
+  init_relline_spec_multizone(&spec, rel_param, xill_tab, radial_grid.radius, &ener, n_ener, &status);
+  check_status(status, "calc_relline_profile");
+
+  run_benchmark(results, cfg, "calc_relline_profile",
+                "\"n_zones\": " + std::to_string(num_zones) + ", \"n_energy\": " + std::to_string(n_ener),
+                [&]() {
+                  calc_relline_profile(spec, sys_par, &status);
+                });
+  check_status(status, "calc_relline_profile");
+
+  free_rel_spec(spec);
+  delete rel_param;
+  delete xill_param;
+}
+
+static void bench_interp_xill_table(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg,
+                                    ModelName model_name) {
+  int status = EXIT_SUCCESS;
+
+  LocalModel local_model{model_name};
+  xillParam *xill_param = local_model.get_xill_params();
+  xillTableParam *param = get_xilltab_param(xill_param, &status);
+
+  xillTable *tab = nullptr;
+  const char *fname = get_init_xillver_table(&tab, param->model_type, param->prim_type, &status);
+  int *indparam = get_xilltab_indices_for_paramvals(param, tab, &status);
+  check_xilltab_cache(fname, param, tab, indparam, &status);
+  check_status(status, "interp_xill_table");
+
+  run_benchmark(results, cfg, "interp_xill_table",
+                "\"model\": \"" + local_model.get_model_string() + "\", \"n_dim\": "
+                    + std::to_string(tab->num_param),
+                [&]() {
+                  xillSpec *spec = interp_xill_table(tab, param, indparam, &status);
+                  free_xill_spec(spec);
+                });
+  check_status(status, "interp_xill_table");
+
+  free(indparam);
+  free(param);
+  delete xill_param;
+}
+
+static void bench_fftw_conv_spectrum(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg,
+                                     int num_zones) {
+  int status = EXIT_SUCCESS;
+
+  int n_ener;
+  double *ener;
+  get_relxill_conv_energy_grid(&n_ener, &ener, &status);
+  specCache *spec_cache = init_global_specCache(&status);
+
+  std::vector<double> fxill(n_ener);
+  std::vector<double> frel(n_ener, 0.0);
+  std::vector<double> fout(n_ener);
+  for (int ii = 0; ii < n_ener; ii++) {
+    fxill[ii] = pow(0.5 * (ener[ii] + ener[ii + 1]), -2.0) * (ener[ii + 1] - ener[ii]);
+    if (ener[ii] > 0.5 && ener[ii] < 1.2) {
+      frel[ii] = 1.0;
+    }
+  }
+
+  run_benchmark(results, cfg, "fftw_conv_spectrum",
+                "\"n_zones\": " + std::to_string(num_zones) + ", \"n_energy\": " + std::to_string(n_ener),
+                [&]() {
+                  for (int izone = 0; izone < num_zones; izone++) {
+                    fftw_conv_spectrum(ener, fxill.data(), frel.data(), fout.data(), n_ener, 1, 1, izone,
+                                       spec_cache, &status);
+                  }
+                });
+  check_status(status, "fftw_conv_spectrum");
+}
+
+static void bench_rebin_spectrum(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg,
+                                 int n_bins) {
+  int status = EXIT_SUCCESS;
+
+  int n_ener0;
+  double *ener0;
+  get_relxill_conv_energy_grid(&n_ener0, &ener0, &status);
+  std::vector<double> flux0(n_ener0, 1.0);
+
+  auto ener = get_log_energy_grid(n_bins, 0.1, 1000.0);
+  std::vector<double> flux(n_bins);
+
+  run_benchmark(results, cfg, "rebin_spectrum", "\"n_energy\": " + std::to_string(n_bins), [&]() {
+    rebin_spectrum(ener.data(), flux.data(), n_bins, ener0, flux0.data(), n_ener0);
+  });
+  check_status(status, "rebin_spectrum");
+}
+
+static void bench_calc_rrad_emis_corona(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg) {
+  int status = EXIT_SUCCESS;
+
+  const double spin = 0.998;
+  returningFractions *ret_fractions = get_rrad_fractions(spin, kerr_rms(spin), 1000.0, &status);
+  emisProfile *emis = new_emisProfile(ret_fractions->rad, ret_fractions->nrad, &status);
+  get_emis_bkn(emis->emis, emis->re, emis->nr, 3.0, 3.0, emis->re[0]);
+  check_status(status, "calc_rrad_emis_corona");
+
+  // changing gamma requires to calculate all weights
+  double gamma = 2.0;
+  run_benchmark(results, cfg, "calc_rrad_emis_corona",
+                "\"n_rad\": " + std::to_string(ret_fractions->nrad) + ", \"weights_cached\": false",
+                [&]() {
+                  gamma = (gamma > 2.1) ? 2.0 : gamma + 1e-4;
+                  emisProfile *emis_return = calc_rrad_emis_corona(ret_fractions, nullptr, emis, gamma, &status);
+                  free_emisProfile(emis_return);
+                });
+
+  // for a changed emissivity only the matrix-vector product is calculated
+  run_benchmark(results, cfg, "calc_rrad_emis_corona",
+                "\"n_rad\": " + std::to_string(ret_fractions->nrad) + ", \"weights_cached\": true",
+                [&]() {
+                  emis->emis[0] *= 1.0001;
+                  emisProfile *emis_return = calc_rrad_emis_corona(ret_fractions, nullptr, emis, gamma, &status);
+                  free_emisProfile(emis_return);
+                });
+  check_status(status, "calc_rrad_emis_corona");
+
+  free_emisProfile(emis);
+  free_returningFractions(&ret_fractions);
+}
+
+static void bench_c_donthcomp(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg, int n_bins) {
+
+  auto ener = get_log_energy_grid(n_bins, 0.1, 1000.0);
+  std::vector<double> photar(n_bins);
+  double nthcomp_param[5];
+  get_nthcomp_param(nthcomp_param, 2.0, 60.0, 0.0);
+
+  run_benchmark(results, cfg, "c_donthcomp", "\"n_energy\": " + std::to_string(n_bins), [&]() {
+    c_donthcomp(ener.data(), n_bins, nthcomp_param, photar.data());
+  });
+}
+
+static void bench_calculate_gradient(std::vector<BenchmarkResult> &results, const BenchmarkConfig &cfg,
+                                     int num_zones) {
+  int status = EXIT_SUCCESS;
+
+  LocalModel local_model{ModelName::relxilllpion};
+  relParam *rel_param = local_model.get_rel_params();
+  xillParam *xill_param = local_model.get_xill_params();
+  RelSysPar *sys_par = get_system_parameters(rel_param, &status);
+  check_status(status, "IonGradient::calculate_gradient");
+
+  RadialGrid radial_grid{rel_param->rin, rel_param->rout, num_zones, rel_param->height};
+  IonGradient ion_gradient{radial_grid, rel_param->ion_grad_type, xill_param->iongrad_index};
+  PrimarySourceParameters primary_source_params{local_model.get_model_params()};
+
+  run_benchmark(results, cfg, "IonGradient::calculate_gradient", "\"n_zones\": " + std::to_string(num_zones),
+                [&]() {
+                  ion_gradient.calculate_gradient(*(sys_par->emis), primary_source_params);
+                });
+
+  delete rel_param;
+  delete xill_param;
+}
+
+// ------------------------- //
+
+static void write_json(const char *fname, const std::vector<BenchmarkResult> &results,
+                       const BenchmarkConfig &cfg) {
+
+  FILE *fp = fopen(fname, "w");
+  if (fp == nullptr) {
+    printf(" *** error: failed to open file %s \n", fname);
+    exit(EXIT_FAILURE);
+  }
+
+  int status = EXIT_SUCCESS;
+  char *version = nullptr;
+  get_version_number(&version, &status);
+  fprintf(fp, "{\n  \"version\": \"%s\",\n  \"warmup\": %i,\n  \"benchmarks\": [\n",
+          (version != nullptr) ? version : "", cfg.num_warmup);
+  for (size_t ii = 0; ii < results.size(); ii++) {
+    const auto &res = results[ii];
+    fprintf(fp, "    {\"name\": \"%s\", \"config\": {%s}, \"repetitions\": %i, \"median_usec\": %.3f, "
+                "\"p95_usec\": %.3f, \"min_usec\": %.3f, \"mean_usec\": %.3f}%s\n",
+            res.name.c_str(), res.config.c_str(), res.num_repetitions, res.median_usec, res.p95_usec,
+            res.min_usec, res.mean_usec, (ii + 1 < results.size()) ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+  fclose(fp);
+  free(version);
+
+  printf(" wrote results to %s \n", fname);
+}
+
+int main(int argc, char *argv[]) {
+
+  BenchmarkConfig cfg;
+  const char *fname_json = nullptr;
+
+  for (int ii = 1; ii < argc; ii++) {
+    if (strcmp(argv[ii], "-n") == 0 && ii + 1 < argc) {
+      cfg.num_repetitions = atoi(argv[++ii]);
+    } else if (strcmp(argv[ii], "-w") == 0 && ii + 1 < argc) {
+      cfg.num_warmup = atoi(argv[++ii]);
+    } else if (strcmp(argv[ii], "-o") == 0 && ii + 1 < argc) {
+      fname_json = argv[++ii];
+    } else if (argv[ii][0] != '-') {
+      cfg.filter = argv[ii];
+    } else {
+      printf(" usage: ./benchmark_stages [-n <repetitions>] [-w <warmup>] [-o <output.json>] [<filter>] \n");
+      return EXIT_FAILURE;
+    }
+  }
+  if (cfg.num_repetitions < 1) {
+    cfg.num_repetitions = 1;
+  }
+
+  const std::vector<int> zone_counts{1, 10, 50};
+  const std::vector<int> grid_sizes{1000, 3000, 10000};
+
+  std::vector<BenchmarkResult> results;
+
+  bench_interpol_relTable(results, cfg);
+  for (int num_zones: zone_counts) {
+    bench_calc_relline_profile(results, cfg, num_zones);
+  }
+  bench_interp_xill_table(results, cfg, ModelName::xillver);
+  bench_interp_xill_table(results, cfg, ModelName::xillverCp);
+  for (int num_zones: zone_counts) {
+    bench_fftw_conv_spectrum(results, cfg, num_zones);
+  }
+  for (int n_bins: grid_sizes) {
+    bench_rebin_spectrum(results, cfg, n_bins);
+  }
+  bench_calc_rrad_emis_corona(results, cfg);
+  for (int n_bins: grid_sizes) {
+    bench_c_donthcomp(results, cfg, n_bins);
+  }
+  for (int num_zones: zone_counts) {
+    bench_calculate_gradient(results, cfg, num_zones);
+  }
+
+  if (fname_json != nullptr) {
+    write_json(fname_json, results, cfg);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,607 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+/*
+ * Create synthetic versions of all tables the model needs (relline table, LP table, return radiation
+ * table and xillver tables). The files have the same name and the same extension layout as the real
+ * tables (as expected by read_relline_table, read_lp_table, get_rrad_fractions and init_xillver_table),
+ * but are filled with smooth synthetic data. They are NOT physical and only allow to run the
+ * benchmarks and tests hermetically, e.g., on a build machine without the real tables.
+ *
+ * usage: ./create_synthetic_tables [options]
+ *    -o <dir>          output directory (default: RELXILL_TABLE_PATH)
+ *    -t <table>        only create the given table (rel, lp, rrad, xill, xillCp, xillNS, xillCO),
+ *                      can be given several times (default: all tables)
+ *    -n <num>          number of values of each xillver parameter, except the inclination (default: 4)
+ *    -i <num>          number of inclination values of the xillver tables (default: 10)
+ *    -e <num>          number of energy bins of the xillver tables (default: 2999)
+ *    -s <num>          number of spin values of the return radiation table (default: 20)
+ *
+ * The dimensions of the relline, LP and return radiation tables in radius, height and energy shift are
+ * fixed by their definition in common.h (and therefore can not be changed here).
+ */
+
+extern "C" {
+#include "common.h"
+#include "relutility.h"
+#include "xilltable.h"
+}
+#include "Relphysics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fitsio.h>
+
+struct SyntheticTableSizes {
+  int xill_num_values = 4;
+  int xill_num_incl = 10;
+  int xill_num_ener = 2999;
+  int rrad_num_spin = 20;
+};
+
+static void check_fits_status(int status, const std::string &msg) {
+  if (status != EXIT_SUCCESS) {
+    fits_report_error(stderr, status);
+    printf(" *** error: %s \n", msg.c_str());
+    exit(EXIT_FAILURE);
+  }
+}
+
+static fitsfile *create_fits_file(const std::string &dir, const char *fname) {
+  int status = EXIT_SUCCESS;
+  fitsfile *fptr = nullptr;
+
+  std::string full_fname = "!" + dir + "/" + fname;   // "!" overwrites an existing file
+  fits_create_file(&fptr, full_fname.c_str(), &status);
+  fits_create_img(fptr, BYTE_IMG, 0, nullptr, &status);
+  fits_write_comment(fptr, "synthetic table (not physical), for testing only", &status);
+  check_fits_status(status, std::string("creating ") + full_fname);
+
+  return fptr;
+}
+
+static void close_fits_file(fitsfile *fptr, const char *fname) {
+  int status = EXIT_SUCCESS;
+  fits_close_file(fptr, &status);
+  check_fits_status(status, std::string("writing ") + fname);
+  printf(" created synthetic table %s \n", fname);
+}
+
+/** create a binary table extension with the given columns (name and TFORM) */
+static void create_extension(fitsfile *fptr, const char *extname, long nrows,
+                             const std::vector<std::string> &colnames,
+                             const std::vector<std::string> &colforms) {
+  int status = EXIT_SUCCESS;
+
+  std::vector<char *> ttype;
+  std::vector<char *> tform;
+  for (size_t ii = 0; ii < colnames.size(); ii++) {
+    ttype.push_back(const_cast<char *>(colnames[ii].c_str()));
+    tform.push_back(const_cast<char *>(colforms[ii].c_str()));
+  }
+
+  fits_create_tbl(fptr, BINARY_TBL, nrows, static_cast<int>(colnames.size()), ttype.data(), tform.data(),
+                  nullptr, extname, &status);
+  check_fits_status(status, std::string("creating extension ") + extname);
+}
+
+static void write_col(fitsfile *fptr, int datatype, int colnum, long row, long nelem, void *data) {
+  int status = EXIT_SUCCESS;
+  fits_write_col(fptr, datatype, colnum, row, 1, nelem, data, &status);
+  check_fits_status(status, "writing column " + std::to_string(colnum));
+}
+
+static std::vector<float> get_lin_grid_float(int n, double vmin, double vmax) {
+  std::vector<float> grid(n);
+  for (int ii = 0; ii < n; ii++) {
+    grid[ii] = static_cast<float>(vmin + (vmax - vmin) * ii / (n - 1));
+  }
+  return grid;
+}
+
+static std::vector<double> get_log_grid(int n, double vmin, double vmax) {
+  std::vector<double> grid(n);
+  for (int ii = 0; ii < n; ii++) {
+    grid[ii] = exp(log(vmin) + (log(vmax) - log(vmin)) * ii / (n - 1));
+  }
+  grid[n - 1] = vmax;
+  return grid;
+}
+
+/** smooth approximation of the energy shift from the disk at radius r to the observer */
+static double synthetic_gshift(double rad, double sin_incl) {
+  const double g_grav = 1.0 - 1.5 / (rad + 1.0);
+  const double v_orb = 1.0 / sqrt(rad);
+  return g_grav * (1.0 + v_orb * (0.5 * sin_incl + 0.05));
+}
+
+// ------------------------- //
+// relline table
+// ------------------------- //
+
+static void create_rel_table(const std::string &dir) {
+
+  fitsfile *fptr = create_fits_file(dir, RELTABLE_FILENAME);
+
+  auto spin = get_lin_grid_float(RELTABLE_NA, -0.998, 0.998);
+  auto mu0 = get_lin_grid_float(RELTABLE_NMU0, 0.0, 1.0);
+
+  create_extension(fptr, "a", RELTABLE_NA, {"a"}, {"1E"});
+  write_col(fptr, TFLOAT, 1, 1, RELTABLE_NA, spin.data());
+  create_extension(fptr, "mu0", RELTABLE_NMU0, {"mu0"}, {"1E"});
+  write_col(fptr, TFLOAT, 1, 1, RELTABLE_NMU0, mu0.data());
+
+  const std::string form_ng = std::to_string(RELTABLE_NG) + "E";
+  std::vector<float> rad(RELTABLE_NR);
+  std::vector<float> gmin(RELTABLE_NR);
+  std::vector<float> gmax(RELTABLE_NR);
+  std::vector<float> trff1(RELTABLE_NG);
+  std::vector<float> trff2(RELTABLE_NG);
+  std::vector<float> cosne1(RELTABLE_NG);
+  std::vector<float> cosne2(RELTABLE_NG);
+
+  // extensions "ia_imu0", ordered by spin first (see read_relline_table)
+  for (int ia = 0; ia < RELTABLE_NA; ia++) {
+    for (int imu = 0; imu < RELTABLE_NMU0; imu++) {
+      std::string extname = std::to_string(ia + 1) + "_" + std::to_string(imu + 1);
+      create_extension(fptr, extname.c_str(), RELTABLE_NR,
+                       {"r", "gmin", "gmax", "trff1", "trff2", "cosne1", "cosne2"},
+                       {"1E", "1E", "1E", form_ng, form_ng, form_ng, form_ng});
+
+      const double sin_incl = sqrt(1.0 - mu0[imu] * mu0[imu]);
+
+      // radius is DEcreasing, from RELTABLE_MAX_R to the ISCO
+      auto rad_grid = get_log_grid(RELTABLE_NR, kerr_rms(spin[ia]), RELTABLE_MAX_R);
+      for (int ir = 0; ir < RELTABLE_NR; ir++) {
+        rad[ir] = static_cast<float>(rad_grid[RELTABLE_NR - 1 - ir]);
+        const double g0 = synthetic_gshift(rad[ir], sin_incl);
+        const double dg = 1.0 / sqrt(rad[ir]) * (0.5 * sin_incl + 0.05);
+        gmin[ir] = static_cast<float>(g0 * (1.0 - dg));
+        gmax[ir] = static_cast<float>(g0 * (1.0 + dg));
+      }
+      write_col(fptr, TFLOAT, 1, 1, RELTABLE_NR, rad.data());
+      write_col(fptr, TFLOAT, 2, 1, RELTABLE_NR, gmin.data());
+      write_col(fptr, TFLOAT, 3, 1, RELTABLE_NR, gmax.data());
+
+      for (int ir = 0; ir < RELTABLE_NR; ir++) {
+        for (int ig = 0; ig < RELTABLE_NG; ig++) {
+          const double gstar = (ig + 0.5) / RELTABLE_NG;
+          const double shape = rad[ir] * sqrt(gstar * (1.0 - gstar)) * (1.0 + 0.2 * mu0[imu]);
+          trff1[ig] = static_cast<float>(shape * (1.0 + 0.1 * gstar));
+          trff2[ig] = static_cast<float>(shape * (1.1 - 0.1 * gstar));
+          cosne1[ig] = static_cast<float>(fmin(1.0, 0.05 + 0.9 * mu0[imu] * (0.8 + 0.2 * gstar)));
+          cosne2[ig] = static_cast<float>(fmin(1.0, 0.05 + 0.9 * mu0[imu] * (1.0 - 0.2 * gstar)));
+        }
+        write_col(fptr, TFLOAT, 4, ir + 1, RELTABLE_NG, trff1.data());
+        write_col(fptr, TFLOAT, 5, ir + 1, RELTABLE_NG, trff2.data());
+        write_col(fptr, TFLOAT, 6, ir + 1, RELTABLE_NG, cosne1.data());
+        write_col(fptr, TFLOAT, 7, ir + 1, RELTABLE_NG, cosne2.data());
+      }
+    }
+  }
+
+  close_fits_file(fptr, RELTABLE_FILENAME);
+}
+
+// ------------------------- //
+// lamp post table
+// ------------------------- //
+
+static void create_lp_table(const std::string &dir) {
+
+  fitsfile *fptr = create_fits_file(dir, LPTABLE_FILENAME);
+
+  // everything is stored in one extension, with one row per spin (see read_lp_table)
+  std::vector<std::string> colnames{"a", "r", "hgrid"};
+  std::vector<std::string> colforms{"1E", std::to_string(LPTABLE_NR) + "E", std::to_string(LPTABLE_NH) + "E"};
+  for (const auto &name: {"h", "del", "del_inc"}) {
+    for (int ih = 0; ih < LPTABLE_NH; ih++) {
+      colnames.push_back(name + std::to_string(ih + 1));
+      colforms.push_back(std::to_string(LPTABLE_NR) + "E");
+    }
+  }
+  create_extension(fptr, "I_h", LPTABLE_NA, colnames, colforms);
+
+  auto spin = get_lin_grid_float(LPTABLE_NA, -0.998, 0.998);
+  write_col(fptr, TFLOAT, 1, 1, LPTABLE_NA, spin.data());
+
+  // radius is INcreasing and the same for all spins (below the ISCO for all spins)
+  auto rad_grid = get_log_grid(LPTABLE_NR, 1.0, RELTABLE_MAX_R);
+  auto h_grid = get_log_grid(LPTABLE_NH, 1.0, 1000.0);
+  std::vector<float> rad(rad_grid.begin(), rad_grid.end());
+  std::vector<float> hgrid(h_grid.begin(), h_grid.end());
+
+  std::vector<float> intens(LPTABLE_NR);
+  std::vector<float> del(LPTABLE_NR);
+  std::vector<float> del_inc(LPTABLE_NR);
+  for (int ia = 0; ia < LPTABLE_NA; ia++) {
+    write_col(fptr, TFLOAT, 2, ia + 1, LPTABLE_NR, rad.data());
+    write_col(fptr, TFLOAT, 3, ia + 1, LPTABLE_NH, hgrid.data());
+
+    for (int ih = 0; ih < LPTABLE_NH; ih++) {
+      for (int ir = 0; ir < LPTABLE_NR; ir++) {
+        // flat space lamp post, slightly modified by the spin
+        const double dist2 = rad[ir] * rad[ir] + hgrid[ih] * hgrid[ih];
+        intens[ir] = static_cast<float>(hgrid[ih] / pow(dist2, 1.5) * (1.0 + 0.1 * spin[ia]));
+        del[ir] = static_cast<float>(M_PI - atan(rad[ir] / hgrid[ih]));
+        del_inc[ir] = static_cast<float>(atan(hgrid[ih] / rad[ir]));
+      }
+      write_col(fptr, TFLOAT, 4 + ih, ia + 1, LPTABLE_NR, intens.data());
+      write_col(fptr, TFLOAT, 4 + LPTABLE_NH + ih, ia + 1, LPTABLE_NR, del.data());
+      write_col(fptr, TFLOAT, 4 + 2 * LPTABLE_NH + ih, ia + 1, LPTABLE_NR, del_inc.data());
+    }
+  }
+
+  close_fits_file(fptr, LPTABLE_FILENAME);
+}
+
+// ------------------------- //
+// return radiation table
+// ------------------------- //
+
+static void create_returnrad_table(const std::string &dir, int num_spin) {
+
+  const int nrad = RETURNRAD_TABLE_NR;
+  const int ng = RETURNRAD_TABLE_NG;
+  if (num_spin < 2 || num_spin > 99) {
+    printf(" *** error: number of spin values of the return radiation table needs to be within [2,99] \n");
+    exit(EXIT_FAILURE);
+  }
+
+  fitsfile *fptr = create_fits_file(dir, RETURNRAD_TABLE_FILENAME);
+
+  std::vector<double> spin(num_spin);
+  for (int ii = 0; ii < num_spin; ii++) {
+    spin[ii] = -0.998 + 1.996 * ii / (num_spin - 1);
+  }
+  create_extension(fptr, "SPIN", num_spin, {"a"}, {"1D"});
+  write_col(fptr, TDOUBLE, 1, 1, num_spin, spin.data());
+
+  const std::string form_nrad = std::to_string(nrad) + "D";
+  const std::string form_nrad_ng = std::to_string(nrad * ng) + "D";
+
+  std::vector<double> frac_e(nrad);
+  std::vector<double> tf_r(nrad);
+  std::vector<double> gmin(nrad);
+  std::vector<double> gmax(nrad);
+  std::vector<double> frac_g(nrad * ng);
+
+  for (int ispin = 0; ispin < num_spin; ispin++) {
+    char extname[50];
+    sprintf(extname, "FRAC%02i", ispin + 1);
+    create_extension(fptr, extname, nrad,
+                     {"rlo", "rhi", "frac_e", "tf_r", "gmin", "gmax", "frac_g", "f_ret"},
+                     {"1D", "1D", form_nrad, form_nrad, form_nrad, form_nrad, form_nrad_ng, "1D"});
+
+    // radial bins from the ISCO to the maximal radius
+    auto redges = get_log_grid(nrad + 1, kerr_rms(spin[ispin]), RELTABLE_MAX_R);
+    for (int ii = 0; ii < nrad; ii++) {
+      double f_ret = 0.3 * exp(-redges[ii] / 10.0);
+      write_col(fptr, TDOUBLE, 1, ii + 1, 1, &redges[ii]);
+      write_col(fptr, TDOUBLE, 2, ii + 1, 1, &redges[ii + 1]);
+      write_col(fptr, TDOUBLE, 8, ii + 1, 1, &f_ret);
+    }
+
+    // row: incident radius, element: emitted radius
+    for (int i_ro = 0; i_ro < nrad; i_ro++) {
+      const double r_o = 0.5 * (redges[i_ro] + redges[i_ro + 1]);
+      for (int i_re = 0; i_re < nrad; i_re++) {
+        const double r_e = 0.5 * (redges[i_re] + redges[i_re + 1]);
+        frac_e[i_re] = 0.3 * exp(-r_e / 10.0) / nrad;
+        tf_r[i_re] = 0.1 * exp(-fabs(log(r_o / r_e))) / nrad;
+
+        const double g0 = synthetic_gshift(r_o, 0.0) / synthetic_gshift(r_e, 0.0);
+        gmin[i_re] = 0.8 * g0;
+        gmax[i_re] = 1.2 * g0;
+
+        double sum = 0.0;
+        for (int ig = 0; ig < ng; ig++) {
+          const double x = (ig - 0.5 * (ng - 1)) / (0.25 * ng);
+          frac_g[i_re * ng + ig] = exp(-0.5 * x * x);
+          sum += frac_g[i_re * ng + ig];
+        }
+        for (int ig = 0; ig < ng; ig++) {
+          frac_g[i_re * ng + ig] /= sum;
+        }
+      }
+      write_col(fptr, TDOUBLE, 3, i_ro + 1, nrad, frac_e.data());
+      write_col(fptr, TDOUBLE, 4, i_ro + 1, nrad, tf_r.data());
+      write_col(fptr, TDOUBLE, 5, i_ro + 1, nrad, gmin.data());
+      write_col(fptr, TDOUBLE, 6, i_ro + 1, nrad, gmax.data());
+      write_col(fptr, TDOUBLE, 7, i_ro + 1, nrad * ng, frac_g.data());
+    }
+  }
+
+  close_fits_file(fptr, RETURNRAD_TABLE_FILENAME);
+}
+
+// ------------------------- //
+// xillver tables
+// ------------------------- //
+
+struct XillTableParameter {
+  const char *name;
+  double vmin;
+  double vmax;
+  bool log_grid;
+};
+
+/** smooth synthetic reflection spectrum [photons/bin] for the given parameters (index: PARAM_* of common.h) */
+static void synthetic_xillver_spectrum(float *spec, const std::vector<double> &ener, const double *param,
+                                       int prim_type) {
+
+  const double gam = param[PARAM_GAM];
+  const double ecut = (prim_type == PRIM_SPEC_NTHCOMP) ? 3.0 * param[PARAM_KTE] : param[PARAM_ECT];
+  const double afe = param[PARAM_AFE];
+  const double lxi = param[PARAM_LXI];
+  const double mu = cos(param[PARAM_INC] * M_PI / 180.0);
+  const double ktbb = param[PARAM_KTB];
+  const double frac_bb = param[PARAM_FRA];
+
+  const int n_ener = static_cast<int>(ener.size()) - 1;
+  for (int ii = 0; ii < n_ener; ii++) {
+    const double emean = 0.5 * (ener[ii] + ener[ii + 1]);
+    double flux = pow(emean, -gam) * exp(-emean / ecut);
+
+    // soft excess (stronger for a higher ionization), iron line and Compton hump
+    flux *= 1.0 + 0.1 * lxi * exp(-emean);
+    flux += 0.05 * afe * exp(-0.5 * pow((emean - 6.4) / 0.3, 2)) * pow(6.4, -gam);
+    flux *= 1.0 + 0.5 * exp(-0.5 * pow(log(emean / 30.0), 2));
+
+    if (ktbb > 0) {
+      flux += frac_bb * emean * emean / (exp(emean / ktbb) - 1.0 + 1e-30);
+    }
+
+    // the spectra are normalized by the density and ionization when loaded (see renorm_xill_spec)
+    flux *= pow(10, lxi) * pow(10, param[PARAM_DNS] - 15.0) * (0.5 + mu);
+    spec[ii] = static_cast<float>(flux * (ener[ii + 1] - ener[ii]));
+  }
+}
+
+static int get_global_param_index(const char *name) {
+  const char *names[] = {NAME_GAM, NAME_AFE, NAME_LXI, NAME_ECT, NAME_KTE, NAME_DNS, NAME_KTB, NAME_ACO,
+                         NAME_FRA, NAME_INC};
+  const int index[] = {PARAM_GAM, PARAM_AFE, PARAM_LXI, PARAM_ECT, PARAM_KTE, PARAM_DNS, PARAM_KTB, PARAM_ACO,
+                       PARAM_FRA, PARAM_INC};
+  for (int ii = 0; ii < N_PARAM_MAX; ii++) {
+    if (strcmp(name, names[ii]) == 0) {
+      return index[ii];
+    }
+  }
+  printf(" *** error: unknown xillver parameter %s \n", name);
+  exit(EXIT_FAILURE);
+}
+
+/**
+ * write a xillver table in the format of an Xspec table model (PARAMETERS, ENERGIES and SPECTRA extension),
+ * the inclination is required to be the last parameter
+ */
+static void create_xillver_table(const std::string &dir, const char *fname,
+                                 const std::vector<XillTableParameter> &table_params,
+                                 int prim_type, const SyntheticTableSizes &sizes) {
+
+  const int num_param = static_cast<int>(table_params.size());
+  assert(num_param == 5 || num_param == 6);
+  assert(strcmp(table_params[num_param - 1].name, NAME_INC) == 0);
+
+  // values of the parameters
+  std::vector<std::vector<float>> param_vals(num_param);
+  int max_num_vals = 0;
+  long num_spec = 1;
+  for (int ii = 0; ii < num_param; ii++) {
+    const auto &par = table_params[ii];
+    const int nval = (ii == num_param - 1) ? sizes.xill_num_incl : sizes.xill_num_values;
+    if (nval < 2) {
+      printf(" *** error: xillver table requires at least 2 values per parameter \n");
+      exit(EXIT_FAILURE);
+    }
+    if (par.log_grid) {
+      auto grid = get_log_grid(nval, par.vmin, par.vmax);
+      param_vals[ii].assign(grid.begin(), grid.end());
+    } else {
+      param_vals[ii] = get_lin_grid_float(nval, par.vmin, par.vmax);
+    }
+    max_num_vals = std::max(max_num_vals, nval);
+    num_spec *= nval;
+  }
+
+  fitsfile *fptr = create_fits_file(dir, fname);
+  int status = EXIT_SUCCESS;
+  fits_write_key_str(fptr, "HDUCLASS", "OGIP", nullptr, &status);
+  fits_write_key_str(fptr, "HDUCLAS1", "XSPEC TABLE MODEL", nullptr, &status);
+  fits_write_key_str(fptr, "MODLNAME", "xillver", nullptr, &status);
+  int addmodel = 1;
+  fits_write_key_log(fptr, "ADDMODEL", addmodel, nullptr, &status);
+  check_fits_status(status, "writing header");
+
+  // (1) PARAMETERS (needs to be the first extension, as the number of parameters is read from it)
+  create_extension(fptr, "PARAMETERS", num_param,
+                   {"NAME", "METHOD", "INITIAL", "DELTA", "MINIMUM", "BOTTOM", "TOP", "MAXIMUM", "NUMBVALS",
+                    "VALUE"},
+                   {"12A", "1J", "1E", "1E", "1E", "1E", "1E", "1E", "1J", std::to_string(max_num_vals) + "E"});
+  fits_write_key_lng(fptr, "NINTPARM", num_param, nullptr, &status);
+  fits_write_key_lng(fptr, "NADDPARM", 0, nullptr, &status);
+  check_fits_status(status, "writing PARAMETERS");
+  for (int ii = 0; ii < num_param; ii++) {
+    char *name = const_cast<char *>(table_params[ii].name);
+    int method = table_params[ii].log_grid ? 1 : 0;
+    int nval = static_cast<int>(param_vals[ii].size());
+    float vmin = param_vals[ii].front();
+    float vmax = param_vals[ii].back();
+    float initial = 0.5f * (vmin + vmax);
+    float delta = 0.01f;
+    write_col(fptr, TSTRING, 1, ii + 1, 1, &name);
+    write_col(fptr, TINT, 2, ii + 1, 1, &method);
+    write_col(fptr, TFLOAT, 3, ii + 1, 1, &initial);
+    write_col(fptr, TFLOAT, 4, ii + 1, 1, &delta);
+    for (int icol: {5, 6}) {
+      write_col(fptr, TFLOAT, icol, ii + 1, 1, &vmin);
+    }
+    for (int icol: {7, 8}) {
+      write_col(fptr, TFLOAT, icol, ii + 1, 1, &vmax);
+    }
+    write_col(fptr, TINT, 9, ii + 1, 1, &nval);
+    std::vector<float> values(max_num_vals, 0.0f);
+    std::copy(param_vals[ii].begin(), param_vals[ii].end(), values.begin());
+    write_col(fptr, TFLOAT, 10, ii + 1, max_num_vals, values.data());
+  }
+
+  // (2) ENERGIES
+  const int n_ener = sizes.xill_num_ener;
+  auto ener = get_log_grid(n_ener + 1, 0.0707, 1000.0);
+  std::vector<float> elo(ener.begin(), ener.end() - 1);
+  std::vector<float> ehi(ener.begin() + 1, ener.end());
+  create_extension(fptr, "ENERGIES", n_ener, {"ENERG_LO", "ENERG_HI"}, {"1E", "1E"});
+  write_col(fptr, TFLOAT, 1, 1, n_ener, elo.data());
+  write_col(fptr, TFLOAT, 2, 1, n_ener, ehi.data());
+
+  // (3) SPECTRA, the last parameter (inclination) is running fastest (see get_xillspec_rownum)
+  create_extension(fptr, "SPECTRA", num_spec, {"PARAMVAL", "INTPSPEC"},
+                   {std::to_string(num_param) + "E", std::to_string(n_ener) + "E"});
+
+  std::vector<int> global_index(num_param);
+  for (int ii = 0; ii < num_param; ii++) {
+    global_index[ii] = get_global_param_index(table_params[ii].name);
+  }
+
+  std::vector<float> spec(n_ener);
+  std::vector<float> paramval(num_param);
+  std::vector<int> ind(num_param, 0);
+  for (long irow = 0; irow < num_spec; irow++) {
+
+    // default values for all parameters not contained in the table
+    double param[N_PARAM_MAX] = {0.0};
+    param[PARAM_GAM] = 2.0;
+    param[PARAM_AFE] = 1.0;
+    param[PARAM_ECT] = 300.0;
+    param[PARAM_DNS] = 15.0;
+    param[PARAM_INC] = 30.0;
+
+    long rem = irow;
+    for (int ii = num_param - 1; ii >= 0; ii--) {
+      ind[ii] = static_cast<int>(rem % static_cast<long>(param_vals[ii].size()));
+      rem /= static_cast<long>(param_vals[ii].size());
+      paramval[ii] = param_vals[ii][ind[ii]];
+      param[global_index[ii]] = paramval[ii];
+    }
+
+    synthetic_xillver_spectrum(spec.data(), ener, param, prim_type);
+    write_col(fptr, TFLOAT, 1, irow + 1, num_param, paramval.data());
+    write_col(fptr, TFLOAT, 2, irow + 1, n_ener, spec.data());
+  }
+
+  close_fits_file(fptr, fname);
+}
+
+static void create_all_xillver_tables(const std::string &dir, const std::vector<std::string> &tables,
+                                      const SyntheticTableSizes &sizes) {
+
+  auto do_create = [&tables](const char *name) {
+    return tables.empty() || std::find(tables.begin(), tables.end(), name) != tables.end();
+  };
+
+  const XillTableParameter gam{NAME_GAM, 1.0, 3.4, false};
+  const XillTableParameter afe{NAME_AFE, 0.5, 10.0, false};
+  const XillTableParameter lxi{NAME_LXI, 0.0, 4.7, false};
+  const XillTableParameter incl{NAME_INC, 3.0, 87.0, false};
+
+  if (do_create("xill")) {
+    create_xillver_table(dir, XILLTABLE_FILENAME,
+                         {gam, afe, {NAME_ECT, 5.0, 1000.0, true}, lxi, incl},
+                         PRIM_SPEC_ECUT, sizes);
+  }
+  if (do_create("xillCp")) {
+    // for 6dim tables the additional dimension is the first parameter
+    create_xillver_table(dir, XILLTABLE_NTHCOMP_FILENAME,
+                         {{NAME_DNS, 15.0, 20.0, false}, gam, afe, {NAME_KTE, 1.0, 400.0, true}, lxi, incl},
+                         PRIM_SPEC_NTHCOMP, sizes);
+  }
+  if (do_create("xillNS")) {
+    create_xillver_table(dir, XILLTABLE_NS_FILENAME,
+                         {{NAME_KTB, 0.5, 10.0, false}, afe, {NAME_DNS, 15.0, 19.0, false},
+                          {NAME_LXI, 1.0, 4.7, false}, incl},
+                         PRIM_SPEC_BB, sizes);
+  }
+  if (do_create("xillCO")) {
+    create_xillver_table(dir, XILLTABLE_CO_FILENAME,
+                         {{NAME_GAM, 1.0, 2.8, false}, {NAME_ACO, 1.0, 1000.0, true}, {NAME_KTB, 0.05, 0.5, false},
+                          {NAME_FRA, 0.01, 1.0, true}, {NAME_ECT, 2.0, 1000.0, true}, incl},
+                         PRIM_SPEC_ECUT, sizes);
+  }
+}
+
+// ------------------------- //
+
+static void print_usage() {
+  printf(" usage: ./create_synthetic_tables [-o <dir>] [-t <table>] [-n <num>] [-i <num>] [-e <num>] [-s <num>] \n");
+  printf("    tables: rel, lp, rrad, xill, xillCp, xillNS, xillCO (default: all) \n");
+}
+
+int main(int argc, char *argv[]) {
+
+  std::string dir = get_relxill_table_path();
+  std::vector<std::string> tables;
+  SyntheticTableSizes sizes;
+
+  for (int ii = 1; ii < argc; ii++) {
+    if (ii + 1 >= argc) {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+    const std::string opt{argv[ii]};
+    const char *val = argv[++ii];
+    if (opt == "-o") {
+      dir = val;
+    } else if (opt == "-t") {
+      tables.emplace_back(val);
+    } else if (opt == "-n") {
+      sizes.xill_num_values = atoi(val);
+    } else if (opt == "-i") {
+      sizes.xill_num_incl = atoi(val);
+    } else if (opt == "-e") {
+      sizes.xill_num_ener = atoi(val);
+    } else if (opt == "-s") {
+      sizes.rrad_num_spin = atoi(val);
+    } else {
+      print_usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto do_create = [&tables](const char *name) {
+    return tables.empty() || std::find(tables.begin(), tables.end(), name) != tables.end();
+  };
+
+  if (do_create("rel")) {
+    create_rel_table(dir);
+  }
+  if (do_create("lp")) {
+    create_lp_table(dir);
+  }
+  if (do_create("rrad")) {
+    create_returnrad_table(dir, sizes.rrad_num_spin);
+  }
+  create_all_xillver_tables(dir, tables, sizes);
+
+  return EXIT_SUCCESS;
+}
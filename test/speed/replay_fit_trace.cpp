@@ -0,0 +1,219 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+/*
+ * Replay a fit trace (recorded with RELXILL_RECORD=<filename>, see FitTrace.h), executing the model calls
+ * in exactly the recorded order. Reports the latency distribution of the calls, separately for calls with
+ * identical parameters as the previous call of the same model, a single changed parameter (e.g., a
+ * derivative step) and several changed parameters (a step of the fit), and the statistics of the caches.
+ *
+ * usage: ./replay_fit_trace [-o <output.json>] <trace>
+ */
+
+#include "FitTrace.h"
+#include "LocalModel.h"
+#include "Profiling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+/** change of the parameters with respect to the previous call of the same model */
+enum class CallType {
+  identical,
+  single_param,
+  multi_param
+};
+
+static const char *call_type_name(CallType type) {
+  switch (type) {
+    case CallType::identical: return "identical";
+    case CallType::single_param: return "single_param";
+    case CallType::multi_param: return "multi_param";
+  }
+  return "";
+}
+
+struct LatencyStatistics {
+  std::string name;
+  size_t num_calls;
+  double total_msec;
+  double median_usec;
+  double p90_usec;
+  double p99_usec;
+  double max_usec;
+};
+
+static LatencyStatistics get_latency_statistics(const std::string &name, std::vector<double> times_usec) {
+  LatencyStatistics stats{name, times_usec.size(), 0.0, 0.0, 0.0, 0.0, 0.0};
+  if (times_usec.empty()) {
+    return stats;
+  }
+
+  std::sort(times_usec.begin(), times_usec.end());
+  const auto num = times_usec.size();
+  auto percentile = [&times_usec, num](double perc) {
+    return times_usec[static_cast<size_t>(ceil(perc * static_cast<double>(num))) - 1];
+  };
+
+  for (auto time: times_usec) {
+    stats.total_msec += time * 1e-3;
+  }
+  stats.median_usec = 0.5 * (times_usec[(num - 1) / 2] + times_usec[num / 2]);
+  stats.p90_usec = percentile(0.90);
+  stats.p99_usec = percentile(0.99);
+  stats.max_usec = times_usec[num - 1];
+  return stats;
+}
+
+static CallType get_call_type(const FitTraceCall &call, const FitTraceCall *previous) {
+  if (previous == nullptr || previous->energy_hash != call.energy_hash) {
+    return CallType::multi_param;
+  }
+  int num_changed = 0;
+  for (size_t ii = 0; ii < call.parameters.size(); ii++) {
+    if (call.parameters[ii] != previous->parameters[ii]) {
+      num_changed++;
+    }
+  }
+  if (num_changed == 0) {
+    return CallType::identical;
+  }
+  return (num_changed == 1) ? CallType::single_param : CallType::multi_param;
+}
+
+/** input flux for convolution models (powerlaw with photon index 2) */
+static void set_input_flux_conv_model(std::vector<double> &flux, const std::vector<double> &energy) {
+  for (size_t ii = 0; ii < flux.size(); ii++) {
+    flux[ii] = 1.0 / energy[ii] - 1.0 / energy[ii + 1];
+  }
+}
+
+static void write_json_output(const std::string &fname, const std::string &trace_fname,
+                              const std::vector<LatencyStatistics> &latencies) {
+
+  FILE *fp = fopen(fname.c_str(), "w");
+  if (fp == nullptr) {
+    printf(" *** error: failed to open file %s \n", fname.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(fp, "{\n  \"trace\": \"%s\",\n  \"latency\": [\n", trace_fname.c_str());
+  for (size_t ii = 0; ii < latencies.size(); ii++) {
+    const auto &lat = latencies[ii];
+    fprintf(fp, "    {\"name\": \"%s\", \"num_calls\": %zu, \"total_msec\": %.3f, \"median_usec\": %.3f, "
+                "\"p90_usec\": %.3f, \"p99_usec\": %.3f, \"max_usec\": %.3f}%s\n",
+            lat.name.c_str(), lat.num_calls, lat.total_msec, lat.median_usec, lat.p90_usec, lat.p99_usec,
+            lat.max_usec, (ii + 1 < latencies.size()) ? "," : "");
+  }
+  fprintf(fp, "  ],\n  \"caches\": [\n");
+  for (int ii = 0; ii < PROF_NUM_CACHES; ii++) {
+    const auto cache = static_cast<prof_cache>(ii);
+    fprintf(fp, "    {\"name\": \"%s\", \"hits\": %lld, \"misses\": %lld}%s\n", get_profiling_cache_name(cache),
+            get_profiling_cache_hits(cache), get_profiling_cache_misses(cache),
+            (ii + 1 < PROF_NUM_CACHES) ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+  fclose(fp);
+}
+
+int main(int argc, char *argv[]) {
+
+  std::string json_fname{};
+  std::string trace_fname{};
+  for (int ii = 1; ii < argc; ii++) {
+    if (strcmp(argv[ii], "-o") == 0 && ii + 1 < argc) {
+      json_fname = argv[++ii];
+    } else {
+      trace_fname = argv[ii];
+    }
+  }
+  if (trace_fname.empty()) {
+    printf(" usage: ./replay_fit_trace [-o <output.json>] <trace> \n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<FitTraceCall> calls;
+  try {
+    calls = read_fit_trace(trace_fname);
+  } catch (std::runtime_error &e) {
+    printf(" *** error: %s \n", e.what());
+    return EXIT_FAILURE;
+  }
+  printf(" replaying %zu calls of %s \n", calls.size(), trace_fname.c_str());
+
+  // the replay itself must not be recorded again
+  stop_fit_recording();
+  set_profiling_enabled(1);
+  reset_profiling();
+
+  std::map<std::string, std::vector<double>> times_usec;
+  std::map<std::string, const FitTraceCall *> previous_call;
+  std::vector<double> flux;
+
+  for (const auto &call: calls) {
+    ModelName model_name;
+    try {
+      model_name = ModelDatabase::instance().model_name(call.model_name);
+    } catch (ModelNotFound &e) {
+      printf(" *** error: model %s of the trace is not known \n", call.model_name.c_str());
+      return EXIT_FAILURE;
+    }
+
+    flux.assign(call.num_flux_bins(), 0.0);
+    if (ModelDatabase::instance().model_info(model_name).type() == T_Model::Conv) {
+      set_input_flux_conv_model(flux, *call.energy);
+    }
+
+    auto tstart = std::chrono::steady_clock::now();
+    xspec_C_wrapper_eval_model(model_name, call.parameters.data(), flux.data(), call.num_flux_bins(),
+                               call.energy->data());
+    auto tend = std::chrono::steady_clock::now();
+    const double time = std::chrono::duration<double, std::micro>(tend - tstart).count();
+
+    const auto prev = previous_call.find(call.model_name);
+    const auto type = get_call_type(call, (prev == previous_call.end()) ? nullptr : prev->second);
+    previous_call[call.model_name] = &call;
+
+    times_usec["all"].push_back(time);
+    times_usec[call.model_name].push_back(time);
+    times_usec[call_type_name(type)].push_back(time);
+  }
+
+  std::vector<LatencyStatistics> latencies;
+  printf("\n   %-20s %10s %12s %12s %12s %12s %12s\n", "calls", "number", "total [ms]", "median [us]", "p90 [us]",
+         "p99 [us]", "max [us]");
+  for (const auto &times: times_usec) {
+    auto lat = get_latency_statistics(times.first, times.second);
+    printf("   %-20s %10zu %12.3f %12.1f %12.1f %12.1f %12.1f\n", lat.name.c_str(), lat.num_calls, lat.total_msec,
+           lat.median_usec, lat.p90_usec, lat.p99_usec, lat.max_usec);
+    latencies.push_back(lat);
+  }
+
+  print_profiling_report();
+
+  if (!json_fname.empty()) {
+    write_json_output(json_fname, trace_fname, latencies);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -40,10 +40,10 @@ TEST_CASE(" Spectrum Class", "[basic]") {
   XspecSpectrum spec(test_spec.energy, test_spec.flux, test_spec.n_flux_bins);
 
   DYNAMIC_SECTION(" test initial array without operations ") {
-    REQUIRE(spec.energy);
+    REQUIRE(spec.energy());
     REQUIRE(spec.flux);
 
-    REQUIRE(spec.energy);
+    REQUIRE(spec.energy());
     REQUIRE(spec.flux);
   }
 
@@ -59,19 +59,39 @@ TEST_CASE(" Spectrum Class:  shifting of the energy grid ") {
   SimpleSpec test_spec{};
   XspecSpectrum spec(test_spec.energy, test_spec.flux, test_spec.n_flux_bins);
 
-  double ener0 = spec.energy[0];
+  double ener0 = spec.energy()[0];
 
   DYNAMIC_SECTION(" shifting by line energy produces correct energies? ") {
     spec.shift_energy_grid_1keV(0.5);
-    double shifted_ener = spec.energy[0];
+    double shifted_ener = spec.energy()[0];
     REQUIRE(shifted_ener == ener0 * 2);
   }
 
   DYNAMIC_SECTION(" shifting by z correct energies? ") {
     spec.shift_energy_grid_1keV(1.0);
     spec.shift_energy_grid_redshift(0.5);
-    double shifted_ener = spec.energy[0];
+    double shifted_ener = spec.energy()[0];
     REQUIRE(shifted_ener == ener0 * 1.5);
   }
 
 }
+
+TEST_CASE(" Spectrum Class:  the energy grid of the caller is not modified and identified by its values ") {
+
+  SimpleSpec test_spec{};
+  XspecSpectrum spec(test_spec.energy, test_spec.flux, test_spec.n_flux_bins);
+
+  // no shift: the grid of the caller is used directly
+  REQUIRE(spec.energy() == test_spec.energy);
+  const auto fingerprint = spec.energy_fingerprint();
+
+  // the same values in a different array give the same fingerprint
+  SimpleSpec other_spec{};
+  XspecSpectrum spec_same_grid(other_spec.energy, other_spec.flux, other_spec.n_flux_bins);
+  REQUIRE(spec_same_grid.energy_fingerprint() == fingerprint);
+
+  spec.shift_energy_grid_redshift(0.5);
+  REQUIRE(spec.energy()[1] == test_spec.energy[1] * 1.5);
+  REQUIRE(test_spec.energy[1] == 1.0);
+  REQUIRE(spec.energy_fingerprint() != fingerprint);
+}
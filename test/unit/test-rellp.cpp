@@ -62,12 +62,12 @@ TEST_CASE(" beta>0 of a lamp post changes the primary spectrum", "[beta]") {
   lmod.set_par(XPar::beta, 0.66);
   lmod.eval_model(spec);
 
-  double sum0 = calcSumInEnergyBand(spec.flux, spec.num_flux_bins(), spec.energy, 1, 10);
+  double sum0 = calcSumInEnergyBand(spec.flux, spec.num_flux_bins(), spec.energy(), 1, 10);
 
   lmod.set_par(XPar::beta, 0.0);
   lmod.eval_model(spec);
 
-  double sum1 = calcSumInEnergyBand(spec.flux, spec.num_flux_bins(), spec.energy, 1, 10);
+  double sum1 = calcSumInEnergyBand(spec.flux, spec.num_flux_bins(), spec.energy(), 1, 10);
 
   REQUIRE(sum0 > sum1);
 
@@ -103,6 +103,141 @@ TEST_CASE(" normalization of LP primary spectrum", "[beta]") {
 
 }
 
+TEST_CASE(" lamp post emissivity is re-used for a different inclination", "[rellp]") {
+
+  int status = EXIT_SUCCESS;
+
+  LocalModel local_model{ModelName::relxilllp};
+  local_model.set_par(XPar::h, 7.0);
+  relParam *rel_param = local_model.get_rel_params();
+  RelSysPar *sys_par = get_system_parameters(rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  const std::vector<double> emis(sys_par->emis->emis, sys_par->emis->emis + sys_par->emis->nr);
+  const double refl_frac = sys_par->emis->photon_fate_fractions->refl_frac;
+
+  // a different inclination does not change the emissivity, which is therefore taken from the cache
+  const long long hits = get_profiling_cache_hits(PROF_CACHE_LP_EMIS);
+  rel_param->incl += 0.1;
+  sys_par = get_system_parameters(rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  REQUIRE(sys_par->emis->nr == static_cast<int>(emis.size()));
+  for (int ii = 0; ii < sys_par->emis->nr; ii++) {
+    REQUIRE(sys_par->emis->emis[ii] == emis[ii]);
+  }
+  REQUIRE(sys_par->emis->photon_fate_fractions->refl_frac == refl_frac);
+  if (is_profiling_enabled()) {
+    REQUIRE(get_profiling_cache_hits(PROF_CACHE_LP_EMIS) == hits + 1);
+  }
+
+  // but the height does
+  rel_param->height = 8.0;
+  sys_par = get_system_parameters(rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  REQUIRE(sys_par->emis->photon_fate_fractions->refl_frac != refl_frac);
+
+  delete rel_param;
+}
+
+TEST_CASE(" slices of the extended jet are re-used for a different htop", "[rellp]") {
+
+  int status = EXIT_SUCCESS;
+
+  LocalModel local_model{ModelName::relxilllp};
+  relParam *rel_param = local_model.get_rel_params();
+  rel_param->height = 3.0;
+  rel_param->htop = 10.0;
+  REQUIRE(modelLampPostPointsource(rel_param) == 0);
+
+  extPrimSource *source = getExtendedJetGeom(rel_param, &status);
+  RelSysPar *sys_par = get_system_parameters(rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  const double refl_frac = sys_par->emis->photon_fate_fractions->refl_frac;
+  REQUIRE(refl_frac > 0);
+
+  // all boundaries of the slices in between the base and the top do not change with htop
+  rel_param->htop = 20.0;
+  extPrimSource *source_htop = getExtendedJetGeom(rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  REQUIRE(source_htop->nh > source->nh);
+  REQUIRE(source_htop->heightArr[0] == source->heightArr[0]);
+  REQUIRE(source_htop->heightArr[source_htop->nh] == rel_param->htop);
+  for (int ii = 1; ii < source->nh; ii++) {
+    REQUIRE(source_htop->heightArr[ii] == source->heightArr[ii]);
+  }
+  for (int ii = 0; ii < source_htop->nh; ii++) {
+    REQUIRE(source_htop->heightArr[ii] < source_htop->heightArr[ii + 1]);
+  }
+
+  // therefore their emissivity is taken from the cache
+  const long long hits = get_profiling_cache_hits(PROF_CACHE_LP_EMIS);
+  sys_par = get_system_parameters(rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  REQUIRE(sys_par->emis->photon_fate_fractions->refl_frac != refl_frac);
+  if (is_profiling_enabled()) {
+    REQUIRE(get_profiling_cache_hits(PROF_CACHE_LP_EMIS) == hits + source->nh - 1);
+  }
+
+  free_extendedPrimarySource(source);
+  free_extendedPrimarySource(source_htop);
+  delete rel_param;
+}
+
+TEST_CASE(" emissivity of the extended jet agrees with a dense integration over its height", "[rellp]") {
+
+  int status = EXIT_SUCCESS;
+
+  LocalModel local_model{ModelName::relxilllp};
+  relParam *rel_param = local_model.get_rel_params();
+  rel_param->height = 3.0;
+  rel_param->htop = 10.0;
+  rel_param->beta = 0.0;
+  rel_param->rin = 2.0;
+  rel_param->rout = 400.0;
+
+  const int nr = 100;
+  std::vector<double> re(nr);
+  for (int ii = 0; ii < nr; ii++) {
+    re[ii] = rel_param->rout * pow(rel_param->rin / rel_param->rout, ii / (nr - 1.0));
+  }
+
+  emisProfile *emis_ext = new_emisProfile(re.data(), nr, &status);
+  get_emis_jet(emis_ext, rel_param, &status);
+
+  // baseline: point sources in the middle of 500 logarithmic slices between base and top
+  const int nh_dense = 500;
+  std::vector<double> height_dense(nh_dense + 1);
+  get_log_grid(height_dense.data(), nh_dense + 1, rel_param->height, rel_param->htop);
+
+  std::vector<double> emis_dense(nr, 0.0);
+  double refl_frac_dense = 0.0;
+  relParam param_point = *rel_param;
+  param_point.htop = 0.0;
+  for (int kk = 0; kk < nh_dense; kk++) {
+    param_point.height = 0.5 * (height_dense[kk] + height_dense[kk + 1]);
+    const double weight = (height_dense[kk + 1] - height_dense[kk]) / (rel_param->htop - rel_param->height);
+
+    emisProfile *emis_point = new_emisProfile(re.data(), nr, &status);
+    get_emis_jet(emis_point, &param_point, &status);
+    REQUIRE(status == EXIT_SUCCESS);
+    for (int ii = 0; ii < nr; ii++) {
+      emis_dense[ii] += emis_point->emis[ii] * weight;
+    }
+    refl_frac_dense += emis_point->photon_fate_fractions->refl_frac * weight;
+    free_emisProfile(emis_point);
+  }
+  REQUIRE(status == EXIT_SUCCESS);
+
+  // the fixed grid of NHBINS_PER_DECADE_EXTENDED_SOURCE slices per decade is required to be precise to 0.5%
+  const double prec = 5e-3;
+  for (int ii = 0; ii < nr; ii++) {
+    REQUIRE(emis_ext->emis[ii] == Catch::Approx(emis_dense[ii]).epsilon(prec));
+  }
+  REQUIRE(emis_ext->photon_fate_fractions->refl_frac == Catch::Approx(refl_frac_dense).epsilon(prec));
+
+  free_emisProfile(emis_ext);
+  delete rel_param;
+}
+
 TEST_CASE(" Change of Ecut on the disk with beta>0  ", "[beta]") {
 
   int status = EXIT_SUCCESS;
@@ -18,8 +18,11 @@
 
 #include "catch2/catch_amalgamated.hpp"
 #include "LocalModel.h"
+#include "Profiling.h"
 #include "common-functions.h"
 
+#include <vector>
+
 extern "C" {
 #include "writeOutfiles.h"
 }
@@ -39,6 +42,50 @@ TEST_CASE(" compare standard relline profile with reference flux "){
 
 }
 
+TEST_CASE(" relline profile on the internal g-grid agrees with the direct calculation") {
+
+  int status = EXIT_SUCCESS;
+  LocalModel lmod(ModelName::relline);
+  relParam *rel_param = lmod.get_rel_params();
+
+  // grid of a CCD-like resolution, shifted for a line at 6.4keV
+  DefaultSpec default_spec(1.0, 10.0, 500);
+  XspecSpectrum spec = default_spec.get_xspec_spectrum();
+  spec.shift_energy_grid_1keV(6.4);
+
+  std::vector<double> flux(spec.num_flux_bins());
+  relline_profile(spec.energy(), flux.data(), spec.num_flux_bins(), rel_param, &status);
+  relline_spec_multizone *rel_profile = relbase(spec.energy(), spec.num_flux_bins(), rel_param, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+
+  const double sum = calcSum(flux.data(), spec.num_flux_bins());
+  REQUIRE(sum == Catch::Approx(calcSum(rel_profile->flux[0], spec.num_flux_bins())));
+
+  double sum_band = calcSumInEnergyBand(flux.data(), spec.num_flux_bins(), spec.energy(), 0.8, 1.0);
+  double sum_band_direct =
+      calcSumInEnergyBand(rel_profile->flux[0], spec.num_flux_bins(), spec.energy(), 0.8, 1.0);
+  REQUIRE(fabs(sum_band - sum_band_direct) < 1e-2 * sum);
+
+  // each bin agrees with the direct profile on the shifted grid (5% of the bin, or 0.1% of the peak for
+  // bins in the wings of the line)
+  double max_flux = 0.0;
+  for (int ii = 0; ii < spec.num_flux_bins(); ii++) {
+    max_flux = fmax(max_flux, rel_profile->flux[0][ii]);
+  }
+  for (int ii = 0; ii < spec.num_flux_bins(); ii++) {
+    REQUIRE(fabs(flux[ii] - rel_profile->flux[0][ii]) <= 0.05 * rel_profile->flux[0][ii] + 1e-3 * max_flux);
+  }
+
+  // the profile for a different line energy re-uses the cached profile on the internal grid
+  set_profiling_enabled(1);
+  reset_profiling();
+  spec.shift_energy_grid_1keV(6.0 / 6.4);
+  relline_profile(spec.energy(), flux.data(), spec.num_flux_bins(), rel_param, &status);
+  REQUIRE(get_profiling_cache_misses(PROF_CACHE_RELBASE) == 0);
+  set_profiling_enabled(0);
+
+  delete rel_param;
+}
 
 /*
 TEST_CASE(" compare standard xillver evaluation with reference flux") {
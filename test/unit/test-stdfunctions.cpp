@@ -21,6 +21,12 @@
 #include "common-functions.h"
 #include "Relbase.h"
 #include "Relphysics.h"
+#include "RebinOperator.h"
+#include "Buffer2D.h"
+#include "Profiling.h"
+#include "XspecSpectrum.h"
+
+#include <vector>
 
 extern "C" {
 #include "relutility.h"
@@ -151,6 +157,122 @@ TEST_CASE("rebin spectrum", "[basic]") {
   }
 }
 
+TEST_CASE(" rebinning operator agrees with rebin_spectrum", "[basic]") {
+
+  const int n0 = 500;
+  const int n = 300;
+  std::vector<double> ener0(n0 + 1);
+  std::vector<double> ener(n + 1);
+  DefaultSpec::set_log_grid(ener0.data(), n0 + 1, 0.1, 100.0);
+  DefaultSpec::set_log_grid(ener.data(), n + 1, 0.05, 50.0);
+
+  std::vector<double> val0(n0);
+  std::vector<double> val0_other(n0);
+  for (int ii = 0; ii < n0; ii++) {
+    val0[ii] = 1.0 / ener0[ii] - 1.0 / ener0[ii + 1];
+    val0_other[ii] = 1.0 + ii % 7;
+  }
+
+  std::vector<double> val_ref(n);
+  std::vector<double> val_ref_other(n);
+  rebin_spectrum(ener.data(), val_ref.data(), n, ener0.data(), val0.data(), n0);
+  rebin_spectrum(ener.data(), val_ref_other.data(), n, ener0.data(), val0_other.data(), n0);
+
+  auto rebin_op = get_rebin_operator(ener.data(), n, ener0.data(), n0);
+  REQUIRE(rebin_op == get_rebin_operator(ener.data(), n, ener0.data(), n0));  // taken from the cache
+
+  // several spectra at once
+  std::vector<double> val(n);
+  std::vector<double> val_other(n);
+  const double *inp[] = {val0.data(), val0_other.data()};
+  double *out[] = {val.data(), val_other.data()};
+  rebin_op->apply(inp, out, 2);
+
+  for (int ii = 0; ii < n; ii++) {
+    REQUIRE(fabs(val[ii] - val_ref[ii]) <= 1e-12 * fabs(val_ref[ii]));
+    REQUIRE(fabs(val_other[ii] - val_ref_other[ii]) <= 1e-12 * fabs(val_ref_other[ii]));
+  }
+
+  // a changed grid must not use the cached operator
+  ener[n / 2] *= 1.001;
+  REQUIRE(rebin_op != get_rebin_operator(ener.data(), n, ener0.data(), n0));
+}
+
+TEST_CASE(" index lookup on uniform grids agrees with binary_search", "[basic]") {
+
+  const int n = 1001;
+  std::vector<double> log_grid(n);
+  std::vector<double> lin_grid(n);
+  std::vector<double> arb_grid(n);
+  get_log_grid(log_grid.data(), n, 0.001, 1000.0);
+  get_lin_grid(lin_grid.data(), n, 0.01, 0.99);
+  for (int ii = 0; ii < n; ii++) {
+    arb_grid[ii] = ii * ii + 0.5;
+  }
+
+  gridDescriptor log_desc;
+  gridDescriptor lin_desc;
+  gridDescriptor arb_desc;
+  set_grid_descriptor(&log_desc, log_grid.data(), n);
+  set_grid_descriptor(&lin_desc, lin_grid.data(), n);
+  set_grid_descriptor(&arb_desc, arb_grid.data(), n);
+  REQUIRE(log_desc.type == GRID_LOG_UNIFORM);
+  REQUIRE(lin_desc.type == GRID_LIN_UNIFORM);
+  REQUIRE(arb_desc.type == GRID_ARBITRARY);
+
+  for (const auto &desc: {log_desc, lin_desc, arb_desc}) {
+    const double *arr = desc.val;
+    // values outside the grid, exactly on the grid points and in between
+    std::vector<double> values{0.5 * arr[0], arr[n - 1], 2 * arr[n - 1]};
+    for (int ii = 0; ii < n - 1; ii++) {
+      values.push_back(arr[ii]);
+      values.push_back(0.3 * arr[ii] + 0.7 * arr[ii + 1]);
+    }
+    for (auto val: values) {
+      REQUIRE(grid_search(&desc, val) == binary_search(arr, n, val));
+    }
+  }
+}
+
+TEST_CASE(" 2D arrays are aligned and re-used from the memory pool", "[basic]") {
+
+  clear_buffer_pool();
+  int status = EXIT_SUCCESS;
+
+  double **arr = new_buffer_2d(5, 13, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  for (int ii = 0; ii < 5; ii++) {
+    REQUIRE(reinterpret_cast<uintptr_t>(arr[ii]) % BUFFER_ALIGNMENT == 0);
+    for (int jj = 0; jj < 13; jj++) {
+      arr[ii][jj] = ii * 100 + jj;
+    }
+  }
+  REQUIRE(arr[4][12] == 412);
+  free_buffer_2d(arr);
+  REQUIRE(get_buffer_pool_num_blocks() == 1);
+
+  // the same (or a slightly smaller) array is taken from the pool
+  const long long hits = get_profiling_cache_hits(PROF_CACHE_BUFFER_POOL);
+  double **arr_reused = new_buffer_2d(5, 12, &status);
+  REQUIRE(arr_reused == arr);
+  REQUIRE(get_buffer_pool_num_blocks() == 0);
+  if (is_profiling_enabled()) {
+    REQUIRE(get_profiling_cache_hits(PROF_CACHE_BUFFER_POOL) == hits + 1);
+  }
+
+  {
+    Buffer2D buffer{3, 4};
+    buffer.fill(1.0);
+    REQUIRE(buffer[2][3] == 1.0);
+    REQUIRE(buffer.rows() != arr_reused);
+  }
+  REQUIRE(get_buffer_pool_num_blocks() == 1);
+
+  free_buffer_2d(arr_reused);
+  clear_buffer_pool();
+  REQUIRE(get_buffer_pool_num_blocks() == 0);
+}
+
 TEST_CASE(" rebin mean flux ", "[basic]") {
 
   int status = EXIT_SUCCESS;
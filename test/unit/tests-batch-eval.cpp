@@ -0,0 +1,330 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "catch2/catch_amalgamated.hpp"
+#include "LocalModel.h"
+#include "ThreadPool.h"
+#include "FitTrace.h"
+#include "xspec_wrapper_lmodels.h"
+#include "common-functions.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * get a batch of parameter vectors (default values), varying "param" linearly from val_lo to val_hi
+ */
+static std::vector<double> get_param_batch(ModelName model_name, int num_batch, XPar param,
+                                           double val_lo, double val_hi) {
+
+  auto default_values = ModelDatabase::instance().get_default_values_array(model_name);
+  auto parnames = ModelDatabase::instance().param_list(model_name).get_parnames();
+  const size_t ipar = std::find(parnames.begin(), parnames.end(), param) - parnames.begin();
+  REQUIRE(ipar < parnames.size());
+
+  std::vector<double> batch;
+  for (int ii = 0; ii < num_batch; ii++) {
+    default_values[ipar] = val_lo + (val_hi - val_lo) * ii / (num_batch - 1);
+    batch.insert(batch.end(), default_values.begin(), default_values.end());
+  }
+  return batch;
+}
+
+
+TEST_CASE(" Thread pool executes every task exactly once", "[batch]") {
+
+  const size_t num_tasks = 1000;
+
+  for (int num_workers: {1, 3, 8}) {
+    ThreadPool pool{num_workers};
+    REQUIRE(pool.num_workers() == num_workers);
+
+    std::vector<int> count(num_tasks, 0);
+    pool.parallel_for(num_tasks, [&](size_t ii) {
+      count[ii]++;
+    });
+
+    for (size_t ii = 0; ii < num_tasks; ii++) {
+      REQUIRE(count[ii] == 1);
+    }
+  }
+
+}
+
+TEST_CASE(" Thread pool handles nested calls and exceptions", "[batch]") {
+
+  ThreadPool pool{4};
+
+  // nested calls are executed serially by the worker
+  std::vector<double> result(16 * 16, 0.0);
+  pool.parallel_for(16, [&](size_t ii) {
+    pool.parallel_for(16, [&](size_t jj) {
+      result[ii * 16 + jj] = static_cast<double>(ii * 16 + jj);
+    });
+  });
+  for (size_t ii = 0; ii < result.size(); ii++) {
+    REQUIRE(result[ii] == static_cast<double>(ii));
+  }
+
+  // exceptions are passed to the calling thread
+  REQUIRE_THROWS_AS(pool.parallel_for(100, [](size_t ii) {
+    if (ii == 42) {
+      throw std::runtime_error("task failed");
+    }
+  }), std::runtime_error);
+
+  // pool can be used again after an exception
+  int sum = 0;
+  std::mutex sum_mutex;
+  pool.parallel_for(10, [&](size_t ii) {
+    std::lock_guard<std::mutex> lock(sum_mutex);
+    sum += static_cast<int>(ii);
+  });
+  REQUIRE(sum == 45);
+
+}
+
+static void test_batch_identical_to_serial(ModelName model_name, XPar param, double val_lo, double val_hi) {
+
+  const int num_batch = 12;
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+  const size_t num_params = ModelDatabase::instance().param_list(model_name).num_params();
+
+  auto batch_params = get_param_batch(model_name, num_batch, param, val_lo, val_hi);
+
+  std::vector<double> flux_batch(num_batch * nbins, 0.0);
+  eval_model_batch(model_name, batch_params.data(), num_batch, flux_batch.data(), nbins, default_spec.energy);
+
+  std::vector<double> flux_serial(nbins, 0.0);
+  for (int ii = 0; ii < num_batch; ii++) {
+    xspec_C_wrapper_eval_model(model_name, &batch_params[ii * num_params], flux_serial.data(), nbins,
+                               default_spec.energy);
+
+    for (int jj = 0; jj < nbins; jj++) {
+      REQUIRE(flux_batch[ii * nbins + jj] == Catch::Approx(flux_serial[jj]).epsilon(1e-6));
+    }
+  }
+
+}
+
+TEST_CASE(" Batch evaluation gives the same result as the serial evaluation", "[batch]") {
+
+  SECTION(" - relline") {
+    test_batch_identical_to_serial(ModelName::relline, XPar::a, 0.0, 0.998);
+  }
+
+  SECTION(" - relxilllp") {
+    test_batch_identical_to_serial(ModelName::relxilllp, XPar::h, 3.0, 30.0);
+  }
+
+  SECTION(" - xillver") {
+    test_batch_identical_to_serial(ModelName::xillver, XPar::logxi, 0.0, 4.0);
+  }
+
+}
+
+TEST_CASE(" Batch evaluation groups parameter vectors by the cached stages", "[batch]") {
+
+  const auto model_name = ModelName::relxill;
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+
+  // 4 different values of logxi (i.e., only the xillver parameters change), each used 3 times
+  auto batch_logxi = get_param_batch(model_name, 4, XPar::logxi, 0.0, 3.0);
+  std::vector<double> batch_params;
+  for (int ii = 0; ii < 3; ii++) {
+    batch_params.insert(batch_params.end(), batch_logxi.begin(), batch_logxi.end());
+  }
+  const int num_batch = 12;
+
+  std::vector<double> flux_batch(num_batch * nbins, 0.0);
+  BatchStatistics stats;
+  eval_model_batch(model_name, batch_params.data(), num_batch, flux_batch.data(), nbins, default_spec.energy,
+                   &stats);
+
+  // all vectors share the relativistic parameters, but are still distributed on all workers
+  const int num_workers = ThreadPool::instance().num_workers();
+  const int max_task_size = (num_batch + num_workers - 1) / num_workers;
+  REQUIRE(stats.num_evaluations == num_batch);
+  REQUIRE(stats.num_groups == 1);
+  REQUIRE(stats.num_tasks >= (num_batch + max_task_size - 1) / max_task_size);
+  REQUIRE(stats.num_rel_shared == num_batch - stats.num_tasks);
+
+  // a single worker evaluates the 4 clusters of identical logxi one after the other
+  auto tasks = get_cache_affinity_tasks(model_name, batch_params.data(), num_batch, 1, stats);
+  REQUIRE(tasks.size() == 1);
+  REQUIRE(stats.num_rel_shared == num_batch - 1);
+  REQUIRE(stats.num_xill_shared == num_batch - 4);
+
+  // for 4 workers, each one evaluates one of the clusters
+  tasks = get_cache_affinity_tasks(model_name, batch_params.data(), num_batch, 4, stats);
+  REQUIRE(tasks.size() == 4);
+  for (const auto &task: tasks) {
+    REQUIRE(task.size() == 3);
+    for (auto ii: task) {
+      REQUIRE(ii % 4 == task[0] % 4);
+    }
+  }
+  REQUIRE(stats.num_rel_shared == num_batch - 4);
+  REQUIRE(stats.num_xill_shared == num_batch - 4);
+
+  // for more workers than vectors, every vector is a task
+  tasks = get_cache_affinity_tasks(model_name, batch_params.data(), num_batch, 2 * num_batch, stats);
+  REQUIRE(tasks.size() == static_cast<size_t>(num_batch));
+
+  // changing the spin: every vector is in its own group
+  auto batch_spin = get_param_batch(model_name, num_batch, XPar::a, 0.0, 0.99);
+  eval_model_batch(model_name, batch_spin.data(), num_batch, flux_batch.data(), nbins, default_spec.energy,
+                   &stats);
+
+  REQUIRE(stats.num_groups == num_batch);
+  REQUIRE(stats.num_rel_shared == 0);
+  REQUIRE(stats.num_xill_shared == 0);
+
+  // changing Rin: the vectors are in different groups, but share the xillver spectra
+  auto batch_rin = get_param_batch(model_name, 4, XPar::rin, -1.0, -3.0);
+  tasks = get_cache_affinity_tasks(model_name, batch_rin.data(), 4, 1, stats);
+  REQUIRE(stats.num_groups == 4);
+  REQUIRE(stats.num_rel_shared == 0);
+  REQUIRE(stats.num_xill_shared == 3);
+
+}
+
+TEST_CASE(" Batch evaluation records every call of the batch", "[batch]") {
+
+  const ModelName model_name = ModelName::relline;
+  const int num_batch = 4;
+  const size_t num_params = ModelDatabase::instance().param_list(model_name).num_params();
+  auto batch = get_param_batch(model_name, num_batch, XPar::a, 0.0, 0.998);
+
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+  std::vector<double> flux(num_batch * nbins);
+
+  // the calls are recorded in the order of the batch, as for the serial evaluation
+  const char *fname = "test-fit-trace-batch.bin";
+  start_fit_recording(fname);
+  eval_model_batch(model_name, batch.data(), num_batch, flux.data(), nbins, default_spec.energy);
+  stop_fit_recording();
+
+  auto calls = read_fit_trace(fname);
+  REQUIRE(calls.size() == static_cast<size_t>(num_batch));
+  for (size_t ii = 0; ii < calls.size(); ii++) {
+    REQUIRE(calls[ii].model_name == "relline");
+    REQUIRE(calls[ii].parameters == std::vector<double>(batch.begin() + ii * num_params,
+                                                        batch.begin() + (ii + 1) * num_params));
+  }
+
+}
+
+TEST_CASE(" Gradient sweep gives the same spectra as the serial evaluation", "[batch]") {
+
+  const auto model_name = ModelName::relxill;
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+
+  auto base_values = ModelDatabase::instance().get_default_values_array(model_name);
+  auto parnames = ModelDatabase::instance().param_list(model_name).get_parnames();
+  const size_t num_params = parnames.size();
+
+  std::vector<double> step_sizes(num_params, 0.0);
+  for (auto par: {XPar::a, XPar::logxi, XPar::incl, XPar::refl_frac}) {
+    const size_t ipar = std::find(parnames.begin(), parnames.end(), par) - parnames.begin();
+    REQUIRE(ipar < num_params);
+    step_sizes[ipar] = (par == XPar::a) ? -1e-3 : 1e-2;
+  }
+
+  std::vector<double> flux_sweep((num_params + 1) * nbins, 0.0);
+  eval_model_gradient_sweep(model_name, base_values.data(), step_sizes.data(), flux_sweep.data(), nbins,
+                            default_spec.energy);
+
+  std::vector<double> flux_serial(nbins, 0.0);
+  for (size_t ii = 0; ii <= num_params; ii++) {
+    auto param_values = base_values;
+    if (ii > 0) {
+      param_values[ii - 1] += step_sizes[ii - 1];
+    }
+    xspec_C_wrapper_eval_model(model_name, param_values.data(), flux_serial.data(), nbins, default_spec.energy);
+
+    for (int jj = 0; jj < nbins; jj++) {
+      REQUIRE(flux_sweep[ii * nbins + jj] == Catch::Approx(flux_serial[jj]).epsilon(1e-6));
+    }
+  }
+
+}
+
+TEST_CASE(" Gradient sweep resolves steps below the cache limit", "[batch]") {
+
+  const auto model_name = ModelName::relxill;
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+
+  auto base_values = ModelDatabase::instance().get_default_values_array(model_name);
+  auto parnames = ModelDatabase::instance().param_list(model_name).get_parnames();
+  const size_t num_params = parnames.size();
+  const size_t ipar = std::find(parnames.begin(), parnames.end(), XPar::logxi) - parnames.begin();
+
+  std::vector<double> step_sizes(num_params, 0.0);
+  step_sizes[ipar] = 1e-9;
+
+  std::vector<double> flux_sweep((num_params + 1) * nbins, 0.0);
+  eval_model_gradient_sweep(model_name, base_values.data(), step_sizes.data(), flux_sweep.data(), nbins,
+                            default_spec.energy);
+
+  int num_different = 0;
+  for (int jj = 0; jj < nbins; jj++) {
+    if (flux_sweep[(ipar + 1) * nbins + jj] != flux_sweep[jj]) {
+      num_different++;
+    }
+  }
+  REQUIRE(num_different > 0);
+
+  // parameters without a step return the base spectrum
+  for (int jj = 0; jj < nbins; jj++) {
+    REQUIRE(flux_sweep[nbins + jj] == flux_sweep[jj]);
+  }
+
+}
+
+TEST_CASE(" Parallel convolution of the zones is independent of the number of threads", "[batch]") {
+
+  const auto model_name = ModelName::relxilllpion;
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+
+  auto batch_params = get_param_batch(model_name, 2, XPar::h, 3.0, 10.0);
+  const size_t num_params = batch_params.size() / 2;
+
+  // within a batch, the zones are convolved serially by the worker
+  std::vector<double> flux_batch(2 * nbins, 0.0);
+  eval_model_batch(model_name, batch_params.data(), 2, flux_batch.data(), nbins, default_spec.energy);
+
+  // called directly, the zones are convolved in parallel
+  std::vector<double> flux_parallel(nbins, 0.0);
+  for (int ii = 0; ii < 2; ii++) {
+    xspec_C_wrapper_eval_model(model_name, &batch_params[ii * num_params], flux_parallel.data(), nbins,
+                               default_spec.energy);
+    for (int jj = 0; jj < nbins; jj++) {
+      REQUIRE(flux_batch[ii * nbins + jj] == Catch::Approx(flux_parallel[jj]).epsilon(1e-10));
+    }
+  }
+
+}
@@ -20,6 +20,7 @@
 #include "LocalModel.h"
 #include "XspecSpectrum.h"
 #include "Relreturn_BlackBody.h"
+#include "Profiling.h"
 #include "tests-bbody-returnrad.h"
 
 extern "C" {
@@ -392,6 +393,7 @@ TEST_CASE(" Return Radiation Black Body Spectrum"){
 
   free(photar_areaInteg);
   free(photar0_areaInteg);
+  free_returnSpec2D(&returnSpec);
 
 
 }
@@ -506,6 +508,39 @@ TEST_CASE("Check if Second Evaluation returns the identical results"){
   }
 }
 
+TEST_CASE(" Cached reflection of the zones gives the same RelxillBB spectrum", "[bbret]") {
+
+  LocalModel lmod(ModelName::relxillBB);
+  lmod.set_par(XPar::ktbb, 1.0);
+  lmod.set_par(XPar::boost, 1.0);
+
+  DefaultSpec default_spec_ref{};
+  XspecSpectrum spec_ref = default_spec_ref.get_xspec_spectrum();
+  lmod.eval_model(spec_ref);
+
+  // change the return spectra and afterwards only the boost, such that the last evaluation re-uses the
+  // cached reflection of the zones
+  DefaultSpec default_spec{};
+  XspecSpectrum spec = default_spec.get_xspec_spectrum();
+  lmod.set_par(XPar::ktbb, 1.5);
+  lmod.eval_model(spec);
+  lmod.set_par(XPar::ktbb, 1.0);
+  lmod.set_par(XPar::boost, 0.5);
+  lmod.eval_model(spec);
+  const long long hits_return_spec = get_profiling_cache_hits(PROF_CACHE_BBRET_SPEC);
+  const long long hits_zones = get_profiling_cache_hits(PROF_CACHE_RELXILL_XILL);
+  lmod.set_par(XPar::boost, 1.0);
+  lmod.eval_model(spec);
+  if (is_profiling_enabled()) {
+    REQUIRE(get_profiling_cache_hits(PROF_CACHE_BBRET_SPEC) == hits_return_spec + 1);
+    REQUIRE(get_profiling_cache_hits(PROF_CACHE_RELXILL_XILL) == hits_zones + 1);
+  }
+
+  for (int ii = 0; ii < spec.num_flux_bins(); ii++) {
+    REQUIRE(fabs(spec.flux[ii] - spec_ref.flux[ii]) <= PREC * fabs(spec_ref.flux[ii]));
+  }
+}
+
 TEST_CASE(" Evaluate RelxillBBRet (only black body)","[bbret]") {
 
   int status = EXIT_SUCCESS;
@@ -519,11 +554,11 @@ TEST_CASE(" Evaluate RelxillBBRet (only black body)","[bbret]") {
 
   lmod.set_par(XPar::boost,-1);
   lmod.eval_model(spec);
-  fits_write_spec("!testrr-spec-relxillbb-refl.fits", spec.energy, spec.flux, spec.num_flux_bins(), &status);
+  fits_write_spec("!testrr-spec-relxillbb-refl.fits", spec.energy(), spec.flux, spec.num_flux_bins(), &status);
 
   lmod.set_par(XPar::boost, 0);
   lmod.eval_model(spec);
-  fits_write_spec("!testrr-spec-relxillbb-prim.fits", spec.energy, spec.flux, spec.num_flux_bins(), &status);
+  fits_write_spec("!testrr-spec-relxillbb-prim.fits", spec.energy(), spec.flux, spec.num_flux_bins(), &status);
 
   setenv("RELXILL_WRITE_OUTFILES", "0", 1);
   setenv("RELXILL_BBRET_NOREFL", "0", 1);
@@ -81,6 +81,50 @@ TEST_CASE(" testing if local model is implemented", "[basic]") {
 }
 
 
+TEST_CASE(" parameter layout gives the parameters in the order of the Xspec definition", "[basic]") {
+
+  XspecModelDatabase database{};
+
+  for (const auto &elem: database.all_models()) {
+    DYNAMIC_SECTION("  - model: " << elem.second.name()) {
+      auto default_values = ModelDatabase::instance().get_default_values_array(elem.first);
+      std::vector<double> values(default_values.size());
+      for (size_t ii = 0; ii < values.size(); ii++) {
+        values[ii] = default_values[ii] + 1.0;
+      }
+
+      LocalModel lmod{values.data(), elem.first};
+      const auto parnames = lmod.get_model_params().get_parnames();
+      REQUIRE(parnames.size() == values.size());
+      for (size_t ii = 0; ii < parnames.size(); ii++) {
+        REQUIRE(lmod.get_model_params().does_parameter_exist(parnames[ii]));
+        REQUIRE(lmod.get_model_params().get_par(parnames[ii]) == values[ii]);
+      }
+    }
+  }
+
+}
+
+TEST_CASE(" compile-time dispatch selects the specialization of the model", "[basic]") {
+
+  XspecModelDatabase database{};
+
+  for (const auto &elem: database.all_models()) {
+    DYNAMIC_SECTION("  - model: " << elem.second.name()) {
+      const auto dispatched_name = visit_model_name(elem.first, [](auto model_name) {
+        return decltype(model_name)::value;
+      });
+      REQUIRE(dispatched_name == elem.first);
+
+      LocalModel lmod{elem.first};
+      REQUIRE(lmodel_info(elem.first).type() == lmod.get_model_params().model_type());
+      REQUIRE(lmodel_info(elem.first).irradiation() == lmod.get_model_params().irradiation());
+      REQUIRE(lmodel_info(elem.first).primeSpec() == lmod.get_model_params().primeSpec());
+    }
+  }
+
+}
+
 /*
  * TEST CASE
  */
@@ -224,6 +268,40 @@ TEST_CASE(" Relconv applied outside defined energy range should reset to zero",
 
 }
 
+TEST_CASE(" Relconv with the cached FFT kernel agrees with the re-calculated kernel", "[new]") {
+
+  const double spin = 0.9;
+  LocalModel lmod(ModelName::relconv);
+  lmod.set_par(XPar::a, spin);
+
+  // first evaluation (with a different input spectrum) sets up the relativistic kernel
+  DefaultSpec input_line{0.1, 100.0, 1000};
+  input_line.flux[input_line.num_flux_bins / 2] = 100.0;
+  auto spec_line = input_line.get_xspec_spectrum();
+  REQUIRE_NOTHROW(lmod.eval_model(spec_line));
+
+  // only the input spectrum changed: the cached kernel is used
+  DefaultSpec input_cached{0.1, 100.0, 1000};
+  auto spec_cached = input_cached.get_xspec_spectrum();
+  REQUIRE_NOTHROW(lmod.eval_model(spec_cached));
+
+  // force a re-calculation of the kernel for the same parameters
+  lmod.set_par(XPar::a, 0.5);
+  DefaultSpec input_other{0.1, 100.0, 1000};
+  auto spec_other = input_other.get_xspec_spectrum();
+  REQUIRE_NOTHROW(lmod.eval_model(spec_other));
+  lmod.set_par(XPar::a, spin);
+
+  DefaultSpec input_recalc{0.1, 100.0, 1000};
+  auto spec_recalc = input_recalc.get_xspec_spectrum();
+  REQUIRE_NOTHROW(lmod.eval_model(spec_recalc));
+
+  REQUIRE(sum_flux(spec_cached.flux, spec_cached.num_flux_bins()) > 1e-6);
+  for (int ii = 0; ii < spec_cached.num_flux_bins(); ii++) {
+    REQUIRE(fabs(spec_cached.flux[ii] - spec_recalc.flux[ii]) <= 1e-8 * fabs(spec_recalc.flux[ii]) + 1e-14);
+  }
+}
+
 TEST_CASE(" Testing caching an change of parameters for memory leaks", "[valgrind]") {
 
   DefaultSpec def_spec1{0.1, 1000.0, 3000};
@@ -100,3 +100,133 @@ TEST_CASE(" Exec single iongrad model, should change with xindex", "[iongrad]")
   REQUIRE( fabs(sum - sum2) > 1e-8);
 
 }
+
+
+TEST_CASE(" Merging ionization zones with similar xillver parameters", "[iongrad]") {
+
+  const int nzones = 6;
+  const double lxi[nzones] = {3.0, 2.0, 0.0, 0.0, 0.0005, 0.0};
+
+  xillTableParam xill_param[nzones];
+  xillTableParam *xill_param_zone[nzones];
+  for (int ii = 0; ii < nzones; ii++) {
+    xill_param[ii] = xillTableParam{2.0, 1.0, lxi[ii], 300.0, 30.0, 15.0, 0.0, 0.0, PRIM_SPEC_ECUT, MOD_TYPE_RELXILL};
+    xill_param_zone[ii] = &xill_param[ii];
+  }
+
+  auto merged_zones = MergedZones(xill_param_zone, nzones, 1e-3);
+  REQUIRE(merged_zones.num_zones() == 3);
+  REQUIRE(merged_zones.first_zone(2) == 2);
+  REQUIRE(merged_zones.merged_index(5) == 2);
+
+  // without a tolerance the zones are not merged
+  REQUIRE(MergedZones(xill_param_zone, nzones, 0.0).num_zones() == nzones);
+
+  // logxi and density are compared absolutely, also if they are larger than 1
+  xillTableParam xill_param_lxi[2] = {xill_param[0], xill_param[0]};
+  xill_param_lxi[1].lxi = 3.002;
+  xillTableParam *xill_param_lxi_zone[2] = {&xill_param_lxi[0], &xill_param_lxi[1]};
+  REQUIRE(MergedZones(xill_param_lxi_zone, 2, 1e-3).num_zones() == 2);
+
+  // the merged relline kernel is the sum of the kernels of its zones
+  int status = EXIT_SUCCESS;
+  const int n_ener = 10;
+  relline_spec_multizone *rel_profile = new_rel_spec(nzones, n_ener, &status);
+  rel_profile->rgrid = (double *) malloc((nzones + 1) * sizeof(double));
+  for (int ii = 0; ii <= nzones; ii++) {
+    rel_profile->rgrid[ii] = 1.0 + ii;
+  }
+  for (int jj = 0; jj <= n_ener; jj++) {
+    rel_profile->ener[jj] = 0.1 * (jj + 1);
+  }
+  for (int ii = 0; ii < nzones; ii++) {
+    for (int jj = 0; jj < n_ener; jj++) {
+      rel_profile->flux[ii][jj] = ii + 1.0;
+    }
+  }
+
+  relline_spec_multizone *merged_profile = merged_zones.merge_rel_profile(rel_profile, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+  REQUIRE(merged_profile->n_zones == 3);
+  REQUIRE(merged_profile->rgrid[3] == rel_profile->rgrid[nzones]);
+  REQUIRE(merged_profile->flux[2][0] == Catch::Approx(3.0 + 4.0 + 5.0 + 6.0));
+
+  // the factors of the zones are averaged for each merged zone, weighted with the flux of the zones
+  const double zone_factors[nzones] = {1.0, 1.5, 0.5, 1.0, 2.0, 4.0};
+  double merged_factors[3];
+  merged_zones.average_zone_factors(rel_profile, zone_factors, merged_factors);
+  REQUIRE(merged_factors[1] == 1.5);
+  REQUIRE(merged_factors[2] == Catch::Approx((0.5 * 3.0 + 4.0 + 2.0 * 5.0 + 4.0 * 6.0) / (3.0 + 4.0 + 5.0 + 6.0)));
+
+  free_rel_spec(merged_profile);
+  free_rel_spec(rel_profile);
+}
+
+
+TEST_CASE(" Merged ionization zones give the same spectrum as the single zones", "[iongrad]") {
+  DefaultSpec default_spec{};
+
+  LocalModel lmod(ModelName::relxilllpCp);
+  lmod.set_par(XPar::logxi, 3.0);
+
+  unsetenv("RELXILL_MERGE_ZONES");
+  auto spec = default_spec.get_xspec_spectrum();
+  REQUIRE_NOTHROW(lmod.eval_model(spec));
+
+  // the zones are only merged if the xillver spectra are re-calculated, which is forced by changing logxi
+  setenv("RELXILL_MERGE_ZONES", "0.02", 1);
+  auto spec_merged = default_spec.get_xspec_spectrum();
+  lmod.set_par(XPar::logxi, 3.1);
+  REQUIRE_NOTHROW(lmod.eval_model(spec_merged));
+  lmod.set_par(XPar::logxi, 3.0);
+  REQUIRE_NOTHROW(lmod.eval_model(spec_merged));
+  unsetenv("RELXILL_MERGE_ZONES");
+
+  // the outer zones only differ by their energy shift and are therefore merged
+  double max_flux = 0.0;
+  int num_different_bins = 0;
+  for (int ii = 0; ii < spec.num_flux_bins(); ii++) {
+    max_flux = fmax(max_flux, spec.flux[ii]);
+    num_different_bins += (spec.flux[ii] != spec_merged.flux[ii]) ? 1 : 0;
+  }
+  REQUIRE(num_different_bins > 0);
+
+  // merged zones use the energy shift of their first zone, which is only allowed to differ by the tolerance
+  const double prec = 0.02;
+  REQUIRE(sum_flux(spec_merged.flux, spec_merged.num_flux_bins())
+              == Catch::Approx(sum_flux(spec.flux, spec.num_flux_bins())).epsilon(0.5 * prec));
+  for (int ii = 0; ii < spec.num_flux_bins(); ii++) {
+    if (spec.flux[ii] > 1e-3 * max_flux) {
+      REQUIRE(spec_merged.flux[ii] == Catch::Approx(spec.flux[ii]).epsilon(prec));
+    }
+  }
+}
+
+
+TEST_CASE(" Merged ionization zones are re-normalized correctly if only kTe changes", "[iongrad]") {
+  DefaultSpec default_spec{};
+
+  LocalModel lmod(ModelName::relxilllpCp);
+  setenv("RELXILL_MERGE_ZONES", "0.02", 1);
+
+  auto spec = default_spec.get_xspec_spectrum();
+  lmod.set_par(XPar::incl, 30.0);
+  lmod.set_par(XPar::kte, 100.0);
+  REQUIRE_NOTHROW(lmod.eval_model(spec));
+
+  // only the xillver stage is re-calculated, the relline kernel is taken from the cache
+  lmod.set_par(XPar::kte, 60.0);
+  REQUIRE_NOTHROW(lmod.eval_model(spec));
+
+  // reference: the relline kernel is re-calculated by changing the inclination forth and back
+  auto spec_uncached = default_spec.get_xspec_spectrum();
+  lmod.set_par(XPar::incl, 31.0);
+  REQUIRE_NOTHROW(lmod.eval_model(spec_uncached));
+  lmod.set_par(XPar::incl, 30.0);
+  REQUIRE_NOTHROW(lmod.eval_model(spec_uncached));
+  unsetenv("RELXILL_MERGE_ZONES");
+
+  for (int ii = 0; ii < spec.num_flux_bins(); ii++) {
+    REQUIRE(spec.flux[ii] == Catch::Approx(spec_uncached.flux[ii]).epsilon(1e-8));
+  }
+}
@@ -0,0 +1,112 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "catch2/catch_amalgamated.hpp"
+
+extern "C" {
+#include "common.h"
+#include "relutility.h"
+}
+
+#include "Nthcomp.h"
+#include "XspecSpectrum.h"
+
+#include <vector>
+
+static void calc_nthcomp_direct(double *photar, const double *ener, int n_ener, double gam, double kTe, double z) {
+  double nthcomp_param[5];
+  get_nthcomp_param(nthcomp_param, gam, kTe, z);
+  c_donthcomp(ener, n_ener, nthcomp_param, photar);
+}
+
+/*
+ * maximal relative deviation of the tabulated from the direct spectrum for energies between
+ * 0.2keV (above the seed photons) and emax
+ */
+static double max_deviation_table(double gam, double kTe, double z, double emax) {
+
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+  std::vector<double> flux_direct(nbins);
+  std::vector<double> flux_table(nbins);
+
+  calc_nthcomp_direct(flux_direct.data(), default_spec.energy, nbins, gam, kTe, z);
+  NthcompTable::instance().eval(flux_table.data(), default_spec.energy, nbins, gam, kTe, z);
+
+  double max_dev = 0.0;
+  for (int ii = 0; ii < nbins; ii++) {
+    const double en = 0.5 * (default_spec.energy[ii] + default_spec.energy[ii + 1]);
+    if (en > 0.2 && en < emax) {
+      max_dev = std::max(max_dev, fabs(flux_table[ii] / flux_direct[ii] - 1));
+    }
+  }
+  return max_dev;
+}
+
+TEST_CASE(" Tabulated nthcomp agrees with the direct calculation", "[nthcomp]") {
+
+  // parameters in between the grid nodes, deviation is below 1% for E<3kTe (max. 0.7% for random
+  // parameters in the full range of the grid)
+  for (double gam: {1.07, 1.63, 2.01, 2.48, 3.33}) {
+    for (double kTe: {2.3, 17.0, 61.0, 342.0}) {
+      for (double z: {0.0, 0.3}) {
+        REQUIRE(max_deviation_table(gam, kTe, z, 3 * kTe) < 1e-2);
+      }
+    }
+  }
+
+  // on a node of the grid, the spectrum is identical (up to the rounding of the interpolation)
+  REQUIRE(max_deviation_table(2.0, 100.0, 0.0, 3 * 100.0) < 1e-6);
+
+}
+
+TEST_CASE(" Tabulated nthcomp is only used if requested", "[nthcomp]") {
+
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+  std::vector<double> flux_direct(nbins);
+  std::vector<double> flux(nbins);
+
+  const double gam = 1.87;
+  const double kTe = 43.0;
+  calc_nthcomp_direct(flux_direct.data(), default_spec.energy, nbins, gam, kTe, 0.0);
+
+  const char *env = "RELXILL_NTHCOMP_TABLE";
+  unsetenv(env);
+  nthcomp_spectrum(flux.data(), default_spec.energy, nbins, gam, kTe, 0.0);
+  for (int ii = 0; ii < nbins; ii++) {
+    REQUIRE(flux[ii] == flux_direct[ii]);
+  }
+
+  setenv(env, "1", 1);
+  std::vector<double> flux_table(nbins);
+  NthcompTable::instance().eval(flux_table.data(), default_spec.energy, nbins, gam, kTe, 0.0);
+  nthcomp_spectrum(flux.data(), default_spec.energy, nbins, gam, kTe, 0.0);
+  for (int ii = 0; ii < nbins; ii++) {
+    REQUIRE(flux[ii] == flux_table[ii]);
+  }
+
+  // outside of the grid the spectrum is calculated directly
+  calc_nthcomp_direct(flux_direct.data(), default_spec.energy, nbins, gam, 2000.0, 0.0);
+  nthcomp_spectrum(flux.data(), default_spec.energy, nbins, gam, 2000.0, 0.0);
+  for (int ii = 0; ii < nbins; ii++) {
+    REQUIRE(flux[ii] == flux_direct[ii]);
+  }
+  unsetenv(env);
+
+}
@@ -0,0 +1,175 @@
+/*
+   This file is part of the RELXILL model code.
+
+   RELXILL is free software: you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   any later version.
+
+   RELXILL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+   For a copy of the GNU General Public License see
+   <http://www.gnu.org/licenses/>.
+
+    Copyright 2022 Thomas Dauser, Remeis Observatory & ECAP
+*/
+
+#include "catch2/catch_amalgamated.hpp"
+#include "LocalModel.h"
+#include "Profiling.h"
+#include "FitTrace.h"
+
+#include <fstream>
+#include <sstream>
+
+TEST_CASE(" Profiling counts the stages and cache accesses", "[profiling]") {
+
+  DefaultSpec default_spec{};
+  LocalModel local_model{ModelName::relxill};
+  local_model.set_par(XPar::a, 0.9123);  // make sure the first evaluation is not cached
+
+  set_profiling_enabled(1);
+  reset_profiling();
+
+  auto spec = default_spec.get_xspec_spectrum();
+  local_model.eval_model(spec);
+
+  REQUIRE(get_profiling_num_calls(PROF_RELXILL_KERNEL) == 1);
+  REQUIRE(get_profiling_num_calls(PROF_SYSTEM_PARAMETERS) >= 1);
+  REQUIRE(get_profiling_num_calls(PROF_RELLINE_PROFILE) == 1);
+  REQUIRE(get_profiling_num_calls(PROF_FFT_CONV) >= 1);
+  REQUIRE(get_profiling_time_sec(PROF_RELXILL_KERNEL) > 0.0);
+  REQUIRE(get_profiling_cache_misses(PROF_CACHE_RELBASE) == 1);
+  REQUIRE(get_profiling_cache_misses(PROF_CACHE_RELXILL_RELAT) == 1);
+
+  // the second evaluation with the same parameters is fully cached
+  auto spec2 = default_spec.get_xspec_spectrum();
+  local_model.eval_model(spec2);
+
+  REQUIRE(get_profiling_num_calls(PROF_RELXILL_KERNEL) == 2);
+  REQUIRE(get_profiling_num_calls(PROF_RELLINE_PROFILE) == 1);
+  REQUIRE(get_profiling_cache_hits(PROF_CACHE_RELXILL_SPEC) == 1);
+  REQUIRE(get_profiling_cache_hits(PROF_CACHE_SYSPAR) >= 1);
+
+  // nothing is counted if profiling is disabled
+  set_profiling_enabled(0);
+  reset_profiling();
+  local_model.set_par(XPar::a, 0.8123);
+  auto spec3 = default_spec.get_xspec_spectrum();
+  local_model.eval_model(spec3);
+
+  REQUIRE(get_profiling_num_calls(PROF_RELXILL_KERNEL) == 0);
+  REQUIRE(get_profiling_cache_misses(PROF_CACHE_RELBASE) == 0);
+
+}
+
+TEST_CASE(" Trace of the model evaluation is written as Chrome trace JSON", "[profiling]") {
+
+  DefaultSpec default_spec{};
+  LocalModel local_model{ModelName::relxill};
+  local_model.set_par(XPar::a, 0.9234);
+
+  set_tracing_enabled(1);
+  const auto num_events_before = get_num_trace_events();
+
+  auto spec = default_spec.get_xspec_spectrum();
+  local_model.eval_model(spec);
+  set_tracing_enabled(0);
+
+  REQUIRE(get_num_trace_events() > num_events_before);
+
+  const char *fname = "test-trace-relxill.json";
+  REQUIRE(write_profiling_trace(fname) == 0);
+
+  std::ifstream trace_file(fname);
+  std::stringstream buffer;
+  buffer << trace_file.rdbuf();
+  const auto trace = buffer.str();
+
+  REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(trace.find("\"name\": \"relxill_kernel\"") != std::string::npos);
+  REQUIRE(trace.find("\"name\": \"relbase_profile\"") != std::string::npos);
+  REQUIRE(trace.find("\"model\": \"relxill\", \"parameters\": [") != std::string::npos);
+  REQUIRE(trace.find("0.9234") != std::string::npos);
+
+  // no events are recorded if tracing is disabled
+  const auto num_events = get_num_trace_events();
+  local_model.set_par(XPar::a, 0.8234);
+  auto spec2 = default_spec.get_xspec_spectrum();
+  local_model.eval_model(spec2);
+  REQUIRE(get_num_trace_events() == num_events);
+
+}
+
+TEST_CASE(" Recorded fit trace contains all model calls", "[profiling]") {
+
+  DefaultSpec default_spec{};
+  const int nbins = static_cast<int>(default_spec.num_flux_bins);
+  std::vector<double> flux(nbins, 0.0);
+
+  auto relline_values = ModelDatabase::instance().get_default_values_array(ModelName::relline);
+  auto xillver_values = ModelDatabase::instance().get_default_values_array(ModelName::xillver);
+
+  const char *fname = "test-fit-trace.bin";
+  start_fit_recording(fname);
+  REQUIRE(is_fit_recording_enabled() == 1);
+  xspec_C_wrapper_eval_model(ModelName::relline, relline_values.data(), flux.data(), nbins, default_spec.energy);
+  relline_values[0] += 0.01;
+  xspec_C_wrapper_eval_model(ModelName::relline, relline_values.data(), flux.data(), nbins, default_spec.energy);
+  xspec_C_wrapper_eval_model(ModelName::xillver, xillver_values.data(), flux.data(), nbins, default_spec.energy);
+  stop_fit_recording();
+
+  auto calls = read_fit_trace(fname);
+  REQUIRE(calls.size() == 3);
+  REQUIRE(calls[0].model_name == "relline");
+  REQUIRE(calls[2].model_name == "xillver");
+  REQUIRE(calls[1].parameters == relline_values);
+  REQUIRE(calls[2].parameters == xillver_values);
+
+  // the energy grid is only stored once
+  REQUIRE(calls[0].energy == calls[2].energy);
+  REQUIRE(calls[0].num_flux_bins() == nbins);
+  REQUIRE(calls[0].energy_hash == get_energy_grid_hash(default_spec.energy, nbins));
+  for (int ii = 0; ii <= nbins; ii++) {
+    REQUIRE((*calls[0].energy)[ii] == default_spec.energy[ii]);
+  }
+
+  // nothing is recorded after stopping
+  xspec_C_wrapper_eval_model(ModelName::relline, relline_values.data(), flux.data(), nbins, default_spec.energy);
+  REQUIRE(read_fit_trace(fname).size() == 3);
+
+  REQUIRE_THROWS_AS(read_fit_trace("test-fit-trace-not-existing.bin"), std::runtime_error);
+
+}
+
+TEST_CASE(" Memory of the tables and caches is accounted", "[profiling]") {
+
+  DefaultSpec default_spec{};
+  LocalModel local_model{ModelName::relxilllp};
+  auto spec = default_spec.get_xspec_spectrum();
+  local_model.eval_model(spec);
+
+  // the relline table is dominated by the transfer functions and angles
+  const long long nbytes_reltable_min = 4LL * RELTABLE_NA * RELTABLE_NMU0 * RELTABLE_NR * RELTABLE_NG * sizeof(float);
+  REQUIRE(get_memory_bytes(PROF_MEM_RELTABLE) > nbytes_reltable_min);
+  REQUIRE(get_memory_bytes(PROF_MEM_RELTABLE) < 2 * nbytes_reltable_min);
+
+  for (auto subsystem: {PROF_MEM_RELTABLE, PROF_MEM_LPTABLE, PROF_MEM_XILLTABLE, PROF_MEM_CACHE_NODES,
+                        PROF_MEM_SPEC_CACHE}) {
+    REQUIRE(get_memory_bytes(subsystem) > 0);
+    REQUIRE(get_memory_peak_bytes(subsystem) >= get_memory_bytes(subsystem));
+  }
+
+  // the peak is kept after releasing memory
+  const long long nbytes = get_memory_bytes(PROF_MEM_SPEC_CACHE);
+  const long long nbytes_peak = get_memory_peak_bytes(PROF_MEM_SPEC_CACHE);
+  prof_mem_add(PROF_MEM_SPEC_CACHE, nbytes_peak);
+  prof_mem_add(PROF_MEM_SPEC_CACHE, -nbytes_peak);
+  REQUIRE(get_memory_bytes(PROF_MEM_SPEC_CACHE) == nbytes);
+  REQUIRE(get_memory_peak_bytes(PROF_MEM_SPEC_CACHE) == nbytes + nbytes_peak);
+
+  REQUIRE(get_peak_rss_bytes() >= get_memory_bytes(PROF_MEM_RELTABLE));
+
+}
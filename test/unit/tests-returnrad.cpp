@@ -186,6 +186,75 @@ emisProfile* get_test_emis_rrad(double rin, double rout, double spin, int* statu
 
 
 // ------- //
+TEST_CASE(" Cached weights of the return rad emissivity give the same profile", "[returnrad]") {
+
+  int status = EXIT_SUCCESS;
+  const double spin = 0.998;
+  returningFractions *rf = get_rrad_fractions(spin, kerr_rms(spin), 1000.0, &status);
+
+  emisProfile *emis = new_emisProfile(rf->rad, rf->nrad, &status);
+  get_emis_bkn(emis->emis, emis->re, emis->nr, 3.0, 3.0, emis->re[0]);
+  emisProfile *emis_steep = new_emisProfile(rf->rad, rf->nrad, &status);
+  get_emis_bkn(emis_steep->emis, emis_steep->re, emis_steep->nr, 5.0, 5.0, emis_steep->re[0]);
+
+  // the second call re-uses the weights (same gamma), the last one calculates them again
+  emisProfile *emis_return_1 = calc_rrad_emis_corona(rf, nullptr, emis, 2.0, &status);
+  emisProfile *emis_return_cached = calc_rrad_emis_corona(rf, nullptr, emis_steep, 2.0, &status);
+  emisProfile *emis_return_2 = calc_rrad_emis_corona(rf, nullptr, emis, 2.5, &status);
+  emisProfile *emis_return_new = calc_rrad_emis_corona(rf, nullptr, emis_steep, 2.0, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+
+  for (int ii = 0; ii < rf->nrad; ii++) {
+    REQUIRE(emis_return_cached->emis[ii] == emis_return_new->emis[ii]);
+    REQUIRE(emis_return_1->emis[ii] != emis_return_2->emis[ii]);
+  }
+
+  for (auto emis_profile: {emis, emis_steep, emis_return_1, emis_return_cached, emis_return_2, emis_return_new}) {
+    free_emisProfile(emis_profile);
+  }
+  free_returningFractions(&rf);
+}
+
+TEST_CASE(" Cached weights of the return rad emissivity are valid for a different Rin in the same zone",
+          "[returnrad]") {
+
+  int status = EXIT_SUCCESS;
+  const double spin = 0.998;
+  const double rin = kerr_rms(spin);
+  returningFractions *rf = get_rrad_fractions(spin, rin, 1000.0, &status);
+  returningFractions *rf_rin = get_rrad_fractions(spin, 0.5 * (rin + rf->rhi[0]), 1000.0, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+
+  // the same zones of the table are used, only the area correction of the inner zone changes
+  REQUIRE(rf_rin->nrad == rf->nrad);
+  for (int ii = 0; ii < rf->nrad; ii++) {
+    REQUIRE(rf_rin->irad[ii] == rf->irad[ii]);
+  }
+  REQUIRE(rf_rin->tf_r[1][0] != rf->tf_r[1][0]);
+
+  emisProfile *emis = new_emisProfile(rf->rad, rf->nrad, &status);
+  get_emis_bkn(emis->emis, emis->re, emis->nr, 3.0, 3.0, emis->re[0]);
+  emisProfile *emis_rin = new_emisProfile(rf_rin->rad, rf_rin->nrad, &status);
+  get_emis_bkn(emis_rin->emis, emis_rin->re, emis_rin->nr, 3.0, 3.0, emis_rin->re[0]);
+
+  // the second call re-uses the weights, the last one calculates them again (as gamma changed before)
+  emisProfile *emis_return = calc_rrad_emis_corona(rf, nullptr, emis, 2.0, &status);
+  emisProfile *emis_return_cached = calc_rrad_emis_corona(rf_rin, nullptr, emis_rin, 2.0, &status);
+  emisProfile *emis_return_gamma = calc_rrad_emis_corona(rf_rin, nullptr, emis_rin, 2.5, &status);
+  emisProfile *emis_return_new = calc_rrad_emis_corona(rf_rin, nullptr, emis_rin, 2.0, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+
+  for (int ii = 0; ii < rf->nrad; ii++) {
+    REQUIRE(emis_return_cached->emis[ii] == emis_return_new->emis[ii]);
+  }
+
+  for (auto emis_profile: {emis, emis_rin, emis_return, emis_return_cached, emis_return_gamma, emis_return_new}) {
+    free_emisProfile(emis_profile);
+  }
+  free_returningFractions(&rf);
+  free_returningFractions(&rf_rin);
+}
+
 TEST_CASE(" Changing number of radial bins if Rin is increased", "[returnrad]") {
 
   int status = EXIT_SUCCESS;
@@ -553,7 +622,7 @@ TEST_CASE(" Test relxilllp including returning radiation", "[returnrad]") {
   double model_rrad_flux = sum_flux(spec.flux, spec.num_flux_bins());
 
   string fname = "test-spec-relxilllpret.dat";
-  save_xillver_spectrum(spec.energy, spec.flux, spec.num_flux_bins(), fname.data());
+  save_xillver_spectrum(spec.energy(), spec.flux, spec.num_flux_bins(), fname.data());
 
   REQUIRE(model_rrad_flux > model_no_rrad_flux);
 
@@ -741,4 +810,29 @@ TEST_CASE(" Test that returnrad is also implemented for low spin","[returnrad2]"
   REQUIRE( fabs(model1 - model2)/model1 > 1e-3 );
 
 
-}
\ No newline at end of file
+}
+
+TEST_CASE(" Cached return fractions are identical to the calculated ones", "[returnrad]") {
+
+  int status = EXIT_SUCCESS;
+  const double spin = 0.9;
+  const double rout = 1000.0;
+
+  returningFractions *rf = get_rrad_fractions(spin, kerr_rms(spin), rout, &status);
+  const returningFractions *rf_cached = get_cached_rrad_fractions(spin, kerr_rms(spin), rout, &status);
+  REQUIRE(status == EXIT_SUCCESS);
+
+  // second call with the same values needs to return the same (cached) fractions
+  REQUIRE(get_cached_rrad_fractions(spin, kerr_rms(spin), rout, &status) == rf_cached);
+  REQUIRE(get_cached_rrad_fractions(spin, 2 * kerr_rms(spin), rout, &status) != rf_cached);
+
+  REQUIRE(rf_cached->nrad == rf->nrad);
+  for (int ii = 0; ii < rf->nrad; ii++) {
+    REQUIRE(rf_cached->rad[ii] == rf->rad[ii]);
+    for (int jj = 0; jj < rf->nrad; jj++) {
+      REQUIRE(rf_cached->tf_r[ii][jj] == rf->tf_r[ii][jj]);
+    }
+  }
+
+  free_returningFractions(&rf);
+}